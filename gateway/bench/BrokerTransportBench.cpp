@@ -0,0 +1,334 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "mqttsn/gateway/Session.h"
+
+namespace
+{
+
+typedef std::vector<std::uint8_t> DataBuf;
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t DefaultMessagesCount = 200000U;
+const std::size_t Window = 32U;
+const std::size_t PayloadSize = 64U;
+const std::uint16_t TopicId = 1U;
+const std::string Topic("bench/topic");
+
+const std::uint8_t MqttsnConnackId = 0x05;
+const std::uint8_t MqttsnPublishId = 0x0c;
+const std::uint8_t MqttConnectType = 1U;
+const std::uint8_t MqttPublishType = 3U;
+
+bool writeAll(int fd, const std::uint8_t* buf, std::size_t bufSize)
+{
+    while (0U < bufSize) {
+        auto count = ::send(fd, buf, bufSize, MSG_NOSIGNAL);
+        if ((count < 0) && (errno == EINTR)) {
+            continue;
+        }
+
+        if (count <= 0) {
+            return false;
+        }
+
+        buf += count;
+        bufSize -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+// Minimal broker: acknowledges connection and echoes every PUBLISH back
+void runBroker(int fd)
+{
+    DataBuf in;
+    DataBuf out;
+    std::uint8_t buf[16 * 1024];
+    while (true) {
+        auto count = ::read(fd, buf, sizeof(buf));
+        if ((count < 0) && (errno == EINTR)) {
+            continue;
+        }
+
+        if (count <= 0) {
+            break;
+        }
+
+        in.insert(in.end(), &buf[0], &buf[count]);
+        std::size_t pos = 0U;
+        while (pos < in.size()) {
+            std::size_t remLen = 0U;
+            std::size_t lenBytes = 0U;
+            bool complete = false;
+            while ((pos + 1 + lenBytes) < in.size()) {
+                auto byte = in[pos + 1 + lenBytes];
+                remLen |= static_cast<std::size_t>(byte & 0x7f) << (7 * lenBytes);
+                ++lenBytes;
+                if ((byte & 0x80) == 0) {
+                    complete = true;
+                    break;
+                }
+            }
+
+            auto msgLen = 1 + lenBytes + remLen;
+            if ((!complete) || (in.size() < (pos + msgLen))) {
+                break;
+            }
+
+            auto type = static_cast<std::uint8_t>(in[pos] >> 4);
+            if (type == MqttConnectType) {
+                static const std::uint8_t Connack[] = {0x20, 0x02, 0x00, 0x00};
+                out.insert(out.end(), std::begin(Connack), std::end(Connack));
+            }
+            else if (type == MqttPublishType) {
+                out.insert(out.end(), in.begin() + pos, in.begin() + pos + msgLen);
+            }
+
+            pos += msgLen;
+        }
+
+        in.erase(in.begin(), in.begin() + pos);
+        if ((!out.empty()) && (!writeAll(fd, &out[0], out.size()))) {
+            break;
+        }
+        out.clear();
+    }
+
+    ::close(fd);
+}
+
+bool makeTcpPair(int& gwFd, int& brokerFd)
+{
+    auto listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    if ((listenFd < 0) ||
+        (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) ||
+        (::listen(listenFd, 1) != 0) ||
+        (::getsockname(listenFd, reinterpret_cast<sockaddr*>(&addr), &addrLen) != 0)) {
+        ::close(listenFd);
+        return false;
+    }
+
+    gwFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if ((gwFd < 0) ||
+        (::connect(gwFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)) {
+        ::close(listenFd);
+        return false;
+    }
+
+    brokerFd = ::accept(listenFd, nullptr, nullptr);
+    ::close(listenFd);
+
+    // Qt sockets used by the gateway don't delay small writes either
+    int flag = 1;
+    ::setsockopt(gwFd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    ::setsockopt(brokerFd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    return 0 <= brokerFd;
+}
+
+bool makeUnixPair(int& gwFd, int& brokerFd)
+{
+    auto path = "/tmp/cc_mqttsn_gw_bench_" + std::to_string(::getpid()) + ".sock";
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    ::unlink(path.c_str());
+    auto listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((listenFd < 0) ||
+        (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) ||
+        (::listen(listenFd, 1) != 0)) {
+        ::close(listenFd);
+        return false;
+    }
+
+    gwFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((gwFd < 0) ||
+        (::connect(gwFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)) {
+        ::close(listenFd);
+        ::unlink(path.c_str());
+        return false;
+    }
+
+    brokerFd = ::accept(listenFd, nullptr, nullptr);
+    ::close(listenFd);
+    ::unlink(path.c_str());
+    return 0 <= brokerFd;
+}
+
+// Drives a gateway session: the client publishes QoS0 messages to the
+// predefined topic, the session forwards them to the broker, which echoes
+// them back, to be forwarded to the client. Returns number of messages
+// delivered back to the client per second.
+double runSession(int fd, std::size_t msgCount)
+{
+    mqttsn::gateway::Session session;
+    DataBuf toBroker;
+    std::uint8_t lastToClient = 0U;
+    std::size_t delivered = 0U;
+
+    session.setNextTickProgramReqCb([](unsigned) {});
+    session.setCancelTickWaitReqCb([]() -> unsigned { return 0U; });
+    session.setTerminationReqCb([]() {});
+    session.setBrokerReconnectReqCb([]() {});
+    session.setSendDataClientReqCb(
+        [&lastToClient, &delivered](const std::uint8_t* buf, std::size_t bufSize)
+        {
+            if (bufSize < 2U) {
+                return;
+            }
+
+            lastToClient = buf[1];
+            if (lastToClient == MqttsnPublishId) {
+                ++delivered;
+            }
+        });
+    session.setSendDataBrokerReqCb(
+        [&toBroker](const std::uint8_t* buf, std::size_t bufSize)
+        {
+            toBroker.insert(toBroker.end(), buf, buf + bufSize);
+        });
+
+    session.addPredefinedTopic(Topic, TopicId);
+    if (!session.start()) {
+        return 0.0;
+    }
+    session.setBrokerConnected(true);
+
+    DataBuf fromBroker;
+    auto flushAndReadUntil =
+        [&](std::function<bool ()> done) -> bool
+        {
+            if ((!toBroker.empty()) && (!writeAll(fd, &toBroker[0], toBroker.size()))) {
+                return false;
+            }
+            toBroker.clear();
+
+            std::uint8_t buf[16 * 1024];
+            while (!done()) {
+                auto count = ::read(fd, buf, sizeof(buf));
+                if ((count < 0) && (errno == EINTR)) {
+                    continue;
+                }
+
+                if (count <= 0) {
+                    return false;
+                }
+
+                fromBroker.insert(fromBroker.end(), &buf[0], &buf[count]);
+                auto consumed = session.dataFromBroker(&fromBroker[0], fromBroker.size());
+                fromBroker.erase(fromBroker.begin(), fromBroker.begin() + consumed);
+            }
+            return true;
+        };
+
+    static const std::uint8_t ClientId[] = {'b', 'e', 'n', 'c', 'h'};
+    DataBuf connect = {0, 0x04, 0x04, 0x01, 0x00, 0x3c};
+    connect.insert(connect.end(), std::begin(ClientId), std::end(ClientId));
+    connect[0] = static_cast<std::uint8_t>(connect.size());
+    session.dataFromClient(&connect[0], connect.size());
+    if (!flushAndReadUntil([&lastToClient]() { return lastToClient == MqttsnConnackId; })) {
+        return 0.0;
+    }
+
+    DataBuf publish = {0, MqttsnPublishId, 0x01, 0, 0, 0, 0};
+    publish[3] = static_cast<std::uint8_t>(TopicId >> 8);
+    publish[4] = static_cast<std::uint8_t>(TopicId);
+    publish.resize(publish.size() + PayloadSize, 0xa5);
+    publish[0] = static_cast<std::uint8_t>(publish.size());
+
+    auto start = Clock::now();
+    std::size_t sent = 0U;
+    while (sent < msgCount) {
+        auto batch = std::min(Window, msgCount - sent);
+        for (std::size_t idx = 0U; idx < batch; ++idx) {
+            session.dataFromClient(&publish[0], publish.size());
+        }
+        sent += batch;
+
+        if (!flushAndReadUntil([&delivered, sent]() { return sent <= delivered; })) {
+            return 0.0;
+        }
+    }
+
+    auto diff = Clock::now() - start;
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(diff).count();
+    if (us == 0) {
+        return 0.0;
+    }
+    return (static_cast<double>(delivered) * 1000000.0) / us;
+}
+
+double measure(bool (*makePair)(int&, int&), std::size_t msgCount)
+{
+    int gwFd = -1;
+    int brokerFd = -1;
+    if (!makePair(gwFd, brokerFd)) {
+        std::cerr << "ERROR: Failed to establish connection: " << std::strerror(errno) << std::endl;
+        return 0.0;
+    }
+
+    std::thread broker(&runBroker, brokerFd);
+    auto result = runSession(gwFd, msgCount);
+    ::shutdown(gwFd, SHUT_WR);
+    broker.join();
+    ::close(gwFd);
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t msgCount = DefaultMessagesCount;
+    if (1 < argc) {
+        msgCount = static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10));
+    }
+
+    auto tcpRate = measure(&makeTcpPair, msgCount);
+    auto unixRate = measure(&makeUnixPair, msgCount);
+
+    std::cout << "Messages: " << msgCount << " (payload " << PayloadSize << " bytes, window " << Window << ")\n";
+    std::cout << "Loopback TCP: " << tcpRate << " msg/s\n";
+    std::cout << "Unix socket: " << unixRate << " msg/s" << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+
+#include "ClientAddrMap.h"
+
+namespace
+{
+
+typedef mqttsn::gateway::app::udp::ClientAddr ClientAddr;
+
+struct Entry
+{
+    const ClientAddr& getClientAddr() const
+    {
+        return m_addr;
+    }
+
+    ClientAddr m_addr;
+    unsigned m_hits = 0U;
+};
+
+typedef mqttsn::gateway::app::udp::ClientAddrMap<Entry> EntryMap;
+typedef std::map<std::string, Entry*> StringEntryMap;
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t DefaultSessionsCount = 100000U;
+const std::size_t LookupsCount = 10000000U;
+
+// Mimics former "addr:port" key formatting done for every incoming datagram
+std::string toUrl(const ClientAddr& addr)
+{
+    auto ip = addr.ipv4();
+    return
+        std::to_string((ip >> 24) & 0xff) + '.' +
+        std::to_string((ip >> 16) & 0xff) + '.' +
+        std::to_string((ip >> 8) & 0xff) + '.' +
+        std::to_string(ip & 0xff) + ':' +
+        std::to_string(addr.port());
+}
+
+template <typename TFunc>
+double measureNsPerOp(std::size_t count, TFunc&& func)
+{
+    auto start = Clock::now();
+    func();
+    auto diff = Clock::now() - start;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+    return static_cast<double>(ns) / count;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t sessionsCount = DefaultSessionsCount;
+    if (1 < argc) {
+        sessionsCount = static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10));
+    }
+
+    std::vector<std::unique_ptr<Entry> > entries;
+    entries.reserve(sessionsCount);
+    std::mt19937 gen(12345);
+    for (std::size_t idx = 0U; idx < sessionsCount; ++idx) {
+        std::unique_ptr<Entry> entry(new Entry);
+        auto ip = 0x0a000000U | static_cast<std::uint32_t>(idx / 16);
+        auto port = static_cast<ClientAddr::PortType>(10000 + (idx % 16));
+        entry->m_addr = ClientAddr::fromIPv4(ip, port);
+        entries.push_back(std::move(entry));
+    }
+
+    EntryMap map;
+    StringEntryMap stringMap;
+    for (auto& e : entries) {
+        map.insert(e.get());
+        stringMap.insert(std::make_pair(toUrl(e->m_addr), e.get()));
+    }
+
+    std::vector<ClientAddr> lookups;
+    lookups.reserve(LookupsCount);
+    std::uniform_int_distribution<std::size_t> dist(0U, sessionsCount - 1);
+    for (std::size_t idx = 0U; idx < LookupsCount; ++idx) {
+        auto& addr = entries[dist(gen)]->m_addr;
+        // Rebuild address on every lookup, just like receiving a datagram does
+        lookups.push_back(ClientAddr::fromIPv4(addr.ipv4(), addr.port()));
+    }
+
+    auto tableNs = measureNsPerOp(LookupsCount,
+        [&map, &lookups]()
+        {
+            for (auto& addr : lookups) {
+                auto* entry = map.find(ClientAddr::fromIPv4(addr.ipv4(), addr.port()));
+                ++entry->m_hits;
+            }
+        });
+
+    auto stringCount = LookupsCount / 10;
+    auto stringNs = measureNsPerOp(stringCount,
+        [&stringMap, &lookups, stringCount]()
+        {
+            for (std::size_t idx = 0U; idx < stringCount; ++idx) {
+                auto iter = stringMap.find(toUrl(lookups[idx]));
+                ++iter->second->m_hits;
+            }
+        });
+
+    unsigned long long totalHits = 0U;
+    for (auto& e : entries) {
+        totalHits += e->m_hits;
+    }
+
+    std::cout << "Sessions: " << sessionsCount << '\n';
+    std::cout << "Address keyed open addressing table: " << tableNs << " ns/lookup\n";
+    std::cout << "String keyed std::map: " << stringNs << " ns/lookup\n";
+    std::cout << "Total hits: " << totalHits << std::endl;
+    return 0;
+}
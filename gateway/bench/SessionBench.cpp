@@ -0,0 +1,230 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <new>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CC_MQTTSN_BENCH_HAS_RDTSC
+#endif
+
+#include "mqttsn/gateway/Session.h"
+
+namespace
+{
+
+typedef std::vector<std::uint8_t> DataBuf;
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t DefaultMessagesCount = 1000000U;
+const std::size_t SessionsCount = 10000U;
+const std::size_t PayloadSize = 16U;
+const std::uint16_t TopicId = 1U;
+const std::string Topic("bench/topic");
+
+const std::uint8_t MqttsnConnackId = 0x05;
+const std::uint8_t MqttsnPublishId = 0x0c;
+
+std::size_t allocatedBytes = 0U;
+std::size_t allocationsCount = 0U;
+
+unsigned long long cycles()
+{
+#ifdef CC_MQTTSN_BENCH_HAS_RDTSC
+    return __rdtsc();
+#else
+    return 0U;
+#endif
+}
+
+struct Measurement
+{
+    double m_ns = 0.0;
+    double m_cycles = 0.0;
+};
+
+template <typename TFunc>
+Measurement measurePerOp(std::size_t count, TFunc&& func)
+{
+    auto start = Clock::now();
+    auto startCycles = cycles();
+    func();
+    auto endCycles = cycles();
+    auto diff = Clock::now() - start;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+
+    Measurement result;
+    result.m_ns = static_cast<double>(ns) / count;
+    result.m_cycles = static_cast<double>(endCycles - startCycles) / count;
+    return result;
+}
+
+struct SessionCtx
+{
+    mqttsn::gateway::Session m_session;
+    std::uint8_t m_lastToClient = 0U;
+    std::size_t m_toClientCount = 0U;
+    std::size_t m_toBrokerCount = 0U;
+};
+
+typedef std::unique_ptr<SessionCtx> SessionCtxPtr;
+
+// Creates the session and connects the client to the broker, the
+// messages are not sent anywhere, only counted.
+SessionCtxPtr connectSession(const std::string& clientId)
+{
+    SessionCtxPtr ctx(new SessionCtx);
+    auto* ctxPtr = ctx.get();
+    auto& session = ctx->m_session;
+    session.setNextTickProgramReqCb([](unsigned) {});
+    session.setCancelTickWaitReqCb([]() -> unsigned { return 0U; });
+    session.setTerminationReqCb([]() {});
+    session.setBrokerReconnectReqCb([]() {});
+    session.setSendDataClientReqCb(
+        [ctxPtr](const std::uint8_t* buf, std::size_t bufSize)
+        {
+            if (bufSize < 2U) {
+                return;
+            }
+
+            ctxPtr->m_lastToClient = buf[1];
+            ++ctxPtr->m_toClientCount;
+        });
+    session.setSendDataBrokerReqCb(
+        [ctxPtr](const std::uint8_t*, std::size_t)
+        {
+            ++ctxPtr->m_toBrokerCount;
+        });
+
+    session.addPredefinedTopic(Topic, TopicId);
+    if (!session.start()) {
+        return SessionCtxPtr();
+    }
+    session.setBrokerConnected(true);
+
+    DataBuf connect = {0, 0x04, 0x04, 0x01, 0x00, 0x3c};
+    connect.insert(connect.end(), clientId.begin(), clientId.end());
+    connect[0] = static_cast<std::uint8_t>(connect.size());
+    session.dataFromClient(&connect[0], connect.size());
+
+    static const std::uint8_t Connack[] = {0x20, 0x02, 0x00, 0x00};
+    session.dataFromBroker(&Connack[0], sizeof(Connack));
+    if (ctx->m_lastToClient != MqttsnConnackId) {
+        return SessionCtxPtr();
+    }
+
+    return ctx;
+}
+
+}  // namespace
+
+void* operator new(std::size_t size)
+{
+    allocatedBytes += size;
+    ++allocationsCount;
+    auto* ptr = std::malloc(size);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t msgCount = DefaultMessagesCount;
+    if (1 < argc) {
+        msgCount = static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10));
+    }
+
+    // Footprint of the connected session, including the memory allocated
+    // by the session on the heap.
+    std::vector<SessionCtxPtr> sessions;
+    sessions.reserve(SessionsCount);
+    auto bytesBefore = allocatedBytes;
+    auto allocationsBefore = allocationsCount;
+    for (std::size_t idx = 0U; idx < SessionsCount; ++idx) {
+        auto ctx = connectSession("client" + std::to_string(idx));
+        if (!ctx) {
+            std::cerr << "ERROR: Failed to connect session" << std::endl;
+            return -1;
+        }
+        sessions.push_back(std::move(ctx));
+    }
+    auto sessionBytes = (allocatedBytes - bytesBefore) / SessionsCount;
+    auto sessionAllocations = (allocationsCount - allocationsBefore) / SessionsCount;
+    sessions.clear();
+
+    auto ctx = connectSession("bench");
+    if (!ctx) {
+        std::cerr << "ERROR: Failed to connect session" << std::endl;
+        return -1;
+    }
+
+    auto& session = ctx->m_session;
+    DataBuf clientPublish = {0, MqttsnPublishId, 0x01, 0, 0, 0, 0};
+    clientPublish[3] = static_cast<std::uint8_t>(TopicId >> 8);
+    clientPublish[4] = static_cast<std::uint8_t>(TopicId);
+    clientPublish.resize(clientPublish.size() + PayloadSize, 0xa5);
+    clientPublish[0] = static_cast<std::uint8_t>(clientPublish.size());
+
+    auto toBroker =
+        measurePerOp(msgCount,
+            [&session, &clientPublish, msgCount]()
+            {
+                for (std::size_t idx = 0U; idx < msgCount; ++idx) {
+                    session.dataFromClient(&clientPublish[0], clientPublish.size());
+                }
+            });
+
+    DataBuf brokerPublish = {0x30, 0, 0, static_cast<std::uint8_t>(Topic.size())};
+    brokerPublish.insert(brokerPublish.end(), Topic.begin(), Topic.end());
+    brokerPublish.resize(brokerPublish.size() + PayloadSize, 0x5a);
+    brokerPublish[1] = static_cast<std::uint8_t>(brokerPublish.size() - 2U);
+
+    auto toClient =
+        measurePerOp(msgCount,
+            [&session, &brokerPublish, msgCount]()
+            {
+                for (std::size_t idx = 0U; idx < msgCount; ++idx) {
+                    session.dataFromBroker(&brokerPublish[0], brokerPublish.size());
+                }
+            });
+
+    if ((ctx->m_toBrokerCount < msgCount) || (ctx->m_toClientCount < msgCount)) {
+        std::cerr << "ERROR: Not all the messages were forwarded" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Session: " << sizeof(mqttsn::gateway::Session) << " bytes + " <<
+        sessionBytes << " bytes in " << sessionAllocations << " heap allocations (connected)\n";
+    std::cout << "Messages: " << msgCount << " (payload " << PayloadSize << " bytes)\n";
+    std::cout << "Client PUBLISH -> broker: " << toBroker.m_ns << " ns/msg, " << toBroker.m_cycles << " cycles/msg\n";
+    std::cout << "Broker PUBLISH -> client: " << toClient.m_ns << " ns/msg, " << toClient.m_cycles << " cycles/msg" << std::endl;
+    return 0;
+}
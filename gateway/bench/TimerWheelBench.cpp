@@ -0,0 +1,117 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <cstdint>
+#include <cstdlib>
+
+#include "TimerWheel.h"
+
+namespace
+{
+
+typedef mqttsn::gateway::app::udp::TimerWheel TimerWheel;
+typedef std::chrono::steady_clock Clock;
+
+const std::size_t DefaultTimersCount = 100000U;
+const std::size_t RestartsCount = 10000000U;
+
+template <typename TFunc>
+double measureNsPerOp(std::size_t count, TFunc&& func)
+{
+    auto start = Clock::now();
+    func();
+    auto diff = Clock::now() - start;
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(diff).count();
+    return static_cast<double>(ns) / count;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t timersCount = DefaultTimersCount;
+    if (1 < argc) {
+        timersCount = static_cast<std::size_t>(std::strtoul(argv[1], nullptr, 10));
+    }
+
+    unsigned long long fired = 0U;
+    TimerWheel wheel;
+    std::vector<std::unique_ptr<TimerWheel::Timer> > timers;
+    timers.reserve(timersCount);
+    for (std::size_t idx = 0U; idx < timersCount; ++idx) {
+        std::unique_ptr<TimerWheel::Timer> timer(new TimerWheel::Timer);
+        timer->setExpiryCb(
+            [&fired]()
+            {
+                ++fired;
+            });
+        timers.push_back(std::move(timer));
+    }
+
+    // Session timeouts are spread between few ms and several minutes
+    std::mt19937 gen(12345);
+    std::uniform_int_distribution<unsigned> msDist(10U, 300000U);
+    std::uniform_int_distribution<std::size_t> idxDist(0U, timersCount - 1);
+
+    std::vector<unsigned> durations;
+    std::vector<std::size_t> indices;
+    durations.reserve(RestartsCount);
+    indices.reserve(RestartsCount);
+    for (std::size_t idx = 0U; idx < RestartsCount; ++idx) {
+        durations.push_back(msDist(gen));
+        indices.push_back(idxDist(gen));
+    }
+
+    for (std::size_t idx = 0U; idx < timersCount; ++idx) {
+        wheel.start(*timers[idx], durations[idx]);
+    }
+
+    // Every API call on a session cancels its timer and programs new one
+    unsigned long long elapsed = 0U;
+    auto restartNs = measureNsPerOp(RestartsCount,
+        [&wheel, &timers, &durations, &indices, &elapsed]()
+        {
+            for (std::size_t idx = 0U; idx < durations.size(); ++idx) {
+                auto& timer = *timers[indices[idx]];
+                elapsed += wheel.cancel(timer);
+                wheel.start(timer, durations[idx]);
+            }
+        });
+
+    // Expire everything by simulating passage of time in 1 second steps
+    auto now = TimerWheel::nowMs();
+    auto end = now + 301000U;
+    auto advanceSteps = static_cast<std::size_t>((end - now) / 1000U);
+    auto advanceNs = measureNsPerOp(timersCount,
+        [&wheel, now, advanceSteps]()
+        {
+            for (std::size_t step = 1U; step <= advanceSteps; ++step) {
+                wheel.advanceTo(now + (step * 1000U));
+            }
+        });
+
+    std::cout << "Timers: " << timersCount << '\n';
+    std::cout << "Cancel + restart: " << restartNs << " ns/op\n";
+    std::cout << "Expiry: " << advanceNs << " ns/timer\n";
+    std::cout << "Fired: " << fired << ", still active: " << wheel.activeCount() << std::endl;
+    return 0;
+}
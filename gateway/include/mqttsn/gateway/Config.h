@@ -30,6 +30,8 @@
 #include <list>
 #include <utility>
 
+#include "Session.h"
+
 namespace mqttsn
 {
 
@@ -79,6 +81,27 @@ public:
     /// @brief Type of list containing authentication information for multiple clients.
     typedef std::vector<AuthInfo> AuthInfosList;
 
+    /// @brief Address of a single broker
+    struct BrokerInfo
+    {
+        std::string address; ///< TCP/IP address or "unix:<path>"
+        std::uint16_t port = 0; ///< TCP/IP port
+    };
+
+    /// @brief Type of list containing addresses of multiple brokers.
+    typedef std::vector<BrokerInfo> BrokersList;
+
+    /// @brief Route of publishes to a separate broker
+    struct TopicRouteInfo
+    {
+        std::string topicFilter; ///< Topic filter, may contain wildcards
+        std::string address; ///< TCP/IP address of the broker or "unix:<path>"
+        std::uint16_t port = 0; ///< TCP/IP port of the broker
+    };
+
+    /// @brief Type of list containing publish routes.
+    typedef std::vector<TopicRouteInfo> TopicRoutesList;
+
     /// @brief Range of topic IDs
     /// @details First element of the pair is minimal ID, and second
     ///     element of the pair is maximal ID.
@@ -134,6 +157,33 @@ public:
     /// @return Max number of accumulated messages for sleeping clients.
     std::size_t sleepingClientMsgLimit() const;
 
+    /// @brief Get limit for max number of messages published by the client,
+    ///     which are not acknowledged by the broker yet.
+    /// @details Default value is @b 0, which means no limit.
+    /// @return Max number of unacknowledged messages.
+    std::size_t brokerPubInFlightLimit() const;
+
+    /// @brief Get limit for amount of data (in bytes) of messages pending
+    ///     delivery to the client.
+    /// @details Default value is @b 0, which means no limit.
+    std::size_t brokerPubQueueByteLimit() const;
+
+    /// @brief Get amount of data (in bytes) of messages pending delivery to
+    ///     the client to resume reading from the broker.
+    /// @details Default value is half of the value returned by
+    ///     brokerPubQueueByteLimit().
+    std::size_t brokerPubQueueLowWaterMark() const;
+
+    /// @brief Get policy of handling messages from the broker, received when
+    ///     the queue of messages pending delivery to the client is full.
+    /// @details Default value is @ref Session::BrokerPubOverflowPolicy::Block.
+    Session::BrokerPubOverflowPolicy brokerPubOverflowPolicy() const;
+
+    /// @brief Check whether connection to the broker needs to be released
+    ///     while the client is asleep.
+    /// @details Default value is @b false.
+    bool sleepingClientReleaseBroker() const;
+
     /// @brief Get access to the list of predefined topics.
     const PredefinedTopicsList& predefinedTopics() const;
 
@@ -152,6 +202,21 @@ public:
     /// @details Default value is @b 1883
     std::uint16_t brokerTcpHostPort() const;
 
+    /// @brief Get addresses of all the configured brokers.
+    /// @details Multiple brokers may be specified using multiple
+    ///     "mqttsn_broker" options, they are listed in order of their
+    ///     appearance in the configuration. The first one is the one
+    ///     reported by brokerTcpHostAddress() and brokerTcpHostPort().
+    ///     If none is specified, the list contains single entry with
+    ///     default address and port.
+    const BrokersList& brokers() const;
+
+    /// @brief Get routes of client publishes to separate brokers.
+    /// @details Specified using multiple "mqttsn_topic_route" options,
+    ///     listed in order of their appearance in the configuration.
+    ///     Empty by default.
+    const TopicRoutesList& topicRoutes() const;
+
 private:
     std::unique_ptr<ConfigImpl> m_pImpl;
 };
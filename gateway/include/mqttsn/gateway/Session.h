@@ -24,6 +24,7 @@
 #include <functional>
 #include <cstdint>
 #include <vector>
+#include <limits>
 
 namespace mqttsn
 {
@@ -48,6 +49,15 @@ public:
     ///     second element of the pair is binary @b password.
     typedef std::pair<std::string, BinaryData> AuthInfo;
 
+    /// @brief Type of the monotonic time value in @b milliseconds, provided
+    ///     by the driving code when the session is driven by deadlines
+    ///     (see start(Timestamp)).
+    typedef unsigned long long Timestamp;
+
+    /// @brief Value returned by nextDeadline() when no time measurement
+    ///     is required.
+    static const Timestamp NoDeadline = std::numeric_limits<Timestamp>::max();
+
     /// @brief Type of callback, used to request new time measurement.
     /// @details When the requested time is due, the driving code is expected
     ///     to call tick() member function.
@@ -68,6 +78,33 @@ public:
     /// @param[in] bufSize Number of bytes in the buffer
     typedef std::function<void (const std::uint8_t* buf, std::size_t bufSize)> SendDataReqCb;
 
+    /// @brief Type of callback, used to request delivery of serialised message
+    ///     to the broker via one of the route connections (see addBrokerRoute()).
+    /// @param[in] route Index of the route.
+    /// @param[in] buf Buffer containing serialised message.
+    /// @param[in] bufSize Number of bytes in the buffer
+    typedef std::function<void (unsigned route, const std::uint8_t* buf, std::size_t bufSize)> SendDataRouteReqCb;
+
+    /// @brief Type of callback, used to request delivery of PUBLISH message
+    ///     to the broker as a scatter-gather list of two buffers.
+    /// @details The serialised message is the header followed by the payload.
+    ///     The payload buffer points directly into the data received from
+    ///     the client. The header buffer is valid only during the callback
+    ///     execution, the payload buffer is valid as long as the buffer
+    ///     passed to dataFromClient().
+    /// @param[in] header Buffer containing serialised fixed header, topic and packet ID.
+    /// @param[in] headerSize Number of bytes in the header buffer.
+    /// @param[in] payload Buffer containing the payload, may be nullptr
+    ///     when @b payloadSize is 0.
+    /// @param[in] payloadSize Number of bytes in the payload buffer.
+    typedef std::function<
+        void (
+            const std::uint8_t* header,
+            std::size_t headerSize,
+            const std::uint8_t* payload,
+            std::size_t payloadSize)
+    > SendPublishReqCb;
+
     /// @brief Type of callback, used to request session termination.
     /// @details When the callback is invoked, the driving code must flush
     ///     all the previously sent messages to appropriate I/O links and
@@ -79,6 +116,35 @@ public:
     ///     existing TCP/IP connection to the broker and create a new one.
     typedef std::function<void ()> BrokerReconnectReqCb;
 
+    /// @brief Type of callback used to request disconnection from the broker.
+    /// @details When the callback is invoked, the driving code must close
+    ///     existing TCP/IP connection to the broker and not to open a new
+    ///     one until requested via @ref BrokerReconnectReqCb.
+    typedef std::function<void ()> BrokerDisconnectReqCb;
+
+    /// @brief Type of callback used to request the driving code to pause or
+    ///     resume reading of the data from the broker.
+    /// @details While paused, the driving code is expected to stop reading
+    ///     from the TCP/IP connection to the broker, letting the flow control
+    ///     of the TCP/IP slow the broker down.
+    /// @param[in] paused @b true to pause, @b false to resume.
+    typedef std::function<void (bool paused)> BrokerInputPauseReqCb;
+
+    /// @brief Type of callback used to report the amount of data (in bytes)
+    ///     accumulated in the queue of messages pending delivery to the client.
+    /// @param[in] bytes Total size of topics and payloads of the queued messages.
+    typedef std::function<void (std::size_t bytes)> BrokerPubQueueReportCb;
+
+    /// @brief Policy of handling messages from the broker, received when the
+    ///     queue of messages pending delivery to the client is full.
+    enum class BrokerPubOverflowPolicy : std::uint8_t
+    {
+        Block, ///< Queue the message, rely on pausing the broker input (default)
+        DropOldest, ///< Drop the oldest queued messages to make room for the new one
+        DropNewest, ///< Drop the new message
+        NumOfValues ///< Number of available values, must be last
+    };
+
     /// @brief Type of callback used to report client ID of the newly connected
     ///     MQTT-SN client.
     /// @details The callback can be used to provide additional client specific
@@ -92,6 +158,54 @@ public:
     /// @return Authentication information
     typedef std::function<AuthInfo (const std::string& clientId)> AuthInfoReqCb;
 
+    /// @brief Information about application message published by the broker.
+    struct BrokerPubInfo
+    {
+        std::string m_topic; ///< Topic the message was published to
+        BinaryData m_msg; ///< Message payload
+        std::uint8_t m_qos = 0U; ///< QoS of the delivery to the client (0 - 2)
+        bool m_retain = false; ///< Retain flag
+        bool m_dup = false; ///< Duplicate flag
+    };
+
+    /// @brief Pointer to immutable @ref BrokerPubInfo, which can be shared
+    ///     between multiple sessions.
+    typedef std::shared_ptr<const BrokerPubInfo> BrokerPubInfoPtr;
+
+    /// @brief Type of callback used to report application message received
+    ///     from the broker instead of delivering it to the client.
+    /// @param[in] info Information about received message.
+    typedef std::function<void (BrokerPubInfoPtr info)> BrokerPubReportCb;
+
+    /// @brief Type of callback used to inquire whether the subscription
+    ///     requested by the client is going to be served by the driving code
+    ///     (see addBrokerPub()) instead of being forwarded to the broker.
+    /// @param[in] topic Topic filter, may contain wildcards.
+    /// @param[in] qos Requested max QoS (0 - 2).
+    /// @return @b true if the subscription is served by the driving code,
+    ///     @b false if it needs to be forwarded to the broker.
+    typedef std::function<bool (const std::string& topic, std::uint8_t qos)> SubscribeFanOutReqCb;
+
+    /// @brief Type of callback used to inquire whether the unsubscription
+    ///     requested by the client is going to be served by the driving code
+    ///     instead of being forwarded to the broker.
+    /// @param[in] topic Topic filter, may contain wildcards.
+    /// @return @b true if the subscription was served by the driving code and
+    ///     is removed, @b false if the request needs to be forwarded to the broker.
+    typedef std::function<bool (const std::string& topic)> UnsubscribeFanOutReqCb;
+
+    /// @brief Type of callback used to request the driving code to store
+    ///     the message published by the client, and forward it to the broker
+    ///     on its own.
+    /// @param[in] topic Topic the message is published to.
+    /// @param[in] buf Pointer to the buffer of the message payload.
+    /// @param[in] bufLen Size of the payload.
+    /// @param[in] qos QoS of the message (1 or 2).
+    /// @param[in] retain Retain flag of the message.
+    /// @return @b true if the message was stored, @b false if it needs to
+    ///     be forwarded to the broker by the session itself.
+    typedef std::function<bool (const std::string& topic, const std::uint8_t* buf, std::size_t bufLen, std::uint8_t qos, bool retain)> ClientPubStoreReqCb;
+
     /// @brief Default constructor
     Session();
 
@@ -125,6 +239,23 @@ public:
     /// @param[in] func R-value reference to the callback object
     void setSendDataBrokerReqCb(SendDataReqCb&& func);
 
+    /// @brief Set the callback to be invoked when new data needs to be sent
+    ///     via one of the route connections.
+    /// @details This is an optional callback, it is required only when
+    ///     routes are added using addBrokerRoute().
+    /// @param[in] func R-value reference to the callback object
+    void setSendDataRouteReqCb(SendDataRouteReqCb&& func);
+
+    /// @brief Set the callback to be invoked when PUBLISH message received
+    ///     from the client needs to be forwarded to the broker.
+    /// @details This is an optional callback. When set, the payload of the
+    ///     forwarded message is not copied by the session. Otherwise the
+    ///     message is serialised as a whole and sent using the callback set
+    ///     by setSendDataBrokerReqCb(). The messages forwarded via the route
+    ///     connections are not affected.
+    /// @param[in] func R-value reference to the callback object
+    void setSendPublishBrokerReqCb(SendPublishReqCb&& func);
+
     /// @brief Set the callback to be invoked when the session needs to be
     ///     terminated and this @ref Session object deleted.
     /// @details This is a must have callback, without it the object can not
@@ -139,6 +270,37 @@ public:
     /// @param[in] func R-value reference to the callback object
     void setBrokerReconnectReqCb(BrokerReconnectReqCb&& func);
 
+    /// @brief Set the callback to be invoked when the session needs to close
+    ///     existing TCP/IP connection to the broker without opening a new one.
+    /// @details This is an optional callback, without it the connection of
+    ///     the sleeping client is never released (see setReleaseBrokerWhenAsleep()).
+    ///     When connection is needed again, the request is issued via
+    ///     callback set by setBrokerReconnectReqCb(). In this case
+    ///     there is no existing connection to close.
+    /// @param[in] func R-value reference to the callback object
+    void setBrokerDisconnectReqCb(BrokerDisconnectReqCb&& func);
+
+    /// @brief Set the callback to be invoked when the session needs to pause
+    ///     or resume reading of the data from the broker.
+    /// @details This is an optional callback, without it the broker input
+    ///     is never paused. The input is paused when the queue of messages
+    ///     pending delivery to the client reaches the limits set by
+    ///     setSleepingClientMsgLimit() or setBrokerPubQueueByteLimit(),
+    ///     or when requested by setBrokerInputHeld(), and resumed when the
+    ///     queue is drained below the low-water mark. The callback must not
+    ///     invoke any API function of this object.
+    /// @param[in] func R-value reference to the callback object
+    void setBrokerInputPauseReqCb(BrokerInputPauseReqCb&& func);
+
+    /// @brief Set the callback to be invoked when the amount of data in the
+    ///     queue of messages pending delivery to the client changes.
+    /// @details This is an optional callback, invoked at most once per
+    ///     call to any API function. It allows the driving code to maintain
+    ///     budgets shared between multiple sessions. The callback must not
+    ///     invoke any API function of this object.
+    /// @param[in] func R-value reference to the callback object
+    void setBrokerPubQueueReportCb(BrokerPubQueueReportCb&& func);
+
     /// @brief Set the callback to be invoked when MQTT-SN client is successfully
     ///     connected to the broker.
     /// @details This is an optional callback. It can be used when there is a
@@ -155,6 +317,44 @@ public:
     /// @param[in] func R-value reference to the callback object
     void setAuthInfoReqCb(AuthInfoReqCb&& func);
 
+    /// @brief Set the callback to be used to report application messages
+    ///     received from the broker.
+    /// @details This is an optional callback. When set, the messages published
+    ///     by the broker are acknowledged to the broker, but reported via
+    ///     this callback instead of being delivered to the client. It allows
+    ///     a single session to serve as a source of messages, which are
+    ///     later delivered to multiple clients using addBrokerPub().
+    /// @param[in] func R-value reference to the callback object
+    void setBrokerPubReportCb(BrokerPubReportCb&& func);
+
+    /// @brief Set the callback to be used to inquire whether subscription
+    ///     requested by the client is served by the driving code.
+    /// @details This is an optional callback. When it returns @b true,
+    ///     the subscription is acknowledged to the client without being
+    ///     forwarded to the broker, and the driving code is expected to
+    ///     provide the matching messages using addBrokerPub().
+    /// @param[in] func R-value reference to the callback object
+    void setSubscribeFanOutReqCb(SubscribeFanOutReqCb&& func);
+
+    /// @brief Set the callback to be used to inquire whether unsubscription
+    ///     requested by the client is served by the driving code.
+    /// @details This is an optional callback. When it returns @b true,
+    ///     the unsubscription is acknowledged to the client without being
+    ///     forwarded to the broker.
+    /// @param[in] func R-value reference to the callback object
+    void setUnsubscribeFanOutReqCb(UnsubscribeFanOutReqCb&& func);
+
+    /// @brief Set the callback to be used to request storage of the message
+    ///     published by the client.
+    /// @details This is an optional callback. It is invoked for QoS1 and QoS2
+    ///     messages, which are not sent over any of the topic routes.
+    ///     When it returns @b true, the message is acknowledged to the client
+    ///     right away, even if the connection to the broker is not established
+    ///     at the moment, and the driving code becomes responsible to deliver
+    ///     the message to the broker.
+    /// @param[in] func R-value reference to the callback object
+    void setClientPubStoreReqCb(ClientPubStoreReqCb&& func);
+
     /// @brief Set gateway numeric ID to be reported when requested.
     /// @details If not set, default value 0 is assumed.
     /// @param[in] value Gateway numeric ID.
@@ -184,10 +384,85 @@ public:
     ///     accumulate all the messages the broker sends until client wakes up
     ///     or explicitly requests to send them. This function may be used
     ///     to limit amount of such messages to prevent acquiring lots of
-    ///     RAM by the gateway application.
+    ///     RAM by the gateway application. When the limit is reached, the
+    ///     reading of the data from the broker is paused (see
+    ///     setBrokerInputPauseReqCb()), and the new messages are handled
+    ///     according to the policy set by setBrokerPubOverflowPolicy().
     /// @param[in] value Max number of pending messages.
     void setSleepingClientMsgLimit(std::size_t value);
 
+    /// @brief Provide limit to number of QoS1 and QoS2 messages published by
+    ///     the client, which are forwarded to the broker, but not acknowledged
+    ///     by it yet.
+    /// @details When the limit is reached, the new publishes are rejected
+    ///     with "congestion" return code, and the client is expected to
+    ///     retry later. Retransmissions of the messages already in flight are
+    ///     always forwarded. Value @b 0 means no limit, which is the default.
+    /// @param[in] value Max number of unacknowledged messages.
+    void setBrokerPubInFlightLimit(std::size_t value);
+
+    /// @brief Provide limit to amount of data (in bytes) accumulated in the
+    ///     queue of messages pending delivery to the client.
+    /// @details The size of the message is the size of its topic and payload.
+    ///     When the limit is reached, the reading of the data from the broker
+    ///     is paused (see setBrokerInputPauseReqCb()) until the queue is drained
+    ///     to the low-water mark. The messages received when the queue is full
+    ///     are handled according to the policy set by
+    ///     setBrokerPubOverflowPolicy(). Value @b 0 means no limit, which is
+    ///     the default.
+    /// @param[in] limit Max amount of queued data.
+    /// @param[in] lowWaterMark Amount of queued data to resume reading from
+    ///     the broker, expected to be less than @b limit.
+    void setBrokerPubQueueByteLimit(std::size_t limit, std::size_t lowWaterMark);
+
+    /// @brief Set policy of handling messages from the broker, received when
+    ///     the queue of messages pending delivery to the client is full.
+    /// @details The queue is full when the limit set by either
+    ///     setSleepingClientMsgLimit() or setBrokerPubQueueByteLimit() is reached.
+    ///     Default policy is @ref BrokerPubOverflowPolicy::Block, i.e.
+    ///     no message is dropped. Without the callback set by
+    ///     setBrokerInputPauseReqCb() the reading from the broker can't be
+    ///     paused, and the @ref BrokerPubOverflowPolicy::Block policy
+    ///     behaves as @ref BrokerPubOverflowPolicy::DropOldest.
+    /// @param[in] value Policy value.
+    void setBrokerPubOverflowPolicy(BrokerPubOverflowPolicy value);
+
+    /// @brief Hold (pause) the reading of the data from the broker regardless
+    ///     of the amount of queued messages.
+    /// @details Allows the driving code to apply budgets shared between
+    ///     multiple sessions. The pause is requested using the callback set by
+    ///     setBrokerInputPauseReqCb().
+    /// @param[in] value @b true to hold, @b false to release.
+    void setBrokerInputHeld(bool value);
+
+    /// @brief Get amount of data (in bytes) in the queue of messages pending
+    ///     delivery to the client.
+    std::size_t brokerPubQueueBytes() const;
+
+    /// @brief Get ID of the connected client.
+    /// @return Client ID of the last accepted connection, empty string if
+    ///     there was none.
+    const std::string& clientId() const;
+
+    /// @brief Check whether the client requested clean session in its
+    ///     last accepted connection.
+    /// @details Valid already when the callback set by
+    ///     setClientConnectedReportCb() is invoked.
+    bool isCleanSession() const;
+
+    /// @brief Enable or disable release of the broker connection while the
+    ///     client is asleep.
+    /// @details When enabled and the client with persistent (non-clean)
+    ///     session enters the "ASLEEP" state, the session disconnects from
+    ///     the broker instead of keeping the connection alive on behalf of
+    ///     the client, leaving the messages published to the client to
+    ///     the persistent session of the broker. The connection
+    ///     is re-established when the client wakes up (sends @b PINGREQ) or
+    ///     connects again. Requires callback set by setBrokerDisconnectReqCb().
+    ///     Disabled by default.
+    /// @param[in] value Enable / disable flag.
+    void setReleaseBrokerWhenAsleep(bool value);
+
     /// @brief Provide default client ID for clients that report empty one
     ///     in their attempt to connect.
     /// @param[in] value Default client ID string.
@@ -212,6 +487,19 @@ public:
     ///     case some necessary callback hasn't been set.
     bool start();
 
+    /// @brief Start this object's operation driven by deadlines.
+    /// @details Alternative to start(). The time measurement callbacks
+    ///     (see setNextTickProgramReqCb() and setCancelTickWaitReqCb())
+    ///     are not required and not invoked. Instead the driving code provides
+    ///     the current time to tick(Timestamp), dataFromClient(const std::uint8_t*, std::size_t, Timestamp)
+    ///     and dataFromBroker(const std::uint8_t*, std::size_t, Timestamp),
+    ///     and checks nextDeadline() after every call to this object.
+    ///     The rest of the calls use the time provided by the last of them.
+    /// @param[in] now Current time of the monotonic clock.
+    /// @return true if the operation has been successfully started, false in
+    ///     case some necessary callback hasn't been set.
+    bool start(Timestamp now);
+
     /// @brief Stop the operation of the object
     void stop();
 
@@ -224,6 +512,22 @@ public:
     ///     the requested time measurement has expired.
     void tick();
 
+    /// @brief Notify the @ref Session object about reaching the deadline.
+    /// @details Applicable when the object's operation is driven by deadlines
+    ///     (see start(Timestamp)). Needs to be called when the time reported
+    ///     by nextDeadline() is due. Calling it earlier does no harm.
+    ///     Otherwise equivalent to tick().
+    /// @param[in] now Current time of the monotonic clock.
+    void tick(Timestamp now);
+
+    /// @brief Get time of the next required call to tick(Timestamp).
+    /// @details Applicable when the object's operation is driven by deadlines
+    ///     (see start(Timestamp)). The value may change after any call to
+    ///     this object.
+    /// @return Time of the monotonic clock, NoDeadline in case
+    ///     no time measurement is required.
+    Timestamp nextDeadline() const;
+
     /// @brief Provide data received from the client for processing.
     /// @details This call may cause invocation of some callbacks, such as
     ///     request to cancel the currently running time measurement,
@@ -235,6 +539,16 @@ public:
     ///     can be removed from the holding buffer.
     std::size_t dataFromClient(const std::uint8_t* buf, std::size_t len);
 
+    /// @brief Provide data received from the client for processing together
+    ///     with the time of its reception.
+    /// @details Applicable when the object's operation is driven by deadlines
+    ///     (see start(Timestamp)). Otherwise the time is ignored.
+    /// @param[in] buf Pointer to the buffer of data to process.
+    /// @param[in] len Number of bytes in the data buffer.
+    /// @param[in] now Current time of the monotonic clock.
+    /// @return Number of processed bytes.
+    std::size_t dataFromClient(const std::uint8_t* buf, std::size_t len, Timestamp now);
+
     /// @brief Provide data received from the broker for processing.
     /// @details This call may cause invocation of some callbacks, such as
     ///     request to cancel the currently running time measurement,
@@ -246,6 +560,25 @@ public:
     ///     can be removed from the holding buffer.
     std::size_t dataFromBroker(const std::uint8_t* buf, std::size_t len);
 
+    /// @brief Provide data received from the broker for processing together
+    ///     with the time of its reception.
+    /// @details Applicable when the object's operation is driven by deadlines
+    ///     (see start(Timestamp)). Otherwise the time is ignored.
+    /// @param[in] buf Pointer to the buffer of data to process.
+    /// @param[in] len Number of bytes in the data buffer.
+    /// @param[in] now Current time of the monotonic clock.
+    /// @return Number of processed bytes.
+    std::size_t dataFromBroker(const std::uint8_t* buf, std::size_t len, Timestamp now);
+
+    /// @brief Provide data received via the route connection for processing.
+    /// @details Similar to dataFromBroker(), but for the connection opened
+    ///     for the route added by addBrokerRoute().
+    /// @param[in] route Index of the route.
+    /// @param[in] buf Pointer to the buffer of data to process.
+    /// @param[in] len Number of bytes in the data buffer.
+    /// @return Number of processed bytes.
+    std::size_t dataFromRoute(unsigned route, const std::uint8_t* buf, std::size_t len);
+
     /// @brief Notify the @ref Session object about broker being connected / disconnected
     /// @details The report of broker being connected or disconnected must
     ///     be performed only when the session's operation has been successfully
@@ -254,6 +587,15 @@ public:
     /// @param[in] conneted Connection status - @b true means connected, @b false disconnected.
     void setBrokerConnected(bool connected);
 
+    /// @brief Notify the @ref Session object about route connection being
+    ///     connected / disconnected.
+    /// @details When connected, the session establishes MQTT connection
+    ///     on behalf of the client, after the client is connected to the
+    ///     main broker.
+    /// @param[in] route Index of the route.
+    /// @param[in] connected Connection status.
+    void setRouteConnected(unsigned route, bool connected);
+
     /// @brief Add predefined topic string and ID information.
     /// @param[in] topic Topic string
     /// @param[in] topicId Numeric topic ID.
@@ -266,6 +608,28 @@ public:
     /// @return success/failure status
     bool setTopicIdAllocationRange(std::uint16_t minVal, std::uint16_t maxVal);
 
+    /// @brief Deliver application message to the connected client.
+    /// @details The message is queued and delivered to the client the same
+    ///     way as messages published by the broker via the session's own
+    ///     connection. The same message object may be shared between multiple
+    ///     sessions without copying.
+    /// @param[in] info Information about the message.
+    void addBrokerPub(BrokerPubInfoPtr info);
+
+    /// @brief Add route of the client's publishes to a separate broker connection.
+    /// @details Messages published by the client to the topics matching
+    ///     the filter are forwarded via the route connection instead of the
+    ///     main broker connection, while subscriptions and the will stay on
+    ///     the latter. The routes get indices in the order of their addition,
+    ///     starting from @b 0. The first route, the filter of which
+    ///     matches the topic, is used. When the route connection is not
+    ///     available, the publish is forwarded to the main broker.
+    ///     The driving code is responsible to open TCP/IP connection for
+    ///     every route, and report it using setRouteConnected().
+    /// @param[in] topicFilter Topic filter, may contain wildcards.
+    /// @return success/failure status
+    bool addBrokerRoute(const std::string& topicFilter);
+
 private:
     std::unique_ptr<SessionImpl> m_pImpl;
 };
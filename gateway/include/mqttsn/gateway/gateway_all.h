@@ -162,6 +162,34 @@ typedef unsigned (*MqttsnSessionCancelTickReqCb)(void* userData);
 /// @param[in] bufLen Number of bytes in the buffer
 typedef void (*MqttsnSessionSendDataReqCb)(void* userData, const unsigned char* buf, unsigned bufLen);
 
+/// @brief Type of callback, used to request delivery of PUBLISH message
+///     to the broker as a scatter-gather list of two buffers.
+/// @details The serialised message is the header followed by the payload.
+///     The payload buffer points directly into the data received from
+///     the client. The header buffer is valid only during the callback
+///     execution, the payload buffer is valid as long as the buffer passed
+///     to mqttsn_gw_session_data_from_client().
+/// @param[in] userData User data passed as the last parameter to the setting function.
+/// @param[in] header Buffer containing serialised fixed header, topic and packet ID.
+/// @param[in] headerLen Number of bytes in the header buffer.
+/// @param[in] payload Buffer containing the payload, may be NULL when
+///     @b payloadLen is 0.
+/// @param[in] payloadLen Number of bytes in the payload buffer.
+typedef void (*MqttsnSessionSendPublishReqCb)(
+    void* userData,
+    const unsigned char* header,
+    unsigned headerLen,
+    const unsigned char* payload,
+    unsigned payloadLen);
+
+/// @brief Type of callback, used to request delivery of serialised message
+///     to the broker via the route connection.
+/// @param[in] userData User data passed as the last parameter to the setting function.
+/// @param[in] route Index of the route.
+/// @param[in] buf Buffer containing serialised message.
+/// @param[in] bufLen Number of bytes in the buffer
+typedef void (*MqttsnSessionSendDataRouteReqCb)(void* userData, unsigned route, const unsigned char* buf, unsigned bufLen);
+
 /// @brief Type of callback, used to request session termination.
 /// @details When the callback is invoked, the driving code must flush
 ///     all the previously sent messages to appropriate I/O links and
@@ -175,6 +203,28 @@ typedef void (*MqttsnSessionTermReqCb)(void* userData);
 /// @param[in] userData User data passed as the last parameter to the setting function.
 typedef void (*MqttsnSessionBrokerReconnectReqCb)(void* userData);
 
+/// @brief Type of callback used to request disconnection from the broker.
+/// @details When the callback is invoked, the driving code must close
+///     existing TCP/IP connection to the broker and not to open a new one
+///     until requested via @ref MqttsnSessionBrokerReconnectReqCb callback.
+/// @param[in] userData User data passed as the last parameter to the setting function.
+typedef void (*MqttsnSessionBrokerDisconnectReqCb)(void* userData);
+
+/// @brief Type of callback used to request pause or resume of reading
+///     the data from the broker.
+/// @details While paused, the driving code is expected to stop reading
+///     from the TCP/IP connection to the broker, letting the flow control
+///     of the TCP/IP slow the broker down.
+/// @param[in] userData User data passed as the last parameter to the setting function.
+/// @param[in] paused @b true to pause, @b false to resume.
+typedef void (*MqttsnSessionBrokerInputPauseReqCb)(void* userData, bool paused);
+
+/// @brief Type of callback used to report amount of data (in bytes) in the
+///     queue of messages pending delivery to the client.
+/// @param[in] userData User data passed as the last parameter to the setting function.
+/// @param[in] bytes Total size of topics and payloads of the queued messages.
+typedef void (*MqttsnSessionBrokerPubQueueReportCb)(void* userData, unsigned bytes);
+
 /// @brief Type of callback used to report client ID of the newly connected
 ///     MQTT-SN client.
 /// @details The callback can be used to provide additional client specific
@@ -260,6 +310,34 @@ void mqttsn_gw_session_set_send_data_to_broker_cb(
     MqttsnSessionSendDataReqCb cb,
     void* data);
 
+/// @brief Set the callback to be invoked when new data needs to be sent
+///     via the @b route connection.
+/// @details This is an optional callback, required only when routes are
+///     added using mqttsn_gw_session_add_broker_route().
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] cb Pointer to callback function
+/// @param[in] data Pointer to any user data, will be passed back as first
+///     parameter to the callback.
+void mqttsn_gw_session_set_send_data_to_route_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionSendDataRouteReqCb cb,
+    void* data);
+
+/// @brief Set the callback to be invoked when PUBLISH message received from
+///     the @b client needs to be forwarded to the @b broker.
+/// @details This is an optional callback. When set, the payload of the
+///     forwarded message is not copied by the session. Otherwise the message
+///     is serialised as a whole and sent using the callback set by
+///     mqttsn_gw_session_set_send_data_to_broker_cb().
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] cb Pointer to callback function
+/// @param[in] data Pointer to any user data, will be passed back as first
+///     parameter to the callback.
+void mqttsn_gw_session_set_send_publish_to_broker_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionSendPublishReqCb cb,
+    void* data);
+
 /// @brief Set the callback to be invoked when the @b Session needs to be
 ///     terminated and the calling @b Session object deleted.
 /// @details This is a must have callback, without it the object can not
@@ -286,6 +364,47 @@ void mqttsn_gw_session_set_broker_reconnect_req_cb(
     MqttsnSessionBrokerReconnectReqCb cb,
     void* data);
 
+/// @brief Set the callback to be invoked when the @b Session needs to close
+///     existing TCP/IP connection to the broker without opening a new one.
+/// @details This is an optional callback, without it the connection of
+///     the sleeping client is never released
+///     (see mqttsn_gw_session_set_release_broker_when_asleep()).
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] cb Pointer to callback function
+/// @param[in] data Pointer to any user data, will be passed back as first
+///     parameter to the callback.
+void mqttsn_gw_session_set_broker_disconnect_req_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerDisconnectReqCb cb,
+    void* data);
+
+/// @brief Set the callback to be invoked when the @b Session needs to pause
+///     or resume reading of the data from the broker.
+/// @details This is an optional callback, without it the broker input
+///     is never paused. The callback must not invoke any of the
+///     mqttsn_gw_session_* functions.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] cb Pointer to callback function
+/// @param[in] data Pointer to any user data, will be passed back as first
+///     parameter to the callback.
+void mqttsn_gw_session_set_broker_input_pause_req_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerInputPauseReqCb cb,
+    void* data);
+
+/// @brief Set the callback to be invoked when amount of data in the queue
+///     of messages pending delivery to the client changes.
+/// @details This is an optional callback. The callback must not invoke any
+///     of the mqttsn_gw_session_* functions.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] cb Pointer to callback function
+/// @param[in] data Pointer to any user data, will be passed back as first
+///     parameter to the callback.
+void mqttsn_gw_session_set_broker_pub_queue_report_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerPubQueueReportCb cb,
+    void* data);
+
 /// @brief Set the callback to be invoked when MQTT-SN client is successfully
 ///     connected to the broker.
 /// @details This is an optional callback. It can be used when there is a
@@ -353,6 +472,69 @@ void mqttsn_gw_session_set_sleeping_client_msg_limit(
     MqttsnSessionHandle session,
     unsigned value);
 
+/// @brief Provide limit to number of QoS1 and QoS2 messages published by
+///     the client, which are forwarded to the broker, but not acknowledged
+///     by it yet.
+/// @details When the limit is reached, the new publishes are rejected
+///     with "congestion" return code. Value @b 0 means no limit,
+///     which is the default.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] value Max number of unacknowledged messages.
+void mqttsn_gw_session_set_broker_pub_inflight_limit(
+    MqttsnSessionHandle session,
+    unsigned value);
+
+/// @brief Provide limit to amount of data (in bytes) accumulated in the
+///     queue of messages pending delivery to the client.
+/// @details When the limit is reached, the reading of the data from the
+///     broker is paused (see mqttsn_gw_session_set_broker_input_pause_req_cb())
+///     until the queue is drained to the low-water mark. Value @b 0 means
+///     no limit, which is the default.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] limit Max amount of queued data.
+/// @param[in] lowWaterMark Amount of queued data to resume reading from
+///     the broker.
+void mqttsn_gw_session_set_broker_pub_queue_byte_limit(
+    MqttsnSessionHandle session,
+    unsigned limit,
+    unsigned lowWaterMark);
+
+/// @brief Set policy of handling messages from the broker, received when
+///     the queue of messages pending delivery to the client is full.
+/// @details Supported values are: @b 0 - queue the message and rely on
+///     pausing the broker input (default), @b 1 - drop the oldest queued
+///     messages, @b 2 - drop the new message. Without the callback set by
+///     mqttsn_gw_session_set_broker_input_pause_req_cb() the value @b 0
+///     behaves as @b 1.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] value Policy value.
+void mqttsn_gw_session_set_broker_pub_overflow_policy(
+    MqttsnSessionHandle session,
+    unsigned value);
+
+/// @brief Hold (pause) the reading of the data from the broker regardless
+///     of the amount of queued messages.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] value @b true to hold, @b false to release.
+void mqttsn_gw_session_set_broker_input_held(
+    MqttsnSessionHandle session,
+    bool value);
+
+/// @brief Enable or disable release of the broker connection while the
+///     client is asleep.
+/// @details When enabled and the client with persistent (non-clean)
+///     session enters the "ASLEEP" state, the session disconnects from
+///     the broker, leaving the messages published to the client to
+///     the persistent session of the broker. The connection
+///     is re-established when the client wakes up or connects again.
+///     Requires callback set by mqttsn_gw_session_set_broker_disconnect_req_cb().
+///     Disabled by default.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] value Enable / disable flag.
+void mqttsn_gw_session_set_release_broker_when_asleep(
+    MqttsnSessionHandle session,
+    bool value);
+
 /// @brief Provide default client ID for clients that report empty one
 ///     in their attempt to connect.
 /// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
@@ -380,6 +562,20 @@ void mqttsn_gw_session_set_pub_only_keep_alive(MqttsnSessionHandle session, unsi
 ///     case some necessary callback hasn't been set.
 bool mqttsn_gw_session_start(MqttsnSessionHandle session);
 
+/// @brief Start the @b Session's object's operation driven by deadlines.
+/// @details Alternative to mqttsn_gw_session_start(). The callbacks set by
+///     mqttsn_gw_session_set_tick_req_cb() and mqttsn_gw_session_set_cancel_tick_cb()
+///     are not required and not invoked. Instead the driving code provides
+///     the current time to mqttsn_gw_session_tick_at(),
+///     mqttsn_gw_session_data_from_client_at() and mqttsn_gw_session_data_from_broker_at(),
+///     and checks mqttsn_gw_session_next_deadline() after every call to the
+///     @b Session object.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] now Current time of the monotonic clock in @b milliseconds.
+/// @return true if the operation has been successfully started, false in
+///     case some necessary callback hasn't been set.
+bool mqttsn_gw_session_start_with_deadlines(MqttsnSessionHandle session, unsigned long long now);
+
 /// @brief Stop the operation of the @b Session object.
 /// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
 void mqttsn_gw_session_stop(MqttsnSessionHandle session);
@@ -390,6 +586,21 @@ void mqttsn_gw_session_stop(MqttsnSessionHandle session);
 /// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
 void mqttsn_gw_session_tick(MqttsnSessionHandle session);
 
+/// @brief Notify the @b Session object about reaching the deadline.
+/// @details Applicable when the operation is driven by deadlines
+///     (see mqttsn_gw_session_start_with_deadlines()).
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] now Current time of the monotonic clock in @b milliseconds.
+void mqttsn_gw_session_tick_at(MqttsnSessionHandle session, unsigned long long now);
+
+/// @brief Get time of the next required call to mqttsn_gw_session_tick_at().
+/// @details Applicable when the operation is driven by deadlines
+///     (see mqttsn_gw_session_start_with_deadlines()).
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @return Time of the monotonic clock in @b milliseconds, maximal value of
+///     unsigned long long type in case no time measurement is required.
+unsigned long long mqttsn_gw_session_next_deadline(MqttsnSessionHandle session);
+
 /// @brief Provide data received from the @b client for processing.
 /// @details This call may cause invocation of some callbacks, such as
 ///     request to cancel the currently running time measurement,
@@ -405,6 +616,22 @@ unsigned mqttsn_gw_session_data_from_client(
     const unsigned char* buf,
     unsigned bufLen);
 
+/// @brief Provide data received from the @b client for processing together
+///     with the time of its reception.
+/// @details Applicable when the operation is driven by deadlines
+///     (see mqttsn_gw_session_start_with_deadlines()), otherwise the time
+///     is ignored.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] buf Pointer to the buffer of data to process.
+/// @param[in] len Number of bytes in the data buffer.
+/// @param[in] now Current time of the monotonic clock in @b milliseconds.
+/// @return Number of processed bytes.
+unsigned mqttsn_gw_session_data_from_client_at(
+    MqttsnSessionHandle session,
+    const unsigned char* buf,
+    unsigned bufLen,
+    unsigned long long now);
+
 /// @brief Provide data received from the @b broker for processing.
 /// @details This call may cause invocation of some callbacks, such as
 ///     request to cancel the currently running time measurement,
@@ -420,6 +647,22 @@ unsigned mqttsn_gw_session_data_from_broker(
     const unsigned char* buf,
     unsigned bufLen);
 
+/// @brief Provide data received from the @b broker for processing together
+///     with the time of its reception.
+/// @details Applicable when the operation is driven by deadlines
+///     (see mqttsn_gw_session_start_with_deadlines()), otherwise the time
+///     is ignored.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] buf Pointer to the buffer of data to process.
+/// @param[in] len Number of bytes in the data buffer.
+/// @param[in] now Current time of the monotonic clock in @b milliseconds.
+/// @return Number of processed bytes.
+unsigned mqttsn_gw_session_data_from_broker_at(
+    MqttsnSessionHandle session,
+    const unsigned char* buf,
+    unsigned bufLen,
+    unsigned long long now);
+
 /// @brief Notify the @b Session object about broker being connected / disconnected
 /// @details The report of broker being connected or disconnected must
 ///     be performed only when the session's operation has been successfully
@@ -429,6 +672,38 @@ unsigned mqttsn_gw_session_data_from_broker(
 /// @param[in] conneted Connection status - @b true means connected, @b false disconnected.
 void mqttsn_gw_session_broker_connected(MqttsnSessionHandle session, bool connected);
 
+/// @brief Provide data received via the @b route connection for processing.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] route Index of the route.
+/// @param[in] buf Pointer to the buffer of data to process.
+/// @param[in] len Number of bytes in the data buffer.
+/// @return Number of processed bytes.
+unsigned mqttsn_gw_session_data_from_route(
+    MqttsnSessionHandle session,
+    unsigned route,
+    const unsigned char* buf,
+    unsigned bufLen);
+
+/// @brief Notify the @b Session object about route connection being
+///     connected / disconnected
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] route Index of the route.
+/// @param[in] conneted Connection status - @b true means connected, @b false disconnected.
+void mqttsn_gw_session_route_connected(
+    MqttsnSessionHandle session,
+    unsigned route,
+    bool connected);
+
+/// @brief Add route of the client's publishes to a separate broker connection.
+/// @details The routes get indices in the order of their addition, starting
+///     from @b 0.
+/// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
+/// @param[in] topicFilter Topic filter, may contain wildcards.
+/// @return success/failure status
+bool mqttsn_gw_session_add_broker_route(
+    MqttsnSessionHandle session,
+    const char* topicFilter);
+
 /// @brief Add predefined topic string and ID information.
 /// @param[in] session Handle returned by mqttsn_gw_session_alloc() function.
 /// @param[in] topic Topic string
@@ -459,6 +734,21 @@ typedef struct
     unsigned short topicId; ///< Numeric topic ID
 } MqttsnPredefinedTopicInfo;
 
+/// @brief Address of a single broker.
+typedef struct
+{
+    const char* address; ///< TCP/IP address or "unix:<path>"
+    unsigned short port; ///< TCP/IP port
+} MqttsnBrokerInfo;
+
+/// @brief Route of publishes to a separate broker.
+typedef struct
+{
+    const char* topicFilter; ///< Topic filter, may contain wildcards
+    const char* address; ///< TCP/IP address of the broker
+    unsigned short port; ///< TCP/IP port of the broker
+} MqttsnTopicRouteInfo;
+
 /// @brief Authentication infor for a single client.
 typedef struct
 {
@@ -540,6 +830,43 @@ unsigned mqttsn_gw_config_pub_only_keep_alive(MqttsnConfigHandle config);
 /// @return Max number of accumulated messages for sleeping clients.
 unsigned mqttsn_gw_config_sleeping_client_msg_limit(MqttsnConfigHandle config);
 
+/// @brief Get limit for max number of messages published by the client,
+///     which are not acknowledged by the broker yet.
+/// @details Default value is @b 0, which means no limit.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @return Max number of unacknowledged messages.
+unsigned mqttsn_gw_config_broker_pub_inflight_limit(MqttsnConfigHandle config);
+
+/// @brief Get limit for amount of data (in bytes) of messages pending
+///     delivery to the client.
+/// @details Default value is @b 0, which means no limit.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @return Max amount of queued data.
+unsigned mqttsn_gw_config_broker_pub_queue_byte_limit(MqttsnConfigHandle config);
+
+/// @brief Get amount of data (in bytes) of messages pending delivery to
+///     the client to resume reading from the broker.
+/// @details Default value is half of the value returned by
+///     mqttsn_gw_config_broker_pub_queue_byte_limit().
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @return Low-water mark of queued data.
+unsigned mqttsn_gw_config_broker_pub_queue_low_water_mark(MqttsnConfigHandle config);
+
+/// @brief Get policy of handling messages from the broker, received when
+///     the queue of messages pending delivery to the client is full.
+/// @details See mqttsn_gw_session_set_broker_pub_overflow_policy() for
+///     supported values. Default value is @b 0.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @return Policy value.
+unsigned mqttsn_gw_config_broker_pub_overflow_policy(MqttsnConfigHandle config);
+
+/// @brief Check whether connection to the broker needs to be released while
+///     the client is asleep.
+/// @details Default value is @b false.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @return Enable / disable flag.
+bool mqttsn_gw_config_sleeping_client_release_broker(MqttsnConfigHandle config);
+
 /// @brief Get number of available predefined topic IDs.
 /// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
 unsigned mqttsn_gw_config_available_predefined_topics(MqttsnConfigHandle config);
@@ -588,6 +915,36 @@ const char* mqttsn_gw_config_broker_address(MqttsnConfigHandle config);
 /// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
 unsigned short mqttsn_gw_config_broker_port(MqttsnConfigHandle config);
 
+/// @brief Get number of configured brokers.
+/// @details Multiple brokers may be specified using multiple "mqttsn_broker"
+///     options, there is always at least one.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+unsigned mqttsn_gw_config_available_brokers(MqttsnConfigHandle config);
+
+/// @brief Read addresses of the configured brokers into a buffer.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @param[out] buf Buffer to write information into
+/// @param[in] bufLen Max number of element to write into the buffer.
+/// @return Actual number of elements that have been written into a buffer.
+unsigned mqttsn_gw_config_get_brokers(
+    MqttsnConfigHandle config,
+    MqttsnBrokerInfo* buf,
+    unsigned bufLen);
+
+/// @brief Get number of configured routes of publishes to separate brokers.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+unsigned mqttsn_gw_config_available_topic_routes(MqttsnConfigHandle config);
+
+/// @brief Read configured routes of publishes into a buffer.
+/// @param[in] config Handle returned by mqttsn_gw_config_alloc() function.
+/// @param[out] buf Buffer to write information into
+/// @param[in] bufLen Max number of element to write into the buffer.
+/// @return Actual number of elements that have been written into a buffer.
+unsigned mqttsn_gw_config_get_topic_routes(
+    MqttsnConfigHandle config,
+    MqttsnTopicRouteInfo* buf,
+    unsigned bufLen);
+
 /// @brief Get number of available configuration values for the provided key
 /// @details The key is the first word in the configuration line, and the
 ///     value is rest of the string until the end of the line.
@@ -0,0 +1,260 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BrokerConnPool.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const int RetryPeriodMs = 1000;
+
+}  // namespace
+
+BrokerConnPool::BrokerConnPool(
+    const std::string& host,
+    PortType port,
+    std::size_t size,
+    unsigned maxIdleSec,
+    QObject* parent)
+  : Base(parent),
+    m_host(host),
+    m_port(port),
+    m_size(size),
+    m_maxIdle(std::chrono::seconds(maxIdleSec))
+{
+    m_entries.reserve(size);
+
+    m_retryTimer.setSingleShot(true);
+    connect(
+        &m_retryTimer, SIGNAL(timeout()),
+        this, SLOT(refill()));
+
+    connect(
+        &m_idleTimer, SIGNAL(timeout()),
+        this, SLOT(recycleIdle()));
+}
+
+BrokerConnPool::~BrokerConnPool()
+{
+    for (auto& entry : m_entries) {
+        entry.m_socket->blockSignals(true);
+        entry.m_socket->abort();
+    }
+}
+
+void BrokerConnPool::start()
+{
+    refill();
+
+    if (m_maxIdle != Clock::duration::zero()) {
+        auto periodMs = std::chrono::duration_cast<std::chrono::milliseconds>(m_maxIdle).count() / 2;
+        m_idleTimer.start(static_cast<int>(std::max<decltype(periodMs)>(periodMs, RetryPeriodMs)));
+    }
+}
+
+BrokerConnPool::SocketPtr BrokerConnPool::take()
+{
+    auto iter =
+        std::find_if(
+            m_entries.begin(), m_entries.end(),
+            [](const Entry& entry) -> bool
+            {
+                return
+                    entry.m_connected &&
+                    (entry.m_socket->state() == QTcpSocket::ConnectedState);
+            });
+
+    if (iter == m_entries.end()) {
+        ++m_misses;
+        refill();
+        return SocketPtr();
+    }
+
+    ++m_hits;
+    auto socket = std::move(iter->m_socket);
+    m_entries.erase(iter);
+    socket->disconnect(this);
+    refill();
+    return socket;
+}
+
+std::size_t BrokerConnPool::readyCount() const
+{
+    return
+        static_cast<std::size_t>(
+            std::count_if(
+                m_entries.begin(), m_entries.end(),
+                [](const Entry& entry) -> bool
+                {
+                    return entry.m_connected;
+                }));
+}
+
+unsigned BrokerConnPool::avgRefillLatencyMs() const
+{
+    if (m_refillCount == 0U) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>((m_refillTotalUs / m_refillCount) / 1000U);
+}
+
+void BrokerConnPool::socketConnected()
+{
+    auto iter = findEntry(sender());
+    if (iter == m_entries.end()) {
+        return;
+    }
+
+    auto now = Clock::now();
+    auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - iter->m_timestamp).count();
+    ++m_refillCount;
+    m_refillTotalUs += static_cast<unsigned long long>(latency);
+    iter->m_connected = true;
+    iter->m_timestamp = now;
+}
+
+void BrokerConnPool::socketDisconnected()
+{
+    auto iter = findEntry(sender());
+    if (iter == m_entries.end()) {
+        return;
+    }
+
+    // Idle connection closed by the broker
+    dropEntry(iter);
+    scheduleRefill();
+}
+
+void BrokerConnPool::socketErrorOccurred(QAbstractSocket::SocketError err)
+{
+    static_cast<void>(err);
+    auto iter = findEntry(sender());
+    if (iter == m_entries.end()) {
+        return;
+    }
+
+    if (iter->m_connected) {
+        // Wait for disconnection report
+        return;
+    }
+
+    std::cerr << "WARNING: Broker connection pool: " <<
+        iter->m_socket->errorString().toStdString() << std::endl;
+    dropEntry(iter);
+    scheduleRefill();
+}
+
+void BrokerConnPool::refill()
+{
+    if (m_retryTimer.isActive()) {
+        return;
+    }
+
+    while (m_entries.size() < m_size) {
+        Entry entry;
+        entry.m_socket.reset(new BrokerSocket());
+        entry.m_timestamp = Clock::now();
+
+        auto* socket = entry.m_socket.get();
+        connect(
+            socket, SIGNAL(connected()),
+            this, SLOT(socketConnected()));
+        connect(
+            socket, SIGNAL(disconnected()),
+            this, SLOT(socketDisconnected()));
+        connect(
+            socket, SIGNAL(error(QAbstractSocket::SocketError)),
+            this, SLOT(socketErrorOccurred(QAbstractSocket::SocketError)));
+
+        m_entries.push_back(std::move(entry));
+        socket->connectToBroker(m_host, m_port);
+    }
+}
+
+void BrokerConnPool::recycleIdle()
+{
+    // Brokers are allowed to close the connections that don't send
+    // CONNECT in reasonable time, replace them before it happens.
+    auto now = Clock::now();
+    auto origSize = m_entries.size();
+    for (auto idx = origSize; 0U < idx; --idx) {
+        auto iter = m_entries.begin() + (idx - 1);
+        if ((!iter->m_connected) ||
+            ((now - iter->m_timestamp) < m_maxIdle)) {
+            continue;
+        }
+
+        iter->m_socket->blockSignals(true);
+        iter->m_socket->abort();
+        dropEntry(iter);
+    }
+
+    if (m_entries.size() != origSize) {
+        refill();
+    }
+}
+
+BrokerConnPool::EntriesList::iterator BrokerConnPool::findEntry(const QObject* socket)
+{
+    return
+        std::find_if(
+            m_entries.begin(), m_entries.end(),
+            [socket](const Entry& entry) -> bool
+            {
+                return entry.m_socket.get() == socket;
+            });
+}
+
+void BrokerConnPool::dropEntry(EntriesList::iterator iter)
+{
+    assert(iter != m_entries.end());
+    // May be invoked from within the socket's signal
+    iter->m_socket.release()->deleteLater();
+    m_entries.erase(iter);
+}
+
+void BrokerConnPool::scheduleRefill()
+{
+    if (!m_retryTimer.isActive()) {
+        m_retryTimer.start(RetryPeriodMs);
+    }
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,127 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+CC_ENABLE_WARNINGS()
+
+#include "BrokerSocket.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class BrokerConnPool : public QObject
+{
+    Q_OBJECT
+    typedef QObject Base;
+public:
+    typedef std::unique_ptr<BrokerSocket> SocketPtr;
+    typedef unsigned short PortType;
+
+    BrokerConnPool(
+        const std::string& host,
+        PortType port,
+        std::size_t size,
+        unsigned maxIdleSec,
+        QObject* parent);
+    ~BrokerConnPool();
+
+    void start();
+    SocketPtr take();
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    std::size_t readyCount() const;
+
+    unsigned long long hits() const
+    {
+        return m_hits;
+    }
+
+    unsigned long long misses() const
+    {
+        return m_misses;
+    }
+
+    unsigned avgRefillLatencyMs() const;
+
+private slots:
+    void socketConnected();
+    void socketDisconnected();
+    void socketErrorOccurred(QAbstractSocket::SocketError err);
+    void refill();
+    void recycleIdle();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry
+    {
+        SocketPtr m_socket;
+        Clock::time_point m_timestamp;
+        bool m_connected = false;
+    };
+
+    typedef std::vector<Entry> EntriesList;
+
+    EntriesList::iterator findEntry(const QObject* socket);
+    void dropEntry(EntriesList::iterator iter);
+    void scheduleRefill();
+
+    std::string m_host;
+    PortType m_port = 0;
+    std::size_t m_size = 0U;
+    Clock::duration m_maxIdle;
+    EntriesList m_entries;
+    QTimer m_retryTimer;
+    QTimer m_idleTimer;
+    unsigned long long m_hits = 0U;
+    unsigned long long m_misses = 0U;
+    unsigned long long m_refillCount = 0U;
+    unsigned long long m_refillTotalUs = 0U;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
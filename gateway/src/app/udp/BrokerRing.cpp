@@ -0,0 +1,158 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "BrokerRing.h"
+
+#include <cassert>
+#include <algorithm>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+BrokerRing::BrokerRing(const BrokersList& brokers, unsigned downPeriodMs)
+  : m_downPeriod(std::chrono::milliseconds(downPeriodMs))
+{
+    assert(!brokers.empty());
+    m_brokers.resize(brokers.size());
+    m_points.reserve(brokers.size() * PointsPerBroker);
+    for (auto idx = 0U; idx < brokers.size(); ++idx) {
+        auto& info = brokers[idx];
+        m_brokers[idx].m_info = info;
+
+        // Points depend on the address only, not on the position
+        // in the configuration.
+        auto name = info.address + ':' + std::to_string(info.port) + '#';
+        for (auto pointIdx = 0U; pointIdx < PointsPerBroker; ++pointIdx) {
+            m_points.emplace_back(hash(name + std::to_string(pointIdx)), idx);
+        }
+    }
+
+    std::sort(m_points.begin(), m_points.end());
+}
+
+std::size_t BrokerRing::place(const std::string& clientId) const
+{
+    if (m_brokers.size() <= 1U) {
+        return 0U;
+    }
+
+    auto iter =
+        std::lower_bound(
+            m_points.begin(), m_points.end(), hash(clientId),
+            [](const Point& point, std::uint64_t val) -> bool
+            {
+                return point.first < val;
+            });
+
+    if (iter == m_points.end()) {
+        iter = m_points.begin();
+    }
+
+    auto owner = iter->second;
+    for (auto count = 0U; count < m_points.size(); ++count) {
+        if (isUp(iter->second)) {
+            return iter->second;
+        }
+
+        ++iter;
+        if (iter == m_points.end()) {
+            iter = m_points.begin();
+        }
+    }
+
+    // All are down, stick to the owner
+    return owner;
+}
+
+void BrokerRing::sessionAdded(std::size_t idx)
+{
+    assert(idx < m_brokers.size());
+    ++m_brokers[idx].m_sessions;
+}
+
+void BrokerRing::sessionRemoved(std::size_t idx)
+{
+    assert(idx < m_brokers.size());
+    assert(0U < m_brokers[idx].m_sessions);
+    --m_brokers[idx].m_sessions;
+}
+
+void BrokerRing::connectCompleted(std::size_t idx, bool success, unsigned latencyMs)
+{
+    assert(idx < m_brokers.size());
+    auto& state = m_brokers[idx];
+    if (!success) {
+        ++state.m_failures;
+        state.m_down = true;
+        state.m_downUntil = Clock::now() + m_downPeriod;
+        return;
+    }
+
+    state.m_down = false;
+    ++state.m_connects;
+    state.m_connectLatencySum += latencyMs;
+}
+
+bool BrokerRing::isUp(std::size_t idx) const
+{
+    auto& state = m_brokers[idx];
+    return (!state.m_down) || (state.m_downUntil <= Clock::now());
+}
+
+unsigned BrokerRing::avgConnectLatencyMs(std::size_t idx) const
+{
+    auto& state = m_brokers[idx];
+    if (state.m_connects == 0U) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(state.m_connectLatencySum / state.m_connects);
+}
+
+std::uint64_t BrokerRing::hash(const std::string& str)
+{
+    // FNV-1a, must not depend on the standard library implementation
+    // to keep the placement stable.
+    std::uint64_t result = 0xcbf29ce484222325ULL;
+    for (auto ch : str) {
+        result ^= static_cast<std::uint8_t>(ch);
+        result *= 0x100000001b3ULL;
+    }
+
+    // Spread similar IDs evenly over the ring
+    result ^= result >> 33;
+    result *= 0xff51afd7ed558ccdULL;
+    result ^= result >> 33;
+    return result;
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,117 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <cstdint>
+
+#include "mqttsn/gateway/Config.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Consistent hash ring of the configured brokers. The placement depends
+// only on the client ID and the brokers list, so it is the same after
+// restart of the gateway. When a broker is marked as down, only the
+// clients placed on it move to the next brokers on the ring.
+class BrokerRing
+{
+public:
+    typedef Config::BrokerInfo BrokerInfo;
+    typedef Config::BrokersList BrokersList;
+    typedef std::chrono::steady_clock Clock;
+
+    explicit BrokerRing(const BrokersList& brokers, unsigned downPeriodMs = DefaultDownPeriodMs);
+
+    static const unsigned DefaultDownPeriodMs = 5000U;
+
+    std::size_t size() const
+    {
+        return m_brokers.size();
+    }
+
+    const BrokerInfo& broker(std::size_t idx) const
+    {
+        return m_brokers[idx].m_info;
+    }
+
+    std::size_t place(const std::string& clientId) const;
+
+    void sessionAdded(std::size_t idx);
+    void sessionRemoved(std::size_t idx);
+    void connectCompleted(std::size_t idx, bool success, unsigned latencyMs);
+
+    bool isUp(std::size_t idx) const;
+
+    std::size_t sessionsCount(std::size_t idx) const
+    {
+        return m_brokers[idx].m_sessions;
+    }
+
+    unsigned avgConnectLatencyMs(std::size_t idx) const;
+
+    unsigned long long connectFailures(std::size_t idx) const
+    {
+        return m_brokers[idx].m_failures;
+    }
+
+    static std::uint64_t hash(const std::string& str);
+
+private:
+    static const unsigned PointsPerBroker = 128U;
+
+    struct BrokerState
+    {
+        BrokerInfo m_info;
+        std::size_t m_sessions = 0U;
+        unsigned long long m_connects = 0U;
+        unsigned long long m_connectLatencySum = 0U;
+        unsigned long long m_failures = 0U;
+        Clock::time_point m_downUntil;
+        bool m_down = false;
+    };
+
+    typedef std::vector<BrokerState> BrokersStatesList;
+    typedef std::pair<std::uint64_t, std::size_t> Point;
+    typedef std::vector<Point> PointsList;
+
+    BrokersStatesList m_brokers;
+    PointsList m_points;
+    Clock::duration m_downPeriod;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
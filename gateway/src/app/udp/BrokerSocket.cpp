@@ -0,0 +1,141 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "BrokerSocket.h"
+
+#include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif // #ifdef __linux__
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::string LocalPrefix("unix:");
+
+}  // namespace
+
+BrokerSocket::BrokerSocket(QObject* parent)
+  : Base(parent)
+{
+}
+
+BrokerSocket::~BrokerSocket() = default;
+
+void BrokerSocket::connectToBroker(const std::string& address, PortType port)
+{
+    if (!isLocalAddress(address)) {
+        connectToHost(QString::fromStdString(address), port);
+        return;
+    }
+
+    m_localConnected = connectLocal(address.substr(LocalPrefix.size()));
+    QMetaObject::invokeMethod(this, "localConnectCompleted", Qt::QueuedConnection);
+}
+
+bool BrokerSocket::isLocalAddress(const std::string& address)
+{
+    return address.compare(0, LocalPrefix.size(), LocalPrefix) == 0;
+}
+
+void BrokerSocket::localConnectCompleted()
+{
+    if (m_localConnected) {
+        emit connected();
+        return;
+    }
+
+    emit error(socketError());
+}
+
+bool BrokerSocket::connectLocal(const std::string& path)
+{
+#ifdef __linux__
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || (sizeof(addr.sun_path) <= path.size())) {
+        setSocketError(QAbstractSocket::HostNotFoundError);
+        setErrorString(QString::fromStdString("Invalid unix socket path: \"" + path + '"'));
+        return false;
+    }
+
+    std::copy(path.begin(), path.end(), &addr.sun_path[0]);
+
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        setSocketError(QAbstractSocket::SocketResourceError);
+        setErrorString(QString::fromStdString(std::strerror(errno)));
+        return false;
+    }
+
+    // Connection to the unix socket is completed (or rejected) immediately,
+    // EAGAIN means the listen backlog of the broker is full.
+    int result = 0;
+    do {
+        result = ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    } while ((result != 0) && (errno == EINTR));
+
+    if (result != 0) {
+        auto errCode = errno;
+        ::close(fd);
+        setSocketError(QAbstractSocket::ConnectionRefusedError);
+        setErrorString(QString::fromStdString(path + ": " + std::strerror(errCode)));
+        return false;
+    }
+
+    if (!setSocketDescriptor(fd, QAbstractSocket::ConnectedState)) {
+        ::close(fd);
+        return false;
+    }
+
+    return true;
+#else // #ifdef __linux__
+    static_cast<void>(path);
+    setSocketError(QAbstractSocket::UnsupportedSocketOperationError);
+    setErrorString("Unix domain sockets are not supported");
+    return false;
+#endif // #ifdef __linux__
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,77 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QObject>
+#include <QtNetwork/QTcpSocket>
+CC_ENABLE_WARNINGS()
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Connection to the broker. The address is either TCP/IP host or
+// "unix:<path>" of the unix domain socket when the broker runs on the same
+// machine. The latter is wrapped by the same QTcpSocket object (just like
+// QLocalSocket does it), so the connection is driven the same way regardless
+// of its type and the connection result is also reported asynchronously.
+class BrokerSocket : public QTcpSocket
+{
+    Q_OBJECT
+    typedef QTcpSocket Base;
+public:
+    typedef std::uint16_t PortType;
+
+    explicit BrokerSocket(QObject* parent = nullptr);
+    ~BrokerSocket();
+
+    void connectToBroker(const std::string& address, PortType port);
+
+    static bool isLocalAddress(const std::string& address);
+
+private slots:
+    void localConnectCompleted();
+
+private:
+    bool connectLocal(const std::string& path);
+
+    bool m_localConnected = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
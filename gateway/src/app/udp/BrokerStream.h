@@ -0,0 +1,65 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class BrokerStream
+{
+public:
+    virtual ~BrokerStream() = default;
+
+    void write(const std::uint8_t* buf, std::size_t bufSize)
+    {
+        writeImpl(buf, bufSize);
+    }
+
+    void close()
+    {
+        closeImpl();
+    }
+
+protected:
+    virtual void writeImpl(const std::uint8_t* buf, std::size_t bufSize) = 0;
+    virtual void closeImpl() = 0;
+};
+
+typedef std::shared_ptr<BrokerStream> BrokerStreamPtr;
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,166 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class ClientAddr
+{
+public:
+    typedef unsigned short PortType;
+    static const std::size_t AddrLen = 16U;
+    typedef std::array<std::uint8_t, AddrLen> AddrBytes;
+
+    ClientAddr()
+    {
+        m_addr.fill(0);
+        m_hash = calcHash();
+    }
+
+    static ClientAddr fromIPv4(std::uint32_t addr, PortType port)
+    {
+        ClientAddr result;
+        result.m_addr.fill(0);
+        result.m_addr[10] = 0xff;
+        result.m_addr[11] = 0xff;
+        result.m_addr[12] = static_cast<std::uint8_t>(addr >> 24);
+        result.m_addr[13] = static_cast<std::uint8_t>(addr >> 16);
+        result.m_addr[14] = static_cast<std::uint8_t>(addr >> 8);
+        result.m_addr[15] = static_cast<std::uint8_t>(addr);
+        result.m_port = port;
+        result.m_hash = result.calcHash();
+        return result;
+    }
+
+    static ClientAddr fromIPv6(const std::uint8_t* addr, PortType port)
+    {
+        ClientAddr result;
+        std::copy_n(addr, AddrLen, result.m_addr.begin());
+        result.m_port = port;
+        result.m_hash = result.calcHash();
+        return result;
+    }
+
+    // Port 0 is never reported for the received datagram, the default
+    // constructed object doesn't refer to any client.
+    bool isValid() const
+    {
+        return m_port != 0;
+    }
+
+    bool isIPv4() const
+    {
+        static const std::uint8_t Prefix[] = {
+            0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff
+        };
+        return std::equal(std::begin(Prefix), std::end(Prefix), m_addr.begin());
+    }
+
+    std::uint32_t ipv4() const
+    {
+        return
+            (static_cast<std::uint32_t>(m_addr[12]) << 24) |
+            (static_cast<std::uint32_t>(m_addr[13]) << 16) |
+            (static_cast<std::uint32_t>(m_addr[14]) << 8) |
+            static_cast<std::uint32_t>(m_addr[15]);
+    }
+
+    const AddrBytes& bytes() const
+    {
+        return m_addr;
+    }
+
+    PortType port() const
+    {
+        return m_port;
+    }
+
+    std::size_t hash() const
+    {
+        return m_hash;
+    }
+
+    bool operator==(const ClientAddr& other) const
+    {
+        return
+            (m_hash == other.m_hash) &&
+            (m_port == other.m_port) &&
+            (m_addr == other.m_addr);
+    }
+
+    bool operator!=(const ClientAddr& other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    static std::uint64_t readWord(const std::uint8_t* buf)
+    {
+        std::uint64_t result = 0U;
+        for (auto idx = 0U; idx < sizeof(result); ++idx) {
+            result = (result << 8) | buf[idx];
+        }
+        return result;
+    }
+
+    static std::uint64_t mix(std::uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+        return value;
+    }
+
+    std::size_t calcHash() const
+    {
+        auto high = readWord(&m_addr[0]);
+        auto low = readWord(&m_addr[sizeof(std::uint64_t)]);
+        auto value = mix(high ^ mix(low ^ (static_cast<std::uint64_t>(m_port) << 48)));
+        return static_cast<std::size_t>(value);
+    }
+
+    AddrBytes m_addr;
+    PortType m_port = 0;
+    std::size_t m_hash = 0U;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
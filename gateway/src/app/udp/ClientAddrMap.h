@@ -0,0 +1,196 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <cstddef>
+
+#include "ClientAddr.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+template <typename TValue>
+class ClientAddrMap
+{
+public:
+    ClientAddrMap()
+      : m_slots(MinCapacity)
+    {
+    }
+
+    std::size_t size() const
+    {
+        return m_count;
+    }
+
+    bool empty() const
+    {
+        return m_count == 0U;
+    }
+
+    TValue* find(const ClientAddr& addr) const
+    {
+        auto mask = m_slots.size() - 1;
+        auto idx = addr.hash() & mask;
+        while (true) {
+            auto& slot = m_slots[idx];
+            if (slot.m_value == nullptr) {
+                return nullptr;
+            }
+
+            if ((slot.m_hash == addr.hash()) &&
+                (slot.m_value->getClientAddr() == addr)) {
+                return slot.m_value;
+            }
+
+            idx = (idx + 1) & mask;
+        }
+    }
+
+    bool insert(TValue* value)
+    {
+        assert(value != nullptr);
+        if (((m_count + 1) * MaxLoadDen) > (m_slots.size() * MaxLoadNum)) {
+            rehash(m_slots.size() * 2);
+        }
+
+        if (!doInsert(m_slots, value)) {
+            return false;
+        }
+
+        ++m_count;
+        return true;
+    }
+
+    bool erase(const ClientAddr& addr)
+    {
+        auto mask = m_slots.size() - 1;
+        auto idx = addr.hash() & mask;
+        while (true) {
+            auto& slot = m_slots[idx];
+            if (slot.m_value == nullptr) {
+                return false;
+            }
+
+            if ((slot.m_hash == addr.hash()) &&
+                (slot.m_value->getClientAddr() == addr)) {
+                break;
+            }
+
+            idx = (idx + 1) & mask;
+        }
+
+        auto hole = idx;
+        auto next = (hole + 1) & mask;
+        while (m_slots[next].m_value != nullptr) {
+            auto home = m_slots[next].m_hash & mask;
+            auto distNext = (next - home) & mask;
+            auto distHole = (next - hole) & mask;
+            if (distHole <= distNext) {
+                m_slots[hole] = m_slots[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+
+        m_slots[hole] = Slot();
+        --m_count;
+        return true;
+    }
+
+    void clear()
+    {
+        m_slots.assign(MinCapacity, Slot());
+        m_count = 0U;
+    }
+
+    template <typename TFunc>
+    void forEach(TFunc&& func) const
+    {
+        for (auto& slot : m_slots) {
+            if (slot.m_value != nullptr) {
+                func(*slot.m_value);
+            }
+        }
+    }
+
+private:
+    static const std::size_t MinCapacity = 64U;
+    static const std::size_t MaxLoadNum = 3U;
+    static const std::size_t MaxLoadDen = 4U;
+
+    struct Slot
+    {
+        TValue* m_value = nullptr;
+        std::size_t m_hash = 0U;
+    };
+
+    typedef std::vector<Slot> SlotsList;
+
+    static bool doInsert(SlotsList& slotsList, TValue* value)
+    {
+        auto& addr = value->getClientAddr();
+        auto mask = slotsList.size() - 1;
+        auto idx = addr.hash() & mask;
+        while (slotsList[idx].m_value != nullptr) {
+            if ((slotsList[idx].m_hash == addr.hash()) &&
+                (slotsList[idx].m_value->getClientAddr() == addr)) {
+                return false;
+            }
+            idx = (idx + 1) & mask;
+        }
+
+        slotsList[idx].m_value = value;
+        slotsList[idx].m_hash = addr.hash();
+        return true;
+    }
+
+    void rehash(std::size_t capacity)
+    {
+        SlotsList newSlots(capacity);
+        for (auto& slot : m_slots) {
+            if (slot.m_value != nullptr) {
+                doInsert(newSlots, slot.m_value);
+            }
+        }
+        m_slots.swap(newSlots);
+    }
+
+    SlotsList m_slots;
+    std::size_t m_count = 0U;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,173 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QObject>
+CC_ENABLE_WARNINGS()
+
+#include "ClientAddr.h"
+#include "BrokerStream.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class ClientSocket : public QObject
+{
+    typedef QObject Base;
+public:
+    typedef ClientAddr::PortType PortType;
+
+    typedef std::function<
+        void (const std::uint8_t* buf, std::size_t bufLen, const ClientAddr& addr)
+    > DataReportCb;
+
+    typedef std::function<void ()> SendSyncReqCb;
+
+    typedef std::function<void ()> DataReleaseCb;
+
+    virtual ~ClientSocket() = default;
+
+    template <typename TFunc>
+    void setDataReportCb(TFunc&& func)
+    {
+        m_dataReportCb = std::forward<TFunc>(func);
+    }
+
+    // Invoked before the buffers of the reported datagrams are reused,
+    // whatever still points into them must be written out or copied.
+    template <typename TFunc>
+    void setDataReleaseCb(TFunc&& func)
+    {
+        m_dataReleaseCb = std::forward<TFunc>(func);
+    }
+
+    // Invoked right before the queued datagrams leave the process, allows
+    // to make persistent whatever they acknowledge.
+    template <typename TFunc>
+    void setSendSyncReqCb(TFunc&& func)
+    {
+        m_sendSyncReqCb = std::forward<TFunc>(func);
+    }
+
+    void setReusePort(bool value)
+    {
+        m_reusePort = value;
+    }
+
+    bool bind(PortType port)
+    {
+        return bindImpl(port);
+    }
+
+    void sendTo(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& addr)
+    {
+        sendToImpl(buf, bufSize, addr);
+    }
+
+    void flush()
+    {
+        flushImpl();
+    }
+
+    BrokerStreamPtr openBrokerStream(int fd)
+    {
+        return openBrokerStreamImpl(fd);
+    }
+
+protected:
+    explicit ClientSocket(QObject* parent)
+      : Base(parent)
+    {
+    }
+
+    void reportData(
+        const std::uint8_t* buf,
+        std::size_t bufLen,
+        const ClientAddr& addr)
+    {
+        if (m_dataReportCb) {
+            m_dataReportCb(buf, bufLen, addr);
+        }
+    }
+
+    void reportDataRelease()
+    {
+        if (m_dataReleaseCb) {
+            m_dataReleaseCb();
+        }
+    }
+
+    void syncBeforeSend()
+    {
+        if (m_sendSyncReqCb) {
+            m_sendSyncReqCb();
+        }
+    }
+
+    bool getReusePort() const
+    {
+        return m_reusePort;
+    }
+
+    virtual bool bindImpl(PortType port) = 0;
+    virtual void sendToImpl(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& addr) = 0;
+    virtual void flushImpl() = 0;
+
+    virtual BrokerStreamPtr openBrokerStreamImpl(int fd)
+    {
+        static_cast<void>(fd);
+        return BrokerStreamPtr();
+    }
+
+private:
+    DataReportCb m_dataReportCb;
+    DataReleaseCb m_dataReleaseCb;
+    SendSyncReqCb m_sendSyncReqCb;
+    bool m_reusePort = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
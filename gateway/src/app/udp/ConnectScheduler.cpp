@@ -0,0 +1,168 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "ConnectScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+ConnectScheduler::ConnectScheduler(
+    unsigned maxInFlight,
+    unsigned minBackoffMs,
+    unsigned maxBackoffMs,
+    QObject* parent)
+  : Base(parent),
+    m_maxInFlight(maxInFlight),
+    m_minBackoffMs(std::max(minBackoffMs, 1U)),
+    m_maxBackoffMs(std::max(maxBackoffMs, m_minBackoffMs)),
+    m_rand(static_cast<std::minstd_rand::result_type>(
+        std::chrono::steady_clock::now().time_since_epoch().count()))
+{
+    m_backoffTimer.setSingleShot(true);
+    connect(
+        &m_backoffTimer, SIGNAL(timeout()),
+        this, SLOT(backoffTimeout()));
+}
+
+ConnectScheduler::~ConnectScheduler() = default;
+
+void ConnectScheduler::cancel(Ticket ticket)
+{
+    if (ticket == NoTicket) {
+        return;
+    }
+
+    for (auto& queue : m_queues) {
+        auto iter =
+            std::find_if(
+                queue.begin(), queue.end(),
+                [ticket](const Request& req) -> bool
+                {
+                    return req.m_ticket == ticket;
+                });
+
+        if (iter != queue.end()) {
+            queue.erase(iter);
+            return;
+        }
+    }
+}
+
+void ConnectScheduler::complete(Outcome outcome)
+{
+    assert(0U < m_inFlight);
+    --m_inFlight;
+
+    if (outcome == Outcome::Connected) {
+        m_backoffMs = 0U;
+    }
+    else if (outcome == Outcome::Failed) {
+        ++m_failed;
+        if (m_backoffMs == 0U) {
+            m_backoffMs = m_minBackoffMs;
+        }
+        else {
+            m_backoffMs = std::min(m_backoffMs * 2, m_maxBackoffMs);
+        }
+
+        // Full jitter in upper half of the backoff period to spread the
+        // reconnection attempts of multiple gateways / workers.
+        std::uniform_int_distribution<unsigned> dist(m_backoffMs / 2, m_backoffMs);
+        m_backoffTimer.start(static_cast<int>(dist(m_rand)));
+    }
+
+    admitNext();
+}
+
+std::size_t ConnectScheduler::queueDepth() const
+{
+    std::size_t result = 0U;
+    for (auto& queue : m_queues) {
+        result += queue.size();
+    }
+    return result;
+}
+
+void ConnectScheduler::backoffTimeout()
+{
+    admitNext();
+}
+
+void ConnectScheduler::admitNext()
+{
+    if (m_admitting) {
+        // Admission callback may complete the connection synchronously
+        return;
+    }
+
+    m_admitting = true;
+    while (true) {
+        if (m_backoffTimer.isActive()) {
+            break;
+        }
+
+        if ((m_maxInFlight != 0U) && (m_maxInFlight <= m_inFlight)) {
+            break;
+        }
+
+        // While backing off after failure, probe the broker with a single
+        // connection attempt at a time.
+        if ((m_backoffMs != 0U) && (0U < m_inFlight)) {
+            break;
+        }
+
+        auto iter =
+            std::find_if(
+                m_queues.begin(), m_queues.end(),
+                [](const RequestsQueue& queue) -> bool
+                {
+                    return !queue.empty();
+                });
+
+        if (iter == m_queues.end()) {
+            break;
+        }
+
+        auto cb = std::move(iter->front().m_admitCb);
+        iter->pop_front();
+        ++m_inFlight;
+        ++m_admitted;
+        cb();
+    }
+    m_admitting = false;
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,148 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <deque>
+#include <functional>
+#include <random>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+CC_ENABLE_WARNINGS()
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class ConnectScheduler : public QObject
+{
+    Q_OBJECT
+    typedef QObject Base;
+public:
+    typedef unsigned long long Ticket;
+    typedef std::function<void ()> AdmitCb;
+
+    static const Ticket NoTicket = 0U;
+
+    enum class Priority
+    {
+        ClientWaiting,
+        Normal,
+        NumOfValues
+    };
+
+    enum class Outcome
+    {
+        Connected,
+        Failed,
+        Abandoned
+    };
+
+    ConnectScheduler(
+        unsigned maxInFlight,
+        unsigned minBackoffMs,
+        unsigned maxBackoffMs,
+        QObject* parent);
+    ~ConnectScheduler();
+
+    template <typename TFunc>
+    Ticket request(Priority priority, TFunc&& func)
+    {
+        auto ticket = ++m_lastTicket;
+        auto& queue = m_queues[static_cast<std::size_t>(priority)];
+        queue.push_back(Request());
+        queue.back().m_ticket = ticket;
+        queue.back().m_admitCb = std::forward<TFunc>(func);
+        admitNext();
+        return ticket;
+    }
+
+    void cancel(Ticket ticket);
+    void complete(Outcome outcome);
+
+    std::size_t queueDepth() const;
+
+    unsigned inFlight() const
+    {
+        return m_inFlight;
+    }
+
+    unsigned long long admittedCount() const
+    {
+        return m_admitted;
+    }
+
+    unsigned long long failedCount() const
+    {
+        return m_failed;
+    }
+
+    unsigned currentBackoffMs() const
+    {
+        return m_backoffMs;
+    }
+
+private slots:
+    void backoffTimeout();
+
+private:
+    struct Request
+    {
+        Ticket m_ticket = NoTicket;
+        AdmitCb m_admitCb;
+    };
+
+    typedef std::deque<Request> RequestsQueue;
+    typedef std::array<RequestsQueue, static_cast<std::size_t>(Priority::NumOfValues)> QueuesList;
+
+    void admitNext();
+
+    unsigned m_maxInFlight = 0U;
+    unsigned m_minBackoffMs = 0U;
+    unsigned m_maxBackoffMs = 0U;
+    unsigned m_inFlight = 0U;
+    unsigned m_backoffMs = 0U;
+    Ticket m_lastTicket = NoTicket;
+    QueuesList m_queues;
+    QTimer m_backoffTimer;
+    std::minstd_rand m_rand;
+    unsigned long long m_admitted = 0U;
+    unsigned long long m_failed = 0U;
+    bool m_admitting = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,336 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "EpollClientSocket.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <arpa/inet.h>
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QAbstractEventDispatcher>
+CC_ENABLE_WARNINGS()
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+EpollClientSocket::EpollClientSocket(QObject* parent)
+  : Base(parent),
+    m_recvPool(RecvBatchSize * MaxDatagramSize),
+    m_recvHdrs(RecvBatchSize),
+    m_recvIovs(RecvBatchSize),
+    m_recvAddrs(RecvBatchSize),
+    m_sendHdrs(SendBatchSize),
+    m_sendIovs(SendBatchSize)
+{
+    for (std::size_t idx = 0U; idx < RecvBatchSize; ++idx) {
+        auto& iov = m_recvIovs[idx];
+        iov.iov_base = &m_recvPool[idx * MaxDatagramSize];
+        iov.iov_len = MaxDatagramSize;
+    }
+
+    auto* dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher != nullptr) {
+        connect(
+            dispatcher, SIGNAL(aboutToBlock()),
+            this, SLOT(aboutToBlock()));
+    }
+}
+
+EpollClientSocket::~EpollClientSocket()
+{
+    flushImpl();
+    closeAll();
+}
+
+bool EpollClientSocket::bindImpl(PortType port)
+{
+    closeAll();
+
+    m_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        std::cerr << "ERROR: Failed to create UDP socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    int enabled = 1;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    ::setsockopt(m_fd, SOL_SOCKET, SO_BROADCAST, &enabled, sizeof(enabled));
+    if (getReusePort() &&
+        (::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) != 0)) {
+        std::cerr << "ERROR: Failed to share UDP port between workers: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "ERROR: Failed to bind UDP socket to local port " << port << std::endl;
+        closeAll();
+        return false;
+    }
+
+    m_epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    if (m_epollFd < 0) {
+        std::cerr << "ERROR: Failed to create epoll instance: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_fd;
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_fd, &event) != 0) {
+        std::cerr << "ERROR: Failed to register UDP socket with epoll: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    m_notifier.reset(new QSocketNotifier(m_epollFd, QSocketNotifier::Read));
+    connect(
+        m_notifier.get(), SIGNAL(activated(int)),
+        this, SLOT(epollActivated()));
+    return true;
+}
+
+void EpollClientSocket::sendToImpl(
+    const std::uint8_t* buf,
+    std::size_t bufSize,
+    const ClientAddr& addr)
+{
+    if ((m_fd < 0) || (bufSize == 0U)) {
+        return;
+    }
+
+    if (!addr.isIPv4()) {
+        std::cerr << "ERROR: IPv6 destination is not supported by UDP socket, datagram dropped!" << std::endl;
+        return;
+    }
+
+    if (m_writeBlocked && (MaxQueuedSends <= (m_outMsgs.size() - m_outMsgsSent))) {
+        std::cerr << "ERROR: UDP send queue overflow, datagram dropped!" << std::endl;
+        return;
+    }
+
+    OutMsg outMsg;
+    outMsg.m_offset = m_outData.size();
+    outMsg.m_len = bufSize;
+    std::memset(&outMsg.m_addr, 0, sizeof(outMsg.m_addr));
+    outMsg.m_addr.sin_family = AF_INET;
+    outMsg.m_addr.sin_addr.s_addr = htonl(addr.ipv4());
+    outMsg.m_addr.sin_port = htons(addr.port());
+
+    m_outData.insert(m_outData.end(), buf, buf + bufSize);
+    m_outMsgs.push_back(outMsg);
+
+    if (MaxQueuedSends <= (m_outMsgs.size() - m_outMsgsSent)) {
+        writePending();
+    }
+}
+
+void EpollClientSocket::flushImpl()
+{
+    writePending();
+}
+
+void EpollClientSocket::epollActivated()
+{
+    epoll_event event;
+    auto count = ::epoll_wait(m_epollFd, &event, 1, 0);
+    if (count <= 0) {
+        return;
+    }
+
+    if ((event.events & EPOLLOUT) != 0) {
+        m_writeBlocked = false;
+        writePending();
+    }
+
+    if ((event.events & (EPOLLIN | EPOLLERR)) != 0) {
+        readPending();
+    }
+}
+
+void EpollClientSocket::aboutToBlock()
+{
+    flushImpl();
+}
+
+void EpollClientSocket::closeAll()
+{
+    m_notifier.reset();
+
+    if (0 <= m_epollFd) {
+        ::close(m_epollFd);
+        m_epollFd = -1;
+    }
+
+    if (0 <= m_fd) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+
+    m_epollOutEnabled = false;
+    m_writeBlocked = false;
+}
+
+void EpollClientSocket::readPending()
+{
+    for (std::size_t batch = 0U; batch < MaxRecvBatchesPerWakeup; ++batch) {
+        for (std::size_t idx = 0U; idx < RecvBatchSize; ++idx) {
+            auto& hdr = m_recvHdrs[idx].msg_hdr;
+            hdr.msg_name = &m_recvAddrs[idx];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = &m_recvIovs[idx];
+            hdr.msg_iovlen = 1;
+            hdr.msg_control = nullptr;
+            hdr.msg_controllen = 0;
+            hdr.msg_flags = 0;
+        }
+
+        auto count = ::recvmmsg(m_fd, &m_recvHdrs[0], RecvBatchSize, MSG_DONTWAIT, nullptr);
+        if (count < 0) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                std::cerr << "ERROR: UDP Socket: " << std::strerror(errno) << std::endl;
+            }
+            break;
+        }
+
+        for (int idx = 0; idx < count; ++idx) {
+            auto& msg = m_recvHdrs[idx];
+            if ((msg.msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                std::cerr << "WARNING: Truncated UDP datagram is dropped" << std::endl;
+                continue;
+            }
+
+            auto& addr = m_recvAddrs[idx];
+            reportData(
+                static_cast<const std::uint8_t*>(m_recvIovs[idx].iov_base),
+                msg.msg_len,
+                ClientAddr::fromIPv4(ntohl(addr.sin_addr.s_addr), ntohs(addr.sin_port)));
+        }
+
+        // The next batch is received into the same buffers
+        reportDataRelease();
+
+        if (static_cast<std::size_t>(count) < RecvBatchSize) {
+            break;
+        }
+    }
+
+    flushImpl();
+}
+
+void EpollClientSocket::writePending()
+{
+    if ((m_outMsgsSent < m_outMsgs.size()) && (!m_writeBlocked)) {
+        syncBeforeSend();
+    }
+
+    while ((m_outMsgsSent < m_outMsgs.size()) && (!m_writeBlocked)) {
+        auto count = std::min(SendBatchSize, m_outMsgs.size() - m_outMsgsSent);
+        for (std::size_t idx = 0U; idx < count; ++idx) {
+            auto& outMsg = m_outMsgs[m_outMsgsSent + idx];
+            auto& iov = m_sendIovs[idx];
+            iov.iov_base = &m_outData[outMsg.m_offset];
+            iov.iov_len = outMsg.m_len;
+
+            auto& hdr = m_sendHdrs[idx].msg_hdr;
+            std::memset(&hdr, 0, sizeof(hdr));
+            hdr.msg_name = &outMsg.m_addr;
+            hdr.msg_namelen = sizeof(outMsg.m_addr);
+            hdr.msg_iov = &iov;
+            hdr.msg_iovlen = 1;
+        }
+
+        auto sentCount = ::sendmmsg(m_fd, &m_sendHdrs[0], static_cast<unsigned>(count), MSG_DONTWAIT);
+        if (sentCount < 0) {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                m_writeBlocked = true;
+                break;
+            }
+
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "ERROR: Failed to write to UDP socket: " << std::strerror(errno) << std::endl;
+            ++m_outMsgsSent; // drop the offending datagram
+            continue;
+        }
+
+        m_outMsgsSent += static_cast<std::size_t>(sentCount);
+    }
+
+    if (m_outMsgsSent == m_outMsgs.size()) {
+        m_outMsgs.clear();
+        m_outData.clear();
+        m_outMsgsSent = 0U;
+    }
+
+    updateEpollEvents();
+}
+
+void EpollClientSocket::updateEpollEvents()
+{
+    if ((m_epollFd < 0) || (m_writeBlocked == m_epollOutEnabled)) {
+        return;
+    }
+
+    epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    if (m_writeBlocked) {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = m_fd;
+
+    if (::epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_fd, &event) != 0) {
+        std::cerr << "ERROR: Failed to update epoll events: " << std::strerror(errno) << std::endl;
+        return;
+    }
+
+    m_epollOutEnabled = m_writeBlocked;
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,114 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QSocketNotifier>
+CC_ENABLE_WARNINGS()
+
+#include "ClientSocket.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class EpollClientSocket : public ClientSocket
+{
+    Q_OBJECT
+    typedef ClientSocket Base;
+public:
+    explicit EpollClientSocket(QObject* parent);
+    ~EpollClientSocket();
+
+protected:
+    virtual bool bindImpl(PortType port) override;
+    virtual void sendToImpl(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& addr) override;
+    virtual void flushImpl() override;
+
+private slots:
+    void epollActivated();
+    void aboutToBlock();
+
+private:
+    static const std::size_t RecvBatchSize = 32U;
+    static const std::size_t MaxRecvBatchesPerWakeup = 16U;
+    static const std::size_t MaxDatagramSize = 0x10000;
+    static const std::size_t SendBatchSize = 64U;
+    static const std::size_t MaxQueuedSends = 1024U;
+
+    struct OutMsg
+    {
+        std::size_t m_offset = 0U;
+        std::size_t m_len = 0U;
+        sockaddr_in m_addr;
+    };
+
+    typedef std::vector<std::uint8_t> DataBuf;
+    typedef std::vector<OutMsg> OutMsgsList;
+
+    void closeAll();
+    void readPending();
+    void writePending();
+    void updateEpollEvents();
+
+    int m_fd = -1;
+    int m_epollFd = -1;
+    std::unique_ptr<QSocketNotifier> m_notifier;
+
+    DataBuf m_recvPool;
+    std::vector<mmsghdr> m_recvHdrs;
+    std::vector<iovec> m_recvIovs;
+    std::vector<sockaddr_in> m_recvAddrs;
+
+    DataBuf m_outData;
+    OutMsgsList m_outMsgs;
+    std::size_t m_outMsgsSent = 0U;
+    std::vector<mmsghdr> m_sendHdrs;
+    std::vector<iovec> m_sendIovs;
+    bool m_writeBlocked = false;
+    bool m_epollOutEnabled = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
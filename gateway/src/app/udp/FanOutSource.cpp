@@ -0,0 +1,284 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "FanOutSource.h"
+
+#include <cassert>
+#include <iostream>
+
+#include "mqttsn/protocol/MsgTypeId.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::uint16_t KeepAlivePeriod = 60U;
+const unsigned PingPeriodMs = (KeepAlivePeriod * 1000U) / 2U;
+const unsigned RestartDelayMs = 1000U;
+const std::uint8_t ProtocolId = 0x01;
+const std::uint8_t CleanSessionFlag = 0x04;
+const std::uint8_t SubscribeQosFlags = 2U << 5; // QoS2, normal topic name
+
+}  // namespace
+
+FanOutSource::FanOutSource(TimerWheel& timerWheel, const std::string& clientId)
+  : m_timerWheel(timerWheel),
+    m_clientId(clientId)
+{
+    m_timer.setExpiryCb(
+        [this]()
+        {
+            timeout();
+        });
+}
+
+FanOutSource::~FanOutSource() = default;
+
+void FanOutSource::subscribe(const std::string& filter)
+{
+    auto result = m_filters.insert(filter);
+    if ((!result.second) && (m_session == nullptr)) {
+        return;
+    }
+
+    if (m_session == nullptr) {
+        createSession();
+        return;
+    }
+
+    if (m_connected) {
+        sendSubscribe(filter);
+    }
+}
+
+void FanOutSource::unsubscribe(const std::string& filter)
+{
+    if (m_filters.erase(filter) == 0U) {
+        return;
+    }
+
+    if ((m_session != nullptr) && m_connected) {
+        sendUnsubscribe(filter);
+    }
+}
+
+void FanOutSource::sessionTerminated()
+{
+    m_session = nullptr;
+    m_connected = false;
+    m_resubscribeRequired = false;
+    m_subsInFlight.clear();
+    m_timerWheel.cancel(m_timer);
+    if (m_filters.empty()) {
+        return;
+    }
+
+    std::cerr << "WARNING: Fan-out session terminated, restarting..." << std::endl;
+    m_timerWheel.start(m_timer, RestartDelayMs);
+}
+
+void FanOutSource::createSession()
+{
+    assert(m_session == nullptr);
+    assert(m_sessionCreateCb);
+    m_session = m_sessionCreateCb();
+    if (m_session == nullptr) {
+        return;
+    }
+
+    m_connected = false;
+
+    // The subscriptions of this session need to reach the broker
+    m_session->setSubscribeFanOutReqCb(nullptr);
+    m_session->setUnsubscribeFanOutReqCb(nullptr);
+
+    m_session->setSendDataReqCb(
+        [this](const std::uint8_t* buf, std::size_t bufSize)
+        {
+            dataToClient(buf, bufSize);
+        });
+
+    m_session->setBrokerPubReportCb(
+        [this](BrokerPubInfoPtr info)
+        {
+            if (m_pubReportCb) {
+                m_pubReportCb(std::move(info));
+            }
+        });
+
+    if (!m_session->start(SessionWrapper::ConnectPriority::Normal)) {
+        assert(!"Unexpected error");
+        return;
+    }
+
+    sendConnect();
+    if (m_session != nullptr) {
+        m_timerWheel.start(m_timer, PingPeriodMs);
+    }
+}
+
+void FanOutSource::timeout()
+{
+    if (m_session == nullptr) {
+        if (!m_filters.empty()) {
+            createSession();
+        }
+        return;
+    }
+
+    if (m_resubscribeRequired) {
+        m_resubscribeRequired = false;
+        for (auto& f : m_filters) {
+            sendSubscribe(f);
+            if (m_session == nullptr) {
+                return;
+            }
+        }
+    }
+    else if (m_connected) {
+        sendPingreq();
+        if (m_session == nullptr) {
+            return;
+        }
+    }
+
+    m_timerWheel.start(m_timer, PingPeriodMs);
+}
+
+void FanOutSource::dataToClient(const std::uint8_t* buf, std::size_t bufSize)
+{
+    // Only CONNACK and SUBACK are of interest, the acknowledgements of
+    // unsubscriptions and pings are not tracked.
+    SnMsgBuf::Frame frame;
+    if ((!SnMsgBuf::parse(buf, bufSize, frame)) || (frame.m_bodyLen == 0U)) {
+        return;
+    }
+
+    if (frame.m_type == mqttsn::protocol::MsgTypeId_SUBACK) {
+        subackReceived(frame.m_body, frame.m_bodyLen);
+        return;
+    }
+
+    if (frame.m_type != mqttsn::protocol::MsgTypeId_CONNACK) {
+        return;
+    }
+
+    auto returnCode = frame.m_body[0];
+    if (returnCode != 0U) {
+        std::cerr << "ERROR: Fan-out session connection rejected (" <<
+            static_cast<unsigned>(returnCode) << ")" << std::endl;
+        return;
+    }
+
+    // Subscribe outside of the session's processing context
+    m_connected = true;
+    m_resubscribeRequired = true;
+    m_timerWheel.start(m_timer, 0U);
+}
+
+void FanOutSource::subackReceived(const std::uint8_t* body, std::size_t bodyLen)
+{
+    // flags, topic ID, message ID, return code
+    if (bodyLen < 6U) {
+        return;
+    }
+
+    auto msgId = SnMsgBuf::readU16(body + 3);
+    auto iter = m_subsInFlight.find(msgId);
+    if (iter == m_subsInFlight.end()) {
+        return;
+    }
+
+    auto filter = std::move(iter->second);
+    m_subsInFlight.erase(iter);
+    if (m_subackReportCb) {
+        m_subackReportCb(filter);
+    }
+}
+
+void FanOutSource::sendConnect()
+{
+    m_msg.begin(mqttsn::protocol::MsgTypeId_CONNECT);
+    m_msg.writeU8(CleanSessionFlag);
+    m_msg.writeU8(ProtocolId);
+    m_msg.writeU16(KeepAlivePeriod);
+    m_msg.writeData(m_clientId);
+    sendMsg();
+}
+
+void FanOutSource::sendSubscribe(const std::string& filter)
+{
+    auto msgId = allocMsgId();
+    m_subsInFlight[msgId] = filter;
+    m_msg.begin(mqttsn::protocol::MsgTypeId_SUBSCRIBE);
+    m_msg.writeU8(SubscribeQosFlags);
+    m_msg.writeU16(msgId);
+    m_msg.writeData(filter);
+    sendMsg();
+}
+
+void FanOutSource::sendUnsubscribe(const std::string& filter)
+{
+    auto msgId = allocMsgId();
+    m_msg.begin(mqttsn::protocol::MsgTypeId_UNSUBSCRIBE);
+    m_msg.writeU8(0U);
+    m_msg.writeU16(msgId);
+    m_msg.writeData(filter);
+    sendMsg();
+}
+
+void FanOutSource::sendPingreq()
+{
+    m_msg.begin(mqttsn::protocol::MsgTypeId_PINGREQ);
+    sendMsg();
+}
+
+void FanOutSource::sendMsg()
+{
+    assert(m_session != nullptr);
+    std::size_t len = 0U;
+    auto* buf = m_msg.finish(len);
+    m_session->dataFromClient(buf, len);
+}
+
+std::uint16_t FanOutSource::allocMsgId()
+{
+    ++m_lastMsgId;
+    if (m_lastMsgId == 0U) {
+        ++m_lastMsgId;
+    }
+    return m_lastMsgId;
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
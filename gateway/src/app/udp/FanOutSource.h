@@ -0,0 +1,132 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <set>
+#include <map>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "mqttsn/gateway/Session.h"
+#include "SessionWrapper.h"
+#include "SnMsgBuf.h"
+#include "TimerWheel.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Internal client of the gateway holding single broker subscription
+// per topic filter on behalf of all the local subscribers.
+class FanOutSource
+{
+public:
+    typedef mqttsn::gateway::Session::BrokerPubInfoPtr BrokerPubInfoPtr;
+
+    typedef std::function<SessionWrapper* ()> SessionCreateCb;
+    typedef std::function<void (BrokerPubInfoPtr info)> PubReportCb;
+    typedef std::function<void (const std::string& filter)> SubackReportCb;
+
+    FanOutSource(TimerWheel& timerWheel, const std::string& clientId);
+    ~FanOutSource();
+
+    template <typename TFunc>
+    void setSessionCreateCb(TFunc&& cb)
+    {
+        m_sessionCreateCb = std::forward<TFunc>(cb);
+    }
+
+    template <typename TFunc>
+    void setPubReportCb(TFunc&& cb)
+    {
+        m_pubReportCb = std::forward<TFunc>(cb);
+    }
+
+    template <typename TFunc>
+    void setSubackReportCb(TFunc&& cb)
+    {
+        m_subackReportCb = std::forward<TFunc>(cb);
+    }
+
+    // Subscribing to the existing filter sends SUBSCRIBE again, the broker
+    // publishes the retained messages after the SUBACK.
+    void subscribe(const std::string& filter);
+    void unsubscribe(const std::string& filter);
+
+    bool isSession(const SessionWrapper& session) const
+    {
+        return m_session == &session;
+    }
+
+    SessionWrapper* session() const
+    {
+        return m_session;
+    }
+
+    void sessionTerminated();
+
+    std::size_t filtersCount() const
+    {
+        return m_filters.size();
+    }
+
+private:
+    void createSession();
+    void timeout();
+    void dataToClient(const std::uint8_t* buf, std::size_t bufSize);
+    void subackReceived(const std::uint8_t* body, std::size_t bodyLen);
+    void sendConnect();
+    void sendSubscribe(const std::string& filter);
+    void sendUnsubscribe(const std::string& filter);
+    void sendPingreq();
+    void sendMsg();
+    std::uint16_t allocMsgId();
+
+    TimerWheel& m_timerWheel;
+    TimerWheel::Timer m_timer;
+    std::string m_clientId;
+    std::set<std::string> m_filters;
+    SessionCreateCb m_sessionCreateCb;
+    PubReportCb m_pubReportCb;
+    SubackReportCb m_subackReportCb;
+    std::map<std::uint16_t, std::string> m_subsInFlight;
+    SessionWrapper* m_session = nullptr;
+    SnMsgBuf m_msg;
+    std::uint16_t m_lastMsgId = 0U;
+    bool m_connected = false;
+    bool m_resubscribeRequired = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
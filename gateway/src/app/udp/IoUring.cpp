@@ -0,0 +1,313 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "IoUring.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+int ioUringSetup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+int ioUringRegister(int fd, unsigned opcode, const void* arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+
+template <typename T>
+T* ptrAt(void* base, unsigned offset)
+{
+    return reinterpret_cast<T*>(reinterpret_cast<std::uint8_t*>(base) + offset);
+}
+
+std::size_t roundToPage(std::size_t size)
+{
+    auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return ((size + pageSize - 1) / pageSize) * pageSize;
+}
+
+}  // namespace
+
+IoUring::~IoUring()
+{
+    close();
+}
+
+bool IoUring::init(unsigned entries)
+{
+    close();
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER;
+    m_fd = ioUringSetup(entries, &params);
+    if ((m_fd < 0) && (errno == EINVAL)) {
+        // Older kernel, retry without optional flags
+        std::memset(&params, 0, sizeof(params));
+        m_fd = ioUringSetup(entries, &params);
+    }
+
+    if (m_fd < 0) {
+        return false;
+    }
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+    if (singleMmap) {
+        m_sqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+    }
+
+    m_sqRingPtr =
+        ::mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+    if (m_sqRingPtr == MAP_FAILED) {
+        m_sqRingPtr = nullptr;
+        close();
+        return false;
+    }
+
+    if (singleMmap) {
+        m_cqRingPtr = m_sqRingPtr;
+    }
+    else {
+        m_cqRingPtr =
+            ::mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+        if (m_cqRingPtr == MAP_FAILED) {
+            m_cqRingPtr = nullptr;
+            close();
+            return false;
+        }
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    auto* sqes =
+        ::mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        close();
+        return false;
+    }
+
+    m_sqes = reinterpret_cast<io_uring_sqe*>(sqes);
+    m_sqHead = ptrAt<unsigned>(m_sqRingPtr, params.sq_off.head);
+    m_sqTail = ptrAt<unsigned>(m_sqRingPtr, params.sq_off.tail);
+    m_sqArray = ptrAt<unsigned>(m_sqRingPtr, params.sq_off.array);
+    m_sqMask = *ptrAt<unsigned>(m_sqRingPtr, params.sq_off.ring_mask);
+    m_sqEntries = params.sq_entries;
+    m_sqeHead = *m_sqTail;
+    m_sqeTail = m_sqeHead;
+
+    m_cqHead = ptrAt<unsigned>(m_cqRingPtr, params.cq_off.head);
+    m_cqTail = ptrAt<unsigned>(m_cqRingPtr, params.cq_off.tail);
+    m_cqMask = *ptrAt<unsigned>(m_cqRingPtr, params.cq_off.ring_mask);
+    m_cqes = ptrAt<io_uring_cqe>(m_cqRingPtr, params.cq_off.cqes);
+    return true;
+}
+
+void IoUring::close()
+{
+    if (m_bufRegistered) {
+        io_uring_buf_reg reg;
+        std::memset(&reg, 0, sizeof(reg));
+        reg.bgid = m_bufGroupId;
+        ioUringRegister(m_fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+        m_bufRegistered = false;
+    }
+
+    unmapAll();
+
+    if (0 <= m_fd) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+io_uring_sqe* IoUring::getSqe()
+{
+    auto head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+    if (m_sqEntries <= (m_sqeTail - head)) {
+        return nullptr;
+    }
+
+    auto* sqe = &m_sqes[m_sqeTail & m_sqMask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++m_sqeTail;
+    return sqe;
+}
+
+int IoUring::submit()
+{
+    auto toSubmit = m_sqeTail - m_sqeHead;
+    if (toSubmit == 0U) {
+        return 0;
+    }
+
+    auto tail = *m_sqTail;
+    for (auto idx = 0U; idx < toSubmit; ++idx) {
+        m_sqArray[tail & m_sqMask] = m_sqeHead & m_sqMask;
+        ++tail;
+        ++m_sqeHead;
+    }
+    __atomic_store_n(m_sqTail, tail, __ATOMIC_RELEASE);
+
+    while (true) {
+        auto result = ioUringEnter(m_fd, toSubmit, 0U, 0U);
+        if ((result < 0) && (errno == EINTR)) {
+            continue;
+        }
+
+        return result;
+    }
+}
+
+bool IoUring::registerEventFd(int eventFd)
+{
+    return ioUringRegister(m_fd, IORING_REGISTER_EVENTFD, &eventFd, 1) == 0;
+}
+
+bool IoUring::setupBufRing(BufId groupId, unsigned entries, unsigned bufSize)
+{
+    assert(valid());
+    assert((entries & (entries - 1)) == 0U);
+    m_bufRingSize = roundToPage(entries * sizeof(io_uring_buf));
+    auto* ringPtr =
+        ::mmap(nullptr, m_bufRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ringPtr == MAP_FAILED) {
+        return false;
+    }
+    m_bufRing = reinterpret_cast<io_uring_buf_ring*>(ringPtr);
+
+    m_bufsSize = static_cast<std::size_t>(entries) * bufSize;
+    auto* bufsPtr =
+        ::mmap(nullptr, m_bufsSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (bufsPtr == MAP_FAILED) {
+        unmapAll();
+        return false;
+    }
+    m_bufs = reinterpret_cast<std::uint8_t*>(bufsPtr);
+
+    io_uring_buf_reg reg;
+    std::memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = reinterpret_cast<std::uintptr_t>(m_bufRing);
+    reg.ring_entries = entries;
+    reg.bgid = groupId;
+    if (ioUringRegister(m_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        unmapAll();
+        return false;
+    }
+
+    m_bufRegistered = true;
+    m_bufGroupId = groupId;
+    m_bufEntries = entries;
+    m_bufSize = bufSize;
+    m_bufTail = 0U;
+    for (auto idx = 0U; idx < entries; ++idx) {
+        recycleBuf(static_cast<BufId>(idx));
+    }
+    commitBufs();
+    return true;
+}
+
+std::uint8_t* IoUring::bufAddr(BufId bufId) const
+{
+    assert(bufId < m_bufEntries);
+    return m_bufs + (static_cast<std::size_t>(bufId) * m_bufSize);
+}
+
+void IoUring::recycleBuf(BufId bufId)
+{
+    // The "bufs" member of io_uring_buf_ring is declared in a way that
+    // has different offset in C++, access ring entries directly.
+    auto* bufs = reinterpret_cast<io_uring_buf*>(m_bufRing);
+    auto& buf = bufs[m_bufTail & (m_bufEntries - 1)];
+    buf.addr = reinterpret_cast<std::uintptr_t>(bufAddr(bufId));
+    buf.len = m_bufSize;
+    buf.bid = bufId;
+    ++m_bufTail;
+}
+
+void IoUring::unmapAll()
+{
+    if (m_bufs != nullptr) {
+        ::munmap(m_bufs, m_bufsSize);
+        m_bufs = nullptr;
+    }
+
+    if (m_bufRing != nullptr) {
+        ::munmap(m_bufRing, m_bufRingSize);
+        m_bufRing = nullptr;
+    }
+
+    if (m_sqes != nullptr) {
+        ::munmap(m_sqes, m_sqesSize);
+        m_sqes = nullptr;
+    }
+
+    if ((m_cqRingPtr != nullptr) && (m_cqRingPtr != m_sqRingPtr)) {
+        ::munmap(m_cqRingPtr, m_cqRingSize);
+    }
+    m_cqRingPtr = nullptr;
+
+    if (m_sqRingPtr != nullptr) {
+        ::munmap(m_sqRingPtr, m_sqRingSize);
+        m_sqRingPtr = nullptr;
+    }
+}
+
+void IoUring::commitBufs()
+{
+    if (m_bufRing == nullptr) {
+        return;
+    }
+
+    __atomic_store_n(&m_bufRing->tail, m_bufTail, __ATOMIC_RELEASE);
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
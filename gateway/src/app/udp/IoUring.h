@@ -0,0 +1,137 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include <linux/io_uring.h>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class IoUring
+{
+public:
+    typedef std::uint16_t BufId;
+
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    bool init(unsigned entries);
+    void close();
+
+    bool valid() const
+    {
+        return 0 <= m_fd;
+    }
+
+    io_uring_sqe* getSqe();
+    unsigned pendingSqes() const
+    {
+        return m_sqeTail - m_sqeHead;
+    }
+
+    int submit();
+
+    bool registerEventFd(int eventFd);
+
+    bool setupBufRing(BufId groupId, unsigned entries, unsigned bufSize);
+    std::uint8_t* bufAddr(BufId bufId) const;
+    unsigned bufSize() const
+    {
+        return m_bufSize;
+    }
+
+    void recycleBuf(BufId bufId);
+
+    template <typename TFunc>
+    unsigned forEachCqe(TFunc&& func)
+    {
+        auto head = *m_cqHead;
+        auto tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+        unsigned count = 0U;
+        while (head != tail) {
+            auto& cqe = m_cqes[head & m_cqMask];
+            func(cqe);
+            ++head;
+            ++count;
+        }
+
+        __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+        commitBufs();
+        return count;
+    }
+
+private:
+    void unmapAll();
+    void commitBufs();
+
+    int m_fd = -1;
+
+    void* m_sqRingPtr = nullptr;
+    std::size_t m_sqRingSize = 0U;
+    void* m_cqRingPtr = nullptr;
+    std::size_t m_cqRingSize = 0U;
+    io_uring_sqe* m_sqes = nullptr;
+    std::size_t m_sqesSize = 0U;
+
+    unsigned* m_sqHead = nullptr;
+    unsigned* m_sqTail = nullptr;
+    unsigned* m_sqArray = nullptr;
+    unsigned m_sqMask = 0U;
+    unsigned m_sqEntries = 0U;
+    unsigned m_sqeHead = 0U;
+    unsigned m_sqeTail = 0U;
+
+    unsigned* m_cqHead = nullptr;
+    unsigned* m_cqTail = nullptr;
+    unsigned m_cqMask = 0U;
+    io_uring_cqe* m_cqes = nullptr;
+
+    io_uring_buf_ring* m_bufRing = nullptr;
+    std::size_t m_bufRingSize = 0U;
+    std::uint8_t* m_bufs = nullptr;
+    std::size_t m_bufsSize = 0U;
+    unsigned m_bufEntries = 0U;
+    unsigned m_bufSize = 0U;
+    BufId m_bufGroupId = 0U;
+    std::uint16_t m_bufTail = 0U;
+    bool m_bufRegistered = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
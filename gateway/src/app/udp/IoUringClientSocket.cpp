@@ -0,0 +1,616 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "IoUringClientSocket.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <arpa/inet.h>
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QAbstractEventDispatcher>
+CC_ENABLE_WARNINGS()
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const unsigned OpTypeShift = 56U;
+const std::uint64_t OpIdxMask = (static_cast<std::uint64_t>(1U) << OpTypeShift) - 1;
+
+}  // namespace
+
+class IoUringClientSocket::Stream : public BrokerStream
+{
+public:
+    Stream(IoUringClientSocket& owner, int fd, std::size_t idx)
+      : m_owner(&owner),
+        m_fd(::fcntl(fd, F_DUPFD_CLOEXEC, 0)),
+        m_idx(idx)
+    {
+    }
+
+    ~Stream()
+    {
+        if (0 <= m_fd) {
+            ::close(m_fd);
+        }
+    }
+
+    bool idle() const
+    {
+        return (!m_inFlight) && (!m_scheduled) && m_pending.empty();
+    }
+
+    IoUringClientSocket* m_owner = nullptr;
+    int m_fd = -1;
+    std::size_t m_idx = 0U;
+    DataBuf m_pending;
+    DataBuf m_sending;
+    std::size_t m_sendingOffset = 0U;
+    bool m_inFlight = false;
+    bool m_scheduled = false;
+    bool m_closed = false;
+
+protected:
+    virtual void writeImpl(const std::uint8_t* buf, std::size_t bufSize) override
+    {
+        if (m_closed || (m_owner == nullptr)) {
+            return;
+        }
+
+        m_pending.insert(m_pending.end(), buf, buf + bufSize);
+        if ((!m_inFlight) && (!m_scheduled)) {
+            m_owner->scheduleStream(*this);
+        }
+    }
+
+    virtual void closeImpl() override
+    {
+        if (m_closed) {
+            return;
+        }
+
+        m_closed = true;
+        if (m_owner == nullptr) {
+            return;
+        }
+
+        if (idle()) {
+            m_owner->releaseStream(*this);
+            return;
+        }
+
+        // Make sure all the pending data gets submitted before the
+        // original socket is closed, the duplicated descriptor keeps
+        // the connection open until all the writes are complete.
+        m_owner->flushImpl();
+    }
+};
+
+IoUringClientSocket::IoUringClientSocket(QObject* parent)
+  : Base(parent),
+    m_sendSlots(MaxSendSlots)
+{
+    std::memset(&m_recvHdr, 0, sizeof(m_recvHdr));
+    m_recvHdr.msg_namelen = sizeof(sockaddr_in);
+
+    m_freeSendSlots.reserve(MaxSendSlots);
+    for (auto idx = MaxSendSlots; 0U < idx; --idx) {
+        m_freeSendSlots.push_back(idx - 1);
+    }
+
+    auto* dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher != nullptr) {
+        connect(
+            dispatcher, SIGNAL(aboutToBlock()),
+            this, SLOT(aboutToBlock()));
+    }
+}
+
+IoUringClientSocket::~IoUringClientSocket()
+{
+    flushImpl();
+    closeAll();
+}
+
+bool IoUringClientSocket::bindImpl(PortType port)
+{
+    closeAll();
+
+    if (!m_ring.init(RingEntries)) {
+        std::cerr << "ERROR: Failed to initialise io_uring: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (!m_ring.setupBufRing(RecvBufGroup, RecvBufsCount, RecvBufSize)) {
+        std::cerr << "ERROR: Failed to register io_uring receive buffers: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    m_fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_fd < 0) {
+        std::cerr << "ERROR: Failed to create UDP socket: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    int enabled = 1;
+    ::setsockopt(m_fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    ::setsockopt(m_fd, SOL_SOCKET, SO_BROADCAST, &enabled, sizeof(enabled));
+    if (getReusePort() &&
+        (::setsockopt(m_fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) != 0)) {
+        std::cerr << "ERROR: Failed to share UDP port between workers: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(m_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "ERROR: Failed to bind UDP socket to local port " << port << std::endl;
+        closeAll();
+        return false;
+    }
+
+    m_eventFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ((m_eventFd < 0) || (!m_ring.registerEventFd(m_eventFd))) {
+        std::cerr << "ERROR: Failed to register io_uring completion notification: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    armRecv();
+    if (m_ring.submit() < 0) {
+        std::cerr << "ERROR: Failed to submit io_uring receive request: " << std::strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+
+    bool recvSupported = true;
+    m_ring.forEachCqe(
+        [this, &recvSupported](const io_uring_cqe& cqe)
+        {
+            if ((cqe.user_data == userData(OpType_Recv, 0U)) && (cqe.res == -EINVAL)) {
+                recvSupported = false;
+                return;
+            }
+
+            handleCqe(cqe);
+        });
+    releaseRecvBufs();
+
+    if (!recvSupported) {
+        std::cerr << "ERROR: Multishot receive is not supported by io_uring of this kernel" << std::endl;
+        closeAll();
+        return false;
+    }
+
+    m_notifier.reset(new QSocketNotifier(m_eventFd, QSocketNotifier::Read));
+    connect(
+        m_notifier.get(), SIGNAL(activated(int)),
+        this, SLOT(completionsAvailable()));
+    return true;
+}
+
+void IoUringClientSocket::sendToImpl(
+    const std::uint8_t* buf,
+    std::size_t bufSize,
+    const ClientAddr& addr)
+{
+    if ((m_fd < 0) || (bufSize == 0U)) {
+        return;
+    }
+
+    if (!addr.isIPv4()) {
+        std::cerr << "ERROR: IPv6 destination is not supported by UDP socket, datagram dropped!" << std::endl;
+        return;
+    }
+
+    if (m_freeSendSlots.empty()) {
+        std::cerr << "ERROR: UDP send queue overflow, datagram dropped!" << std::endl;
+        return;
+    }
+
+    auto* sqe = nextSqe();
+    if (sqe == nullptr) {
+        std::cerr << "ERROR: io_uring submission queue overflow, datagram dropped!" << std::endl;
+        return;
+    }
+
+    auto idx = m_freeSendSlots.back();
+    m_freeSendSlots.pop_back();
+
+    auto& slot = m_sendSlots[idx];
+    slot.m_data.assign(buf, buf + bufSize);
+    std::memset(&slot.m_addr, 0, sizeof(slot.m_addr));
+    slot.m_addr.sin_family = AF_INET;
+    slot.m_addr.sin_addr.s_addr = htonl(addr.ipv4());
+    slot.m_addr.sin_port = htons(addr.port());
+    slot.m_iov.iov_base = &slot.m_data[0];
+    slot.m_iov.iov_len = slot.m_data.size();
+    std::memset(&slot.m_hdr, 0, sizeof(slot.m_hdr));
+    slot.m_hdr.msg_name = &slot.m_addr;
+    slot.m_hdr.msg_namelen = sizeof(slot.m_addr);
+    slot.m_hdr.msg_iov = &slot.m_iov;
+    slot.m_hdr.msg_iovlen = 1;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = m_fd;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&slot.m_hdr);
+    sqe->len = 1;
+    sqe->user_data = userData(OpType_Send, idx);
+}
+
+void IoUringClientSocket::flushImpl()
+{
+    if (!m_ring.valid()) {
+        return;
+    }
+
+    IndicesList readyStreams;
+    readyStreams.swap(m_readyStreams);
+    for (auto idx : readyStreams) {
+        auto stream = m_streams[idx];
+        if (stream) {
+            submitStream(*stream);
+        }
+    }
+
+    if (m_ring.pendingSqes() == 0U) {
+        return;
+    }
+
+    syncBeforeSend();
+    if (m_ring.submit() < 0) {
+        std::cerr << "ERROR: Failed to submit io_uring requests: " << std::strerror(errno) << std::endl;
+    }
+}
+
+BrokerStreamPtr IoUringClientSocket::openBrokerStreamImpl(int fd)
+{
+    if ((!m_ring.valid()) || (fd < 0)) {
+        return BrokerStreamPtr();
+    }
+
+    std::size_t idx = m_streams.size();
+    if (!m_freeStreams.empty()) {
+        idx = m_freeStreams.back();
+        m_freeStreams.pop_back();
+    }
+    else {
+        m_streams.emplace_back();
+    }
+
+    auto stream = std::make_shared<Stream>(*this, fd, idx);
+    if (stream->m_fd < 0) {
+        m_freeStreams.push_back(idx);
+        return BrokerStreamPtr();
+    }
+
+    m_streams[idx] = stream;
+    return stream;
+}
+
+void IoUringClientSocket::completionsAvailable()
+{
+    std::uint64_t value = 0U;
+    auto result = ::read(m_eventFd, &value, sizeof(value));
+    static_cast<void>(result);
+
+    while (m_ring.forEachCqe(
+        [this](const io_uring_cqe& cqe)
+        {
+            handleCqe(cqe);
+        }) != 0U) {
+        releaseRecvBufs();
+    }
+
+    if (!m_recvArmed) {
+        armRecv();
+    }
+
+    flushImpl();
+}
+
+void IoUringClientSocket::aboutToBlock()
+{
+    flushImpl();
+}
+
+std::uint64_t IoUringClientSocket::userData(OpType type, std::size_t idx)
+{
+    return (static_cast<std::uint64_t>(type) << OpTypeShift) | (static_cast<std::uint64_t>(idx) & OpIdxMask);
+}
+
+io_uring_sqe* IoUringClientSocket::nextSqe()
+{
+    auto* sqe = m_ring.getSqe();
+    if (sqe != nullptr) {
+        return sqe;
+    }
+
+    syncBeforeSend();
+    m_ring.submit();
+    return m_ring.getSqe();
+}
+
+void IoUringClientSocket::armRecv()
+{
+    auto* sqe = nextSqe();
+    if (sqe == nullptr) {
+        return;
+    }
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = m_fd;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&m_recvHdr);
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = RecvBufGroup;
+    sqe->user_data = userData(OpType_Recv, 0U);
+    m_recvArmed = true;
+}
+
+void IoUringClientSocket::handleCqe(const io_uring_cqe& cqe)
+{
+    auto type = static_cast<OpType>(cqe.user_data >> OpTypeShift);
+    auto idx = static_cast<std::size_t>(cqe.user_data & OpIdxMask);
+    switch (type) {
+    case OpType_Recv:
+        handleRecv(cqe);
+        break;
+    case OpType_Send:
+        handleSend(cqe, idx);
+        break;
+    case OpType_Stream:
+        handleStream(cqe, idx);
+        break;
+    default:
+        assert(!"Unexpected operation type");
+        break;
+    }
+}
+
+void IoUringClientSocket::handleRecv(const io_uring_cqe& cqe)
+{
+    if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+        m_recvArmed = false;
+    }
+
+    if (cqe.res < 0) {
+        if ((cqe.res != -ENOBUFS) && (cqe.res != -ECANCELED)) {
+            std::cerr << "ERROR: UDP Socket: " << std::strerror(-cqe.res) << std::endl;
+        }
+        return;
+    }
+
+    if ((cqe.flags & IORING_CQE_F_BUFFER) == 0) {
+        return;
+    }
+
+    auto bufId = static_cast<IoUring::BufId>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    auto* buf = m_ring.bufAddr(bufId);
+    auto* out = reinterpret_cast<const io_uring_recvmsg_out*>(buf);
+    auto* name = buf + sizeof(io_uring_recvmsg_out);
+    auto* payload = name + m_recvHdr.msg_namelen + m_recvHdr.msg_controllen;
+
+    do {
+        if ((out->flags & MSG_TRUNC) != 0) {
+            std::cerr << "WARNING: Truncated UDP datagram is dropped" << std::endl;
+            break;
+        }
+
+        if (out->namelen < sizeof(sockaddr_in)) {
+            break;
+        }
+
+        sockaddr_in senderAddr;
+        std::memcpy(&senderAddr, name, sizeof(senderAddr));
+        reportData(
+            payload,
+            out->payloadlen,
+            ClientAddr::fromIPv4(ntohl(senderAddr.sin_addr.s_addr), ntohs(senderAddr.sin_port)));
+    } while (false);
+
+    // Recycled after all the currently available completions are handled
+    m_recvBufsHeld.push_back(bufId);
+}
+
+void IoUringClientSocket::releaseRecvBufs()
+{
+    if (m_recvBufsHeld.empty()) {
+        return;
+    }
+
+    reportDataRelease();
+    for (auto bufId : m_recvBufsHeld) {
+        m_ring.recycleBuf(bufId);
+    }
+    m_recvBufsHeld.clear();
+}
+
+void IoUringClientSocket::handleSend(const io_uring_cqe& cqe, std::size_t idx)
+{
+    if (cqe.res < 0) {
+        std::cerr << "ERROR: Failed to write to UDP socket: " << std::strerror(-cqe.res) << std::endl;
+    }
+
+    assert(idx < m_sendSlots.size());
+    m_freeSendSlots.push_back(idx);
+}
+
+void IoUringClientSocket::handleStream(const io_uring_cqe& cqe, std::size_t idx)
+{
+    if (m_streams.size() <= idx) {
+        return;
+    }
+
+    auto stream = m_streams[idx];
+    if (!stream) {
+        return;
+    }
+
+    stream->m_inFlight = false;
+    do {
+        if ((cqe.res == -EAGAIN) || (cqe.res == -EINTR)) {
+            break;
+        }
+
+        if (cqe.res < 0) {
+            if (!stream->m_closed) {
+                std::cerr << "ERROR: Failed to write to TCP socket: " << std::strerror(-cqe.res) << std::endl;
+            }
+            stream->m_sending.clear();
+            stream->m_sendingOffset = 0U;
+            break;
+        }
+
+        stream->m_sendingOffset += static_cast<std::size_t>(cqe.res);
+        if (stream->m_sendingOffset < stream->m_sending.size()) {
+            break;
+        }
+
+        stream->m_sending.clear();
+        stream->m_sendingOffset = 0U;
+    } while (false);
+
+    if (stream->m_sending.empty() && stream->m_pending.empty() && stream->m_closed) {
+        releaseStream(*stream);
+        return;
+    }
+
+    scheduleStream(*stream);
+}
+
+void IoUringClientSocket::scheduleStream(Stream& stream)
+{
+    if (stream.m_scheduled) {
+        return;
+    }
+
+    stream.m_scheduled = true;
+    m_readyStreams.push_back(stream.m_idx);
+}
+
+void IoUringClientSocket::submitStream(Stream& stream)
+{
+    stream.m_scheduled = false;
+    if (stream.m_inFlight) {
+        return;
+    }
+
+    if (stream.m_sending.empty()) {
+        if (stream.m_pending.empty()) {
+            if (stream.m_closed) {
+                releaseStream(stream);
+            }
+            return;
+        }
+
+        stream.m_sending.swap(stream.m_pending);
+        stream.m_sendingOffset = 0U;
+    }
+
+    auto* sqe = nextSqe();
+    if (sqe == nullptr) {
+        scheduleStream(stream);
+        return;
+    }
+
+    assert(stream.m_sendingOffset < stream.m_sending.size());
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = stream.m_fd;
+    sqe->addr = reinterpret_cast<std::uintptr_t>(&stream.m_sending[stream.m_sendingOffset]);
+    sqe->len = static_cast<std::uint32_t>(stream.m_sending.size() - stream.m_sendingOffset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = userData(OpType_Stream, stream.m_idx);
+    stream.m_inFlight = true;
+}
+
+void IoUringClientSocket::releaseStream(Stream& stream)
+{
+    auto idx = stream.m_idx;
+    assert(idx < m_streams.size());
+    assert(m_streams[idx].get() == &stream);
+    stream.m_owner = nullptr;
+    m_streams[idx].reset();
+    m_freeStreams.push_back(idx);
+}
+
+void IoUringClientSocket::closeAll()
+{
+    m_notifier.reset();
+
+    for (auto& stream : m_streams) {
+        if (stream) {
+            stream->m_owner = nullptr;
+        }
+    }
+    m_streams.clear();
+    m_freeStreams.clear();
+    m_readyStreams.clear();
+
+    m_ring.close();
+    m_recvArmed = false;
+    m_recvBufsHeld.clear();
+
+    m_freeSendSlots.clear();
+    for (auto idx = MaxSendSlots; 0U < idx; --idx) {
+        m_freeSendSlots.push_back(idx - 1);
+    }
+
+    if (0 <= m_eventFd) {
+        ::close(m_eventFd);
+        m_eventFd = -1;
+    }
+
+    if (0 <= m_fd) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,139 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QSocketNotifier>
+CC_ENABLE_WARNINGS()
+
+#include "ClientSocket.h"
+#include "IoUring.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class IoUringClientSocket : public ClientSocket
+{
+    Q_OBJECT
+    typedef ClientSocket Base;
+public:
+    explicit IoUringClientSocket(QObject* parent);
+    ~IoUringClientSocket();
+
+protected:
+    virtual bool bindImpl(PortType port) override;
+    virtual void sendToImpl(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& addr) override;
+    virtual void flushImpl() override;
+    virtual BrokerStreamPtr openBrokerStreamImpl(int fd) override;
+
+private slots:
+    void completionsAvailable();
+    void aboutToBlock();
+
+private:
+    class Stream;
+    friend class Stream;
+
+    typedef std::shared_ptr<Stream> StreamPtr;
+    typedef std::vector<std::uint8_t> DataBuf;
+
+    static const unsigned RingEntries = 1024U;
+    static const unsigned RecvBufsCount = 256U;
+    static const unsigned RecvBufSize = 2048U;
+    static const IoUring::BufId RecvBufGroup = 0U;
+    static const std::size_t MaxSendSlots = 1024U;
+
+    enum OpType : std::uint64_t
+    {
+        OpType_Recv,
+        OpType_Send,
+        OpType_Stream
+    };
+
+    struct SendSlot
+    {
+        msghdr m_hdr;
+        iovec m_iov;
+        sockaddr_in m_addr;
+        DataBuf m_data;
+    };
+
+    typedef std::vector<SendSlot> SendSlotsList;
+    typedef std::vector<std::size_t> IndicesList;
+    typedef std::vector<StreamPtr> StreamsList;
+
+    static std::uint64_t userData(OpType type, std::size_t idx);
+
+    io_uring_sqe* nextSqe();
+    void armRecv();
+    void handleCqe(const io_uring_cqe& cqe);
+    void handleRecv(const io_uring_cqe& cqe);
+    void handleSend(const io_uring_cqe& cqe, std::size_t idx);
+    void handleStream(const io_uring_cqe& cqe, std::size_t idx);
+    void releaseRecvBufs();
+    void scheduleStream(Stream& stream);
+    void submitStream(Stream& stream);
+    void releaseStream(Stream& stream);
+    void closeAll();
+
+    int m_fd = -1;
+    int m_eventFd = -1;
+    IoUring m_ring;
+    std::unique_ptr<QSocketNotifier> m_notifier;
+
+    msghdr m_recvHdr;
+    bool m_recvArmed = false;
+    std::vector<IoUring::BufId> m_recvBufsHeld;
+
+    SendSlotsList m_sendSlots;
+    IndicesList m_freeSendSlots;
+
+    StreamsList m_streams;
+    IndicesList m_freeStreams;
+    IndicesList m_readyStreams;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -20,6 +20,27 @@
 #include <cassert>
 #include <iostream>
 #include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <cstdlib>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QAbstractEventDispatcher>
+#include <QtCore/QCoreApplication>
+CC_ENABLE_WARNINGS()
+
+#include "mqttsn/protocol/MsgTypeId.h"
+#include "QtClientSocket.h"
+
+#ifdef CC_MQTTSN_GW_UDP_HAS_EPOLL
+#include "EpollClientSocket.h"
+#endif // #ifdef CC_MQTTSN_GW_UDP_HAS_EPOLL
+
+#ifdef CC_MQTTSN_GW_UDP_HAS_IO_URING
+#include "IoUringClientSocket.h"
+#endif // #ifdef CC_MQTTSN_GW_UDP_HAS_IO_URING
 
 namespace mqttsn
 {
@@ -38,9 +59,36 @@ namespace
 
 const std::string UdpListenPortKey("udp_listen_port");
 const std::string UdpBroadcastPortKey("udp_broadcast_port");
+const std::string UdpIoEngineKey("udp_io_engine");
+const std::string IoEngineQtStr("qt");
+const std::string IoEngineEpollStr("epoll");
+const std::string IoEngineIoUringStr("io_uring");
+const std::string UdpBrokerFlushDelayKey("udp_broker_flush_delay_us");
+const std::string UdpStatsReportPeriodKey("udp_stats_report_period");
+const std::string UdpBrokerPoolSizeKey("udp_broker_pool_size");
+const std::string UdpBrokerPoolMaxIdleKey("udp_broker_pool_max_idle");
+const std::string UdpBrokerConnectMaxInFlightKey("udp_broker_connect_max_inflight");
+const std::string UdpBrokerConnectBackoffMinKey("udp_broker_connect_backoff_min");
+const std::string UdpBrokerConnectBackoffMaxKey("udp_broker_connect_backoff_max");
+const std::string UdpPubOnlySharedSessionsKey("udp_pub_only_shared_sessions");
+const std::string UdpFanOutKey("udp_fan_out");
+const std::string UdpPubStoreKey("udp_pub_store");
+const std::string UdpPubStoreSizeKey("udp_pub_store_size");
+const std::string PubStoreFilePrefix("cc_mqttsn_gw_pub_store_");
+const std::string PubStoreFileSuffix(".wal");
+const std::string UdpBrokerPubQueueTotalLimitKey("udp_broker_pub_queue_total_limit");
 const std::string SpaceChars(" \t");
 const std::uint16_t DefaultListenPort = 1883;
 const std::uint16_t DefaultBroadcastPort = 1883;
+const std::uint32_t BroadcastAddr = 0xffffffff;
+const unsigned MaxStatsReportPeriod = 24U * 60U * 60U;
+const unsigned DefaultBrokerPoolMaxIdle = 10U;
+const unsigned DefaultBrokerConnectMaxInFlight = 64U;
+const unsigned DefaultBrokerConnectBackoffMin = 100U;
+const unsigned DefaultBrokerConnectBackoffMax = 30000U;
+const unsigned DefaultPubOnlySharedSessions = 1U;
+const unsigned MaxPubOnlySharedSessions = 64U;
+const unsigned DefaultPubStoreSizeKb = 64U * 1024U;
 
 std::uint16_t getPortInfo(
     const Config& config,
@@ -72,25 +120,189 @@ std::uint16_t getPortInfo(
     return defaultValue;
 }
 
+std::string getStringInfo(
+    const Config& config,
+    const std::string& key,
+    const std::string& defaultValue)
+{
+    auto& map = config.configMap();
+    auto iter = map.find(key);
+    if ((iter == map.end()) ||
+        (iter->second.empty())) {
+        return defaultValue;
+    }
+
+    auto& valStr = iter->second;
+    auto spacePos = valStr.find_first_of(SpaceChars);
+    if (spacePos == std::string::npos) {
+        return valStr;
+    }
+
+    return std::string(valStr.begin(), valStr.begin() + spacePos);
+}
+
+enum class ClientMsgAction
+{
+    Drop,
+    AnswerSearchgw,
+    CreateSession,
+    CreatePubOnlySession,
+    ForwardPubOnly
+};
+
+// Classifies message received from the unknown client without any parsing
+// beyond the header, only valid CONNECT and QoS -1 PUBLISH deserve a session.
+ClientMsgAction classifyNewClientMsg(const std::uint8_t* buf, std::size_t bufSize)
+{
+    static const std::uint8_t LongLengthPrefix = 0x01;
+    static const std::uint8_t QosShift = 5U;
+    static const std::uint8_t QosMask = 0x3;
+    static const std::uint8_t QosNoGwPublish = 0x3;
+    static const std::uint8_t TopicIdTypeMask = 0x3;
+    static const std::uint8_t TopicIdTypePredefined = 0x1;
+
+    if (bufSize < 2U) {
+        return ClientMsgAction::Drop;
+    }
+
+    std::size_t msgLen = buf[0];
+    std::size_t typePos = 1U;
+    if (buf[0] == LongLengthPrefix) {
+        if (bufSize < 4U) {
+            return ClientMsgAction::Drop;
+        }
+
+        msgLen = (static_cast<std::size_t>(buf[1]) << 8) | buf[2];
+        typePos = 3U;
+    }
+
+    if ((msgLen <= typePos) || (bufSize < msgLen)) {
+        return ClientMsgAction::Drop;
+    }
+
+    auto msgType = buf[typePos];
+    if (msgType == mqttsn::protocol::MsgTypeId_SEARCHGW) {
+        return ClientMsgAction::AnswerSearchgw;
+    }
+
+    if (msgType == mqttsn::protocol::MsgTypeId_CONNECT) {
+        return ClientMsgAction::CreateSession;
+    }
+
+    auto flagsPos = typePos + 1;
+    if ((msgType != mqttsn::protocol::MsgTypeId_PUBLISH) ||
+        (msgLen <= flagsPos) ||
+        (((buf[flagsPos] >> QosShift) & QosMask) != QosNoGwPublish)) {
+        return ClientMsgAction::Drop;
+    }
+
+    if ((buf[flagsPos] & TopicIdTypeMask) == TopicIdTypePredefined) {
+        return ClientMsgAction::ForwardPubOnly;
+    }
+
+    return ClientMsgAction::CreatePubOnlySession;
+}
+
+// Returns client ID from the CONNECT message, empty string for any other
+// message. The message is expected to be verified by classifyNewClientMsg().
+std::string getConnectClientId(const std::uint8_t* buf, std::size_t bufSize)
+{
+    static const std::uint8_t LongLengthPrefix = 0x01;
+    // flags + protocol ID + duration
+    static const std::size_t ClientIdOffset = 5U;
+
+    std::size_t msgLen = buf[0];
+    std::size_t typePos = 1U;
+    if (buf[0] == LongLengthPrefix) {
+        msgLen = (static_cast<std::size_t>(buf[1]) << 8) | buf[2];
+        typePos = 3U;
+    }
+
+    auto clientIdPos = typePos + ClientIdOffset;
+    if ((bufSize < msgLen) ||
+        (msgLen <= clientIdPos) ||
+        (buf[typePos] != mqttsn::protocol::MsgTypeId_CONNECT)) {
+        return std::string();
+    }
+
+    return std::string(
+        reinterpret_cast<const char*>(buf + clientIdPos),
+        reinterpret_cast<const char*>(buf + msgLen));
+}
+
+unsigned getUnsignedInfo(
+    const Config& config,
+    const std::string& key,
+    unsigned defaultValue)
+{
+    auto valStr = getStringInfo(config, key, std::string());
+    if (valStr.empty()) {
+        return defaultValue;
+    }
+
+    try {
+        return static_cast<unsigned>(std::stoul(valStr));
+    }
+    catch (...) {
+        std::cerr << "WARNING: Invalid value of \"" << key << "\" option." << std::endl;
+    }
+
+    return defaultValue;
+}
+
 }  // namespace
 
-Mgr::Mgr(const Config& config)
+Mgr::Mgr(const Config& config, unsigned workerIdx, unsigned workersCount)
   : m_config(config),
+    m_workerIdx(workerIdx),
+    m_workersCount(workersCount),
+    m_connectScheduler(
+        getUnsignedInfo(config, UdpBrokerConnectMaxInFlightKey, DefaultBrokerConnectMaxInFlight),
+        getUnsignedInfo(config, UdpBrokerConnectBackoffMinKey, DefaultBrokerConnectBackoffMin),
+        getUnsignedInfo(config, UdpBrokerConnectBackoffMaxKey, DefaultBrokerConnectBackoffMax),
+        nullptr),
+    m_brokerRing(config.brokers()),
     m_gw(config)
 {
+    m_timerWheelTimer.setSingleShot(true);
+    connect(
+        &m_timerWheelTimer, SIGNAL(timeout()),
+        this, SLOT(timerWheelTimeout()));
+
+    m_timerWheel.setWakeupReqCb(
+        [this](unsigned ms)
+        {
+            programTimerWheel(ms);
+        });
+
+    m_brokerFlushDelayUs = getUnsignedInfo(config, UdpBrokerFlushDelayKey, 0U);
+    m_brokerFlushTimer.setSingleShot(true);
+    m_brokerFlushTimer.setTimerType(Qt::PreciseTimer);
     connect(
-        &m_socket, SIGNAL(readyRead()),
-        this, SLOT(readClientData()));
+        &m_brokerFlushTimer, SIGNAL(timeout()),
+        this, SLOT(brokerFlushTimeout()));
+
     connect(
-        &m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
-        this, SLOT(socketErrorOccurred(QAbstractSocket::SocketError)));
+        &m_statsTimer, SIGNAL(timeout()),
+        this, SLOT(reportStats()));
 
+    // Connected before any client socket is created to make sure the
+    // session data is handed over before the socket flushes its own queues.
+    auto* dispatcher = QAbstractEventDispatcher::instance();
+    if (dispatcher != nullptr) {
+        connect(
+            dispatcher, SIGNAL(aboutToBlock()),
+            this, SLOT(aboutToBlock()));
+    }
 }
 
 Mgr::~Mgr()
 {
-    m_socket.blockSignals(true);
-    m_socket.flush();
+    flushBrokerData();
+    if (m_socket) {
+        m_socket->blockSignals(true);
+        m_socket->flush();
+    }
 }
 
 bool Mgr::start()
@@ -101,10 +313,92 @@ bool Mgr::start()
         return false;
     }
 
+    auto pubOnlySessions =
+        std::min(
+            getUnsignedInfo(m_config, UdpPubOnlySharedSessionsKey, DefaultPubOnlySharedSessions),
+            MaxPubOnlySharedSessions);
+    m_pubOnlySessions.assign(pubOnlySessions, nullptr);
+
+    if (getUnsignedInfo(m_config, UdpFanOutKey, 0U) != 0U) {
+        auto clientId =
+            "cc_mqttsn_gw_fan_out_" +
+            std::to_string(QCoreApplication::applicationPid()) + '_' +
+            std::to_string(m_workerIdx);
+        m_fanOut.reset(new FanOutSource(m_timerWheel, clientId));
+        m_fanOut->setSessionCreateCb(
+            [this, clientId]() -> SessionWrapper*
+            {
+                return createSession(ClientAddr(), clientId);
+            });
+        m_fanOut->setPubReportCb(
+            [this](FanOutSource::BrokerPubInfoPtr info)
+            {
+                fanOutPublish(std::move(info));
+            });
+        m_fanOut->setSubackReportCb(
+            [this](const std::string& filter)
+            {
+                fanOutSubackReceived(filter);
+            });
+    }
+
+    auto pubStoreDir = getStringInfo(m_config, UdpPubStoreKey, std::string());
+    if ((!pubStoreDir.empty()) && (!openPubStores(pubStoreDir))) {
+        return false;
+    }
+
+    if (!m_pubStores.empty()) {
+        // The stored messages are already acknowledged to the clients,
+        // the acknowledgements must not leave before the messages are
+        // written to the disk.
+        m_socket->setSendSyncReqCb(
+            [this]()
+            {
+                syncPubStores();
+            });
+    }
+
+    m_brokerPubQueueTotalLimit = getUnsignedInfo(m_config, UdpBrokerPubQueueTotalLimitKey, 0U);
+
+    auto poolSize = getUnsignedInfo(m_config, UdpBrokerPoolSizeKey, 0U);
+    if (poolSize != 0U) {
+        auto maxIdle = getUnsignedInfo(m_config, UdpBrokerPoolMaxIdleKey, DefaultBrokerPoolMaxIdle);
+        for (auto idx = 0U; idx < m_brokerRing.size(); ++idx) {
+            auto& broker = m_brokerRing.broker(idx);
+            m_brokerPools.emplace_back(
+                new BrokerConnPool(broker.address, broker.port, poolSize, maxIdle, this));
+            m_brokerPools.back()->start();
+        }
+    }
+
+    for (auto& drainer : m_pubStoreDrainers) {
+        drainer->start();
+    }
+
+    auto statsPeriod = getUnsignedInfo(m_config, UdpStatsReportPeriodKey, 0U);
+    if (statsPeriod != 0U) {
+        m_lastStatsReport = std::chrono::steady_clock::now();
+        m_statsTimer.start(static_cast<int>(std::min(statsPeriod, MaxStatsReportPeriod) * 1000U));
+    }
+
     if (m_config.advertisePeriod() == 0) {
         return true;
     }
 
+    if (m_workerIdx != 0U) {
+        // Only first worker advertises, others just need to filter out
+        // the broadcasted ADVERTISE message if it is received.
+        auto period = m_config.advertisePeriod();
+        m_lastAdvertise = {
+            5U,
+            mqttsn::protocol::MsgTypeId_ADVERTISE,
+            m_config.gatewayId(),
+            static_cast<std::uint8_t>(period >> 8),
+            static_cast<std::uint8_t>(period)
+        };
+        return true;
+    }
+
     m_broadcastPort = getPortInfo(m_config, UdpBroadcastPortKey, DefaultBroadcastPort);
     auto broadcastFunc =
         [this](const std::uint8_t* buf, std::size_t bufSize)
@@ -114,97 +408,773 @@ bool Mgr::start()
     return m_gw.start(std::move(broadcastFunc));
 }
 
-void Mgr::readClientData()
+void Mgr::timerWheelTimeout()
+{
+    m_timerWheel.advance();
+}
+
+void Mgr::aboutToBlock()
+{
+    // Group commit of the messages stored during this iteration, which
+    // acknowledgements haven't been sent yet. The client socket requests
+    // the sync on its own before sending the queued datagrams.
+    syncPubStores();
+
+    // Not done from within the report of the session to avoid
+    // re-entering it.
+    updateBrokerPubQueueHold();
+
+    if (m_brokerFlushPending.empty()) {
+        return;
+    }
+
+    if (m_brokerFlushDelayUs == 0U) {
+        flushBrokerData();
+        return;
+    }
+
+    auto elapsed =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_brokerFlushFirstReq).count();
+    if (static_cast<decltype(elapsed)>(m_brokerFlushDelayUs) <= elapsed) {
+        flushBrokerData();
+        return;
+    }
+
+    if (m_brokerFlushTimer.isActive()) {
+        return;
+    }
+
+    auto remUs = static_cast<decltype(elapsed)>(m_brokerFlushDelayUs) - elapsed;
+    m_brokerFlushTimer.start(static_cast<int>((remUs + 999) / 1000));
+}
+
+void Mgr::clientDataReleased()
+{
+    // The payloads of the forwarded publishes point into the received
+    // datagrams. Without the flush delay they are written to the broker
+    // right away, otherwise copied to be written later.
+    if (m_brokerFlushDelayUs == 0U) {
+        flushBrokerData();
+        return;
+    }
+
+    for (auto* session : m_brokerFlushPending) {
+        session->retainBrokerData();
+    }
+}
+
+void Mgr::brokerFlushTimeout()
+{
+    flushBrokerData();
+}
+
+void Mgr::reportStats()
+{
+    auto brokerInputHighWaterMark = m_brokerInputHighWaterMark;
+    m_sessions.forEach(
+        [&brokerInputHighWaterMark](const SessionWrapper& s)
+        {
+            brokerInputHighWaterMark = std::max(brokerInputHighWaterMark, s.brokerInputHighWaterMark());
+        });
+
+    auto now = std::chrono::steady_clock::now();
+    auto elapsedMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - m_lastStatsReport).count();
+    auto connects = m_connectScheduler.admittedCount() - m_lastReportedConnects;
+    unsigned long long connectsRate = 0U;
+    if (0 < elapsedMs) {
+        connectsRate = (connects * 1000U) / static_cast<unsigned long long>(elapsedMs);
+    }
+    m_lastStatsReport = now;
+    m_lastReportedConnects = m_connectScheduler.admittedCount();
+
+    std::cout << "STATS (worker " << m_workerIdx << "): " <<
+        "sessions=" << m_sessions.size() << ' ' <<
+        "broker_input_hwm=" << brokerInputHighWaterMark << ' ' <<
+        "searchgw_answered=" << m_searchgwAnswered << ' ' <<
+        "unknown_client_dropped=" << m_unknownClientDropped << ' ' <<
+        "pub_only_forwarded=" << m_pubOnlyForwarded << ' ' <<
+        "fan_out_filters=" << m_fanOutSubs.filtersCount() << ' ' <<
+        "fan_out_received=" << m_fanOutReceived << ' ' <<
+        "fan_out_delivered=" << m_fanOutDelivered << ' ' <<
+        "pub_stored=" << m_pubStored << ' ' <<
+        "pub_store_rejected=" << m_pubStoreRejected << ' ' <<
+        "broker_pub_queue=" << m_brokerPubQueueTotal << ' ' <<
+        "broker_pub_queue_hwm=" << m_brokerPubQueueTotalHighWaterMark << ' ' <<
+        "broker_pub_queue_holds=" << m_brokerPubQueueHolds << ' ' <<
+        "broker_connect_queue=" << m_connectScheduler.queueDepth() << ' ' <<
+        "broker_connect_inflight=" << m_connectScheduler.inFlight() << ' ' <<
+        "broker_connect_rate=" << connectsRate << "/s " <<
+        "broker_connect_failed=" << m_connectScheduler.failedCount() << ' ' <<
+        "broker_connect_backoff_ms=" << m_connectScheduler.currentBackoffMs();
+
+    for (auto idx = 0U; idx < m_brokerRing.size(); ++idx) {
+        auto& broker = m_brokerRing.broker(idx);
+        std::cout << "\n    broker " << broker.address << ':' << broker.port << ": " <<
+            "state=" << (m_brokerRing.isUp(idx) ? "up" : "down") << ' ' <<
+            "sessions=" << m_brokerRing.sessionsCount(idx) << ' ' <<
+            "connect_ms=" << m_brokerRing.avgConnectLatencyMs(idx) << ' ' <<
+            "connect_failed=" << m_brokerRing.connectFailures(idx);
+
+        if (idx < m_brokerPools.size()) {
+            auto& pool = *m_brokerPools[idx];
+            std::cout << ' ' <<
+                "pool_ready=" << pool.readyCount() << '/' << pool.size() << ' ' <<
+                "pool_hits=" << pool.hits() << ' ' <<
+                "pool_misses=" << pool.misses() << ' ' <<
+                "pool_refill_ms=" << pool.avgRefillLatencyMs();
+        }
+
+        if (idx < m_pubStores.size()) {
+            std::cout << ' ' <<
+                "store_used=" << m_pubStores[idx]->usedSize() << '/' << m_pubStores[idx]->capacity() << ' ' <<
+                "store_inflight=" << m_pubStoreDrainers[idx]->inFlightCount() << ' ' <<
+                "store_connected=" << (m_pubStoreDrainers[idx]->isConnected() ? 1 : 0);
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+Mgr::ClientSocketPtr Mgr::createClientSocket(const std::string& engine)
+{
+#ifdef CC_MQTTSN_GW_UDP_HAS_IO_URING
+    if (engine == IoEngineIoUringStr) {
+        return ClientSocketPtr(new IoUringClientSocket(this));
+    }
+#endif // #ifdef CC_MQTTSN_GW_UDP_HAS_IO_URING
+
+#ifdef CC_MQTTSN_GW_UDP_HAS_EPOLL
+    if (engine == IoEngineEpollStr) {
+        return ClientSocketPtr(new EpollClientSocket(this));
+    }
+#endif // #ifdef CC_MQTTSN_GW_UDP_HAS_EPOLL
+
+    if (engine != IoEngineQtStr) {
+        std::cerr << "WARNING: Unsupported I/O engine \"" << engine <<
+            "\", using \"" << IoEngineQtStr << "\" instead." << std::endl;
+    }
+
+    return ClientSocketPtr(new QtClientSocket(this));
+}
+
+void Mgr::clientDataReceived(
+    const std::uint8_t* buf,
+    std::size_t bufSize,
+    const ClientAddr& senderAddr)
+{
+    if ((bufSize == m_lastAdvertise.size()) &&
+        (std::equal(buf, buf + bufSize, m_lastAdvertise.begin()))) {
+        return;
+    }
+
+    auto* existingSession = m_sessions.find(senderAddr);
+    if (existingSession != nullptr) {
+        existingSession->dataFromClientSocket(buf, bufSize);
+        return;
+    }
+
+    auto action = classifyNewClientMsg(buf, bufSize);
+    if (action == ClientMsgAction::AnswerSearchgw) {
+        ++m_searchgwAnswered;
+        const std::uint8_t gwinfo[] = {
+            3U,
+            mqttsn::protocol::MsgTypeId_GWINFO,
+            m_config.gatewayId()
+        };
+        m_socket->sendTo(gwinfo, sizeof(gwinfo), senderAddr);
+        return;
+    }
+
+    if ((action == ClientMsgAction::ForwardPubOnly) &&
+        (!m_pubOnlySessions.empty())) {
+        forwardPubOnly(buf, bufSize, senderAddr);
+        return;
+    }
+
+    if (action == ClientMsgAction::Drop) {
+        ++m_unknownClientDropped;
+        return;
+    }
+
+    auto clientId = getConnectClientId(buf, bufSize);
+    if (clientId.empty()) {
+        clientId = m_config.defaultClientId();
+    }
+
+    auto* session = createSession(senderAddr, clientId);
+    m_sessions.insert(session);
+
+    // Client sending CONNECT waits for CONNACK and is served first
+    auto connectPriority = SessionWrapper::ConnectPriority::ClientWaiting;
+    if (action != ClientMsgAction::CreateSession) {
+        connectPriority = SessionWrapper::ConnectPriority::Normal;
+    }
+
+    if (!session->start(connectPriority)) {
+        assert(!"Unexpected error");
+        return;
+    }
+
+    session->dataFromClientSocket(buf, bufSize);
+}
+
+SessionWrapper* Mgr::createSession(const ClientAddr& addr, const std::string& clientId)
+{
+    return createSession(addr, m_brokerRing.place(clientId));
+}
+
+SessionWrapper* Mgr::createSession(const ClientAddr& addr, std::size_t brokerIdx)
+{
+    std::unique_ptr<SessionWrapper> session(
+        new SessionWrapper(m_config, m_timerWheel, m_connectScheduler, this));
+    session->setClientAddr(addr);
+
+    session->setBroker(brokerIdx, m_brokerRing.broker(brokerIdx));
+    m_brokerRing.sessionAdded(brokerIdx);
+
+    if (m_brokerPubQueueTotalLimit != 0U) {
+        session->setBrokerInputPausable(true);
+    }
+
+    session->setBrokerStreamOpenCb(
+        [this](int fd) -> BrokerStreamPtr
+        {
+            return m_socket->openBrokerStream(fd);
+        });
+
+    auto& sessionRef = *session;
+    session->setSendDataReqCb(
+        [this, &sessionRef](const std::uint8_t* data, const std::size_t dataLen)
+        {
+            sendToClient(sessionRef, data, dataLen);
+        });
+
+    if (brokerIdx < m_brokerPools.size()) {
+        auto* pool = m_brokerPools[brokerIdx].get();
+        session->setBrokerSocketReqCb(
+            [pool]() -> SessionWrapper::BrokerSocketPtr
+            {
+                return pool->take();
+            });
+    }
+
+    session->setBrokerConnectReportCb(
+        [this](const SessionWrapper& s, bool success, unsigned latencyMs)
+        {
+            m_brokerRing.connectCompleted(s.getBrokerIdx(), success, latencyMs);
+        });
+
+    session->setBrokerFlushReqCb(
+        [this](SessionWrapper& s)
+        {
+            brokerFlushRequested(s);
+        });
+
+    session->setBrokerPubQueueReportCb(
+        [this](SessionWrapper& s, std::size_t prevBytes, std::size_t bytes)
+        {
+            brokerPubQueueUpdated(s, prevBytes, bytes);
+        });
+
+    session->setTermNotifyCb(
+        [this](const SessionWrapper& s)
+        {
+            sessionTerminated(s);
+        });
+
+    if (m_fanOut) {
+        session->setSubscribeFanOutReqCb(
+            [this, &sessionRef](const std::string& topic, std::uint8_t qos) -> bool
+            {
+                return fanOutSubscribe(sessionRef, topic, qos);
+            });
+
+        session->setUnsubscribeFanOutReqCb(
+            [this, &sessionRef](const std::string& topic) -> bool
+            {
+                return fanOutUnsubscribe(sessionRef, topic);
+            });
+
+        session->setClientConnectedReportCb(
+            [this](SessionWrapper& s, const std::string& clientId)
+            {
+                fanOutClientConnected(s, clientId);
+            });
+    }
+
+    if (!m_pubStores.empty()) {
+        session->setClientPubStoreReqCb(
+            [this, &sessionRef](const std::string& topic, const std::uint8_t* buf, std::size_t bufLen, std::uint8_t qos, bool retain) -> bool
+            {
+                return storePub(sessionRef.getBrokerIdx(), topic, buf, bufLen, qos, retain);
+            });
+    }
+
+    // Owned by this object as QObject parent
+    return session.release();
+}
+
+void Mgr::sessionTerminated(const SessionWrapper& session)
+{
+    auto pendingIter = std::find(m_brokerFlushPending.begin(), m_brokerFlushPending.end(), &session);
+    if (pendingIter != m_brokerFlushPending.end()) {
+        m_brokerFlushPending.erase(pendingIter);
+    }
+
+    auto holdIter = std::find(m_brokerPubQueueHoldPending.begin(), m_brokerPubQueueHoldPending.end(), &session);
+    if (holdIter != m_brokerPubQueueHoldPending.end()) {
+        m_brokerPubQueueHoldPending.erase(holdIter);
+    }
+
+    assert(session.brokerPubQueueBytes() <= m_brokerPubQueueTotal);
+    m_brokerPubQueueTotal -= session.brokerPubQueueBytes();
+
+    m_brokerInputHighWaterMark =
+        std::max(m_brokerInputHighWaterMark, session.brokerInputHighWaterMark());
+    m_brokerRing.sessionRemoved(session.getBrokerIdx());
+
+    m_socket->flush();
+
+    for (auto& drainer : m_pubStoreDrainers) {
+        if (drainer->isSession(session)) {
+            drainer->sessionTerminated();
+            return;
+        }
+    }
+
+    if (m_fanOut) {
+        if (m_fanOut->isSession(session)) {
+            m_fanOut->sessionTerminated();
+            return;
+        }
+
+        fanOutDetach(session);
+    }
+
+    auto sharedIter = std::find(m_pubOnlySessions.begin(), m_pubOnlySessions.end(), &session);
+    if (sharedIter != m_pubOnlySessions.end()) {
+        *sharedIter = nullptr;
+        return;
+    }
+
+    if (!m_sessions.erase(session.getClientAddr())) {
+        assert(!"The session wasn't found");
+    }
+}
+
+void Mgr::forwardPubOnly(
+    const std::uint8_t* buf,
+    std::size_t bufSize,
+    const ClientAddr& senderAddr)
+{
+    assert(!m_pubOnlySessions.empty());
+    ++m_pubOnlyForwarded;
+    auto slotIdx = senderAddr.hash() % m_pubOnlySessions.size();
+    auto& sessionSlot = m_pubOnlySessions[slotIdx];
+    bool created = false;
+    if (sessionSlot == nullptr) {
+        // Every shared session connects to the broker with its own client
+        // ID, the same ID would make the broker drop the other connection.
+        auto clientId = m_config.defaultClientId();
+        if (!clientId.empty()) {
+            clientId +=
+                '_' + std::to_string(m_workerIdx) +
+                '_' + std::to_string(slotIdx);
+        }
+
+        sessionSlot = createSession(senderAddr, clientId);
+        sessionSlot->setDefaultClientId(clientId);
+        created = true;
+    }
+
+    // The slot is cleared if the session terminates while processing the
+    // message, the object itself is deleted later.
+    auto* session = sessionSlot;
+
+    // Any response (e.g. rejection of unknown topic ID) is sent to the
+    // sender of the currently processed message. The session is shared,
+    // whatever it sends to the client afterwards has no recipient and is
+    // dropped.
+    session->setClientAddr(senderAddr);
+
+    if (created && (!session->start(SessionWrapper::ConnectPriority::Normal))) {
+        assert(!"Unexpected error");
+        session->setClientAddr(ClientAddr());
+        return;
+    }
+
+    session->dataFromClientSocket(buf, bufSize);
+    session->setClientAddr(ClientAddr());
+}
+
+bool Mgr::fanOutSubscribe(SessionWrapper& session, const std::string& topic, std::uint8_t qos)
+{
+    assert(m_fanOut);
+    FanOutRetainedReq req;
+    req.m_session = &session;
+    req.m_filter = topic;
+    m_fanOutRetainedReqs.push_back(std::move(req));
+
+    // The SUBSCRIBE is sent for every new subscriber to get the retained
+    // messages from the broker.
+    m_fanOutSubs.add(topic, &session, qos);
+    m_fanOut->subscribe(topic);
+    return true;
+}
+
+bool Mgr::fanOutUnsubscribe(SessionWrapper& session, const std::string& topic)
 {
-    typedef std::vector<std::uint8_t> DataBuf;
+    assert(m_fanOut);
+    fanOutDropRetainedReqs(&session, &topic);
+    if (m_fanOutSubs.remove(topic, &session) &&
+        (m_fanOutDetachedRefs.find(topic) == m_fanOutDetachedRefs.end())) {
+        m_fanOut->unsubscribe(topic);
+    }
+    return true;
+}
 
-    DataBuf data;
-    QHostAddress senderAddress;
-    quint16 senderPort;
+void Mgr::fanOutPublish(FanOutSource::BrokerPubInfoPtr info)
+{
+    ++m_fanOutReceived;
+    m_fanOutMatches.clear();
+    m_fanOutSubs.match(
+        info->m_topic,
+        [this](SessionWrapper* s, std::uint8_t qos)
+        {
+            m_fanOutMatches.emplace_back(s, qos);
+        });
 
-    while (m_socket.hasPendingDatagrams()) {
-        data.resize(m_socket.pendingDatagramSize());
-        auto readBytes = m_socket.readDatagram(
-            reinterpret_cast<char*>(&data[0]),
-            data.size(),
-            &senderAddress,
-            &senderPort);
-        assert(readBytes == static_cast<decltype(readBytes)>(data.size()));
-        static_cast<void>(readBytes);
+    if (m_fanOutMatches.empty()) {
+        return;
+    }
 
-        if (data == m_lastAdvertise) {
+    // Deliver once per session with the highest QoS of the matching subscriptions
+    std::sort(m_fanOutMatches.begin(), m_fanOutMatches.end());
+    static const std::size_t QosVariantsCount = 3U;
+    FanOutSource::BrokerPubInfoPtr variants[QosVariantsCount];
+    for (auto idx = 0U; idx < m_fanOutMatches.size(); ++idx) {
+        auto& m = m_fanOutMatches[idx];
+        if (((idx + 1) < m_fanOutMatches.size()) &&
+            (m_fanOutMatches[idx + 1].first == m.first)) {
             continue;
         }
 
-        auto addrStr = senderAddress.toString();
-        auto url = QString("%1:%2").arg(addrStr).arg(senderPort);
-        auto iter = m_sessions.find(url);
-        if (iter != m_sessions.end()) {
-            assert(iter->second != nullptr);
-            iter->second->dataFromClient(&data[0], data.size());
+        if (info->m_retain && (!fanOutRetainedExpected(m.first))) {
             continue;
         }
 
-        std::unique_ptr<SessionWrapper> session(new SessionWrapper(m_config, this));
-        session->setClientAddr(addrStr);
-        session->setClientPort(senderPort);
+        auto qos = std::min(std::min(m.second, info->m_qos), static_cast<std::uint8_t>(QosVariantsCount - 1));
+        auto& variant = variants[qos];
+        if (!variant) {
+            if (qos == info->m_qos) {
+                variant = info;
+            }
+            else {
+                std::shared_ptr<mqttsn::gateway::Session::BrokerPubInfo> copy(
+                    new mqttsn::gateway::Session::BrokerPubInfo(*info));
+                copy->m_qos = qos;
+                variant = std::move(copy);
+            }
+        }
+
+        ++m_fanOutDelivered;
+        m.first->addBrokerPub(variant);
+    }
+}
 
-        auto& sessionRef = *session;
-        session->setSendDataReqCb(
-            [this, &sessionRef](const std::uint8_t* buf, const std::size_t bufLen)
+void Mgr::fanOutSubackReceived(const std::string& filter)
+{
+    // The retained messages of the previous subscription have been
+    // received before this SUBACK.
+    m_fanOutRetainedReqs.erase(
+        std::remove_if(
+            m_fanOutRetainedReqs.begin(), m_fanOutRetainedReqs.end(),
+            [](const FanOutRetainedReq& req) -> bool
             {
-                sendToClient(sessionRef, buf, bufLen);
-            });
+                return req.m_acked;
+            }),
+        m_fanOutRetainedReqs.end());
+
+    for (auto& req : m_fanOutRetainedReqs) {
+        if (req.m_filter == filter) {
+            req.m_acked = true;
+        }
+    }
+}
 
-        session->setTermNotifyCb(
-            [this](const SessionWrapper& s)
+void Mgr::fanOutClientConnected(SessionWrapper& session, const std::string& clientId)
+{
+    auto detachedIter = m_fanOutDetached.find(clientId);
+    if (detachedIter == m_fanOutDetached.end()) {
+        return;
+    }
+
+    auto filters = std::move(detachedIter->second);
+    m_fanOutDetached.erase(detachedIter);
+    for (auto& f : filters) {
+        if (!session.isCleanSession()) {
+            m_fanOutSubs.add(f.first, &session, f.second);
+        }
+
+        auto refsIter = m_fanOutDetachedRefs.find(f.first);
+        assert(refsIter != m_fanOutDetachedRefs.end());
+        assert(0U < refsIter->second);
+        --refsIter->second;
+        if (0U < refsIter->second) {
+            continue;
+        }
+
+        m_fanOutDetachedRefs.erase(refsIter);
+        if (!m_fanOutSubs.hasSubs(f.first)) {
+            m_fanOut->unsubscribe(f.first);
+        }
+    }
+}
+
+void Mgr::fanOutDetach(const SessionWrapper& session)
+{
+    fanOutDropRetainedReqs(&session, nullptr);
+
+    // MQTT v3.1.1 doesn't define expiry of the session, the subscriptions
+    // are kept until the client connects with clean session.
+    auto& clientId = session.clientId();
+    if ((!session.isCleanSession()) && (!clientId.empty())) {
+        auto& filters = m_fanOutDetached[clientId];
+        m_fanOutSubs.forEachFilter(
+            &session,
+            [this, &filters](const std::string& filter, std::uint8_t qos)
             {
-                auto key = QString("%1:%2").arg(s.getClientAddr()).arg(s.getClientPort());
-                auto it = m_sessions.find(key);
-                if (it == m_sessions.end()) {
-                    assert(!"The session wasn't found");
+                auto iter =
+                    std::find_if(
+                        filters.begin(), filters.end(),
+                        [&filter](const FanOutFiltersList::value_type& elem) -> bool
+                        {
+                            return elem.first == filter;
+                        });
+
+                if (iter != filters.end()) {
+                    iter->second = qos;
                     return;
                 }
 
-                m_socket.flush();
-                m_sessions.erase(it);
+                filters.emplace_back(filter, qos);
+                ++m_fanOutDetachedRefs[filter];
+            });
+
+        if (filters.empty()) {
+            m_fanOutDetached.erase(clientId);
+        }
+    }
+
+    m_fanOutSubs.removeAll(
+        &session,
+        [this](const std::string& filter)
+        {
+            if (m_fanOutDetachedRefs.find(filter) == m_fanOutDetachedRefs.end()) {
+                m_fanOut->unsubscribe(filter);
+            }
+        });
+}
+
+bool Mgr::fanOutRetainedExpected(const SessionWrapper* session) const
+{
+    return
+        std::any_of(
+            m_fanOutRetainedReqs.begin(), m_fanOutRetainedReqs.end(),
+            [session](const FanOutRetainedReq& req) -> bool
+            {
+                return req.m_acked && (req.m_session == session);
             });
+}
 
-        m_sessions.insert(std::make_pair(url, session.get()));
-        auto sessionPtr = session.release();
+void Mgr::fanOutDropRetainedReqs(const SessionWrapper* session, const std::string* filter)
+{
+    m_fanOutRetainedReqs.erase(
+        std::remove_if(
+            m_fanOutRetainedReqs.begin(), m_fanOutRetainedReqs.end(),
+            [session, filter](const FanOutRetainedReq& req) -> bool
+            {
+                return
+                    (req.m_session == session) &&
+                    ((filter == nullptr) || (req.m_filter == *filter));
+            }),
+        m_fanOutRetainedReqs.end());
+}
 
-        if (!sessionPtr->start()) {
-            assert(!"Unexpected error");
+bool Mgr::openPubStores(const std::string& dir)
+{
+    auto sizeKb = getUnsignedInfo(m_config, UdpPubStoreSizeKey, DefaultPubStoreSizeKb);
+    for (auto idx = 0U; idx < m_brokerRing.size(); ++idx) {
+        auto name = pubStoreName(m_workerIdx, m_brokerRing.broker(idx));
+        std::unique_ptr<PubStore> store(new PubStore);
+        if (!store->open(dir + '/' + name + PubStoreFileSuffix, static_cast<std::size_t>(sizeKb) * 1024U)) {
+            return false;
+        }
+
+        addPubStore(std::move(store), name, idx);
+    }
+
+    return adoptStrayPubStores(dir, static_cast<std::size_t>(sizeKb) * 1024U);
+}
+
+bool Mgr::adoptStrayPubStores(const std::string& dir, std::size_t size)
+{
+    // The stores of the workers which don't exist any more (the number of
+    // workers has been reduced) are drained by the worker with the same
+    // remainder of the index division.
+    std::vector<std::string> names;
+    if (!PubStore::listFiles(dir, PubStoreFilePrefix, names)) {
+        return false;
+    }
+
+    std::sort(names.begin(), names.end());
+    for (auto& fileName : names) {
+        auto suffixPos = fileName.size() - std::min(fileName.size(), PubStoreFileSuffix.size());
+        if (fileName.compare(suffixPos, std::string::npos, PubStoreFileSuffix) != 0) {
+            continue;
+        }
+
+        auto name = fileName.substr(0, suffixPos);
+        auto workerStr = name.substr(PubStoreFilePrefix.size());
+        auto sepPos = workerStr.find('_');
+        if ((sepPos == 0U) ||
+            (sepPos == std::string::npos) ||
+            (workerStr.find_first_not_of("0123456789") != sepPos)) {
             continue;
         }
 
-        sessionPtr->dataFromClient(&data[0], data.size());
+        auto workerIdx = std::strtoul(workerStr.c_str(), nullptr, 10);
+        if ((workerIdx < m_workersCount) ||
+            ((workerIdx % m_workersCount) != m_workerIdx)) {
+            continue;
+        }
+
+        auto brokerIdx = m_brokerRing.size();
+        for (auto idx = 0U; idx < m_brokerRing.size(); ++idx) {
+            if (name == pubStoreName(static_cast<unsigned>(workerIdx), m_brokerRing.broker(idx))) {
+                brokerIdx = idx;
+                break;
+            }
+        }
+
+        auto path = dir + '/' + fileName;
+        if (m_brokerRing.size() <= brokerIdx) {
+            std::cerr << "WARNING: Publish store " << path <<
+                " belongs to the broker which is not configured, its messages are not delivered" << std::endl;
+            continue;
+        }
+
+        std::unique_ptr<PubStore> store(new PubStore);
+        if (!store->open(path, size)) {
+            return false;
+        }
+
+        if (store->empty()) {
+            store->remove();
+            continue;
+        }
+
+        std::cerr << "WARNING: Publish store " << path <<
+            " of worker " << workerIdx << " is drained by worker " << m_workerIdx << std::endl;
+
+        // Only drained, the new messages are stored by the stores of
+        // the existing workers.
+        addPubStore(std::move(store), name, brokerIdx);
     }
+
+    return true;
+}
+
+void Mgr::addPubStore(std::unique_ptr<PubStore> store, const std::string& name, std::size_t brokerIdx)
+{
+    // The client ID is the same after restart, the broker keeps the
+    // state of the unacknowledged messages of the session.
+    std::unique_ptr<PubStoreDrainer> drainer(
+        new PubStoreDrainer(*store, m_timerWheel, name));
+    drainer->setSessionCreateCb(
+        [this, brokerIdx]() -> SessionWrapper*
+        {
+            return createSession(ClientAddr(), brokerIdx);
+        });
+
+    m_pubStores.push_back(std::move(store));
+    m_pubStoreDrainers.push_back(std::move(drainer));
 }
 
-void Mgr::socketErrorOccurred(QAbstractSocket::SocketError err)
+std::string Mgr::pubStoreName(unsigned workerIdx, const BrokerRing::BrokerInfo& broker)
 {
-    static_cast<void>(err);
-    std::cerr << "ERROR: UDP Socket: " << m_socket.errorString().toStdString() << std::endl;
+    // The file name depends on the broker address, not on the position
+    // in the configuration, to deliver the stored messages to the same
+    // broker after restart.
+    auto brokerHash = BrokerRing::hash(broker.address + ':' + std::to_string(broker.port));
+    char hashStr[17] = {0};
+    std::snprintf(hashStr, sizeof(hashStr), "%016llx", static_cast<unsigned long long>(brokerHash));
+    return PubStoreFilePrefix + std::to_string(workerIdx) + '_' + hashStr;
 }
 
-bool Mgr::doListen()
+void Mgr::syncPubStores()
 {
-    if (m_port == 0) {
-        return false;
+    for (auto& store : m_pubStores) {
+        store->sync();
     }
+}
 
-    if (!m_socket.bind(QHostAddress::AnyIPv4, m_port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
-        std::cerr << "ERROR: Failed to bind UDP socket to local port " << m_port << std::endl;
+bool Mgr::storePub(
+    std::size_t brokerIdx,
+    const std::string& topic,
+    const std::uint8_t* buf,
+    std::size_t bufLen,
+    std::uint8_t qos,
+    bool retain)
+{
+    assert(brokerIdx < m_pubStores.size());
+    if (!m_pubStores[brokerIdx]->append(topic, buf, bufLen, qos, retain)) {
+        // The session forwards the message on its own
+        ++m_pubStoreRejected;
         return false;
     }
 
-    if (!m_socket.open(QUdpSocket::ReadWrite)) {
-        std::cerr << "ERROR: Failed to open UDP socket" << std::endl;
+    ++m_pubStored;
+    m_pubStoreDrainers[brokerIdx]->dataStored();
+    return true;
+}
+
+bool Mgr::doListen()
+{
+    if (m_port == 0) {
         return false;
     }
 
-    return true;
+    auto engine = getStringInfo(m_config, UdpIoEngineKey, IoEngineQtStr);
+    while (true) {
+        m_socket = createClientSocket(engine);
+        m_socket->setReusePort(1U < m_workersCount);
+        m_socket->setDataReportCb(
+            [this](const std::uint8_t* buf, std::size_t bufSize, const ClientAddr& addr)
+            {
+                clientDataReceived(buf, bufSize, addr);
+            });
+        m_socket->setDataReleaseCb(
+            [this]()
+            {
+                clientDataReleased();
+            });
+
+        if (m_socket->bind(m_port)) {
+            return true;
+        }
+
+        if (engine != IoEngineIoUringStr) {
+            return false;
+        }
+
+        // io_uring may be unavailable or restricted in the running kernel,
+        // fall back to the next best engine.
+        engine = IoEngineEpollStr;
+        std::cerr << "WARNING: Falling back to \"" << engine << "\" I/O engine." << std::endl;
+    }
 }
 
 void Mgr::sendToClient(
@@ -212,44 +1182,103 @@ void Mgr::sendToClient(
     const std::uint8_t* buf,
     std::size_t bufSize)
 {
-    std::size_t writtenCount = 0;
-    while (writtenCount < bufSize) {
-        auto remSize = bufSize - writtenCount;
-        auto count =
-            m_socket.writeDatagram(
-                reinterpret_cast<const char*>(&buf[writtenCount]),
-                remSize,
-                QHostAddress(session.getClientAddr()),
-                session.getClientPort());
-
-        if (count < 0) {
-            std::cerr << "ERROR: Failed to write to UDP socket!" << std::endl;
-            return;
-        }
-
-        writtenCount += count;
+    auto& addr = session.getClientAddr();
+    if (!addr.isValid()) {
+        // Shared publish-only and fan-out sessions
+        return;
     }
+
+    m_socket->sendTo(buf, bufSize, addr);
 }
 
 void Mgr::broadcastAdvertise(const std::uint8_t* buf, std::size_t bufSize)
 {
     m_lastAdvertise.assign(buf, buf + bufSize);
-    std::size_t writtenCount = 0;
-    while (writtenCount < bufSize) {
-        auto remSize = bufSize - writtenCount;
-        auto count =
-            m_socket.writeDatagram(
-                reinterpret_cast<const char*>(&buf[writtenCount]),
-                remSize,
-                QHostAddress::Broadcast,
-                m_broadcastPort);
-
-        if (count < 0) {
-            std::cerr << "ERROR: Failed to broadcast advertise data!" << std::endl;
-            return;
-        }
+    m_socket->sendTo(buf, bufSize, ClientAddr::fromIPv4(BroadcastAddr, m_broadcastPort));
+}
+
+void Mgr::programTimerWheel(unsigned ms)
+{
+    m_timerWheelTimer.start(static_cast<int>(std::min(ms, static_cast<unsigned>(std::numeric_limits<int>::max()))));
+}
+
+void Mgr::brokerFlushRequested(SessionWrapper& session)
+{
+    if (m_brokerFlushPending.empty()) {
+        m_brokerFlushFirstReq = std::chrono::steady_clock::now();
+    }
+
+    m_brokerFlushPending.push_back(&session);
+}
+
+void Mgr::flushBrokerData()
+{
+    m_brokerFlushTimer.stop();
+    auto pending = std::move(m_brokerFlushPending);
+    m_brokerFlushPending.clear();
+    for (auto* session : pending) {
+        session->flushBrokerData();
+    }
+
+    if (m_brokerFlushPending.empty()) {
+        // Reuse allocated memory
+        pending.clear();
+        m_brokerFlushPending.swap(pending);
+    }
+}
+
+void Mgr::brokerPubQueueUpdated(SessionWrapper& session, std::size_t prevBytes, std::size_t bytes)
+{
+    assert(prevBytes <= m_brokerPubQueueTotal);
+    m_brokerPubQueueTotal = (m_brokerPubQueueTotal - prevBytes) + bytes;
+    m_brokerPubQueueTotalHighWaterMark = std::max(m_brokerPubQueueTotalHighWaterMark, m_brokerPubQueueTotal);
+
+    if (m_brokerPubQueueHeld && (prevBytes == 0U) && (bytes != 0U)) {
+        m_brokerPubQueueHoldPending.push_back(&session);
+    }
+}
+
+void Mgr::updateBrokerPubQueueHold()
+{
+    if (m_brokerPubQueueTotalLimit == 0U) {
+        return;
+    }
+
+    if ((!m_brokerPubQueueHeld) && (m_brokerPubQueueTotalLimit <= m_brokerPubQueueTotal)) {
+        // Hold the broker input of the sessions that accumulate the data,
+        // the others don't contribute to the total.
+        m_brokerPubQueueHeld = true;
+        ++m_brokerPubQueueHolds;
+        m_brokerPubQueueHoldPending.clear();
+        forEachSession(
+            [](SessionWrapper& s)
+            {
+                if (s.brokerPubQueueBytes() != 0U) {
+                    s.setBrokerInputHeld(true);
+                }
+            });
+        return;
+    }
+
+    if (!m_brokerPubQueueHeld) {
+        return;
+    }
+
+    if (m_brokerPubQueueTotal <= (m_brokerPubQueueTotalLimit / 2U)) {
+        m_brokerPubQueueHeld = false;
+        m_brokerPubQueueHoldPending.clear();
+        forEachSession(
+            [](SessionWrapper& s)
+            {
+                s.setBrokerInputHeld(false);
+            });
+        return;
+    }
 
-        writtenCount += count;
+    auto pending = std::move(m_brokerPubQueueHoldPending);
+    m_brokerPubQueueHoldPending.clear();
+    for (auto* s : pending) {
+        s->setBrokerInputHeld(true);
     }
 }
 
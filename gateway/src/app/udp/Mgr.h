@@ -20,7 +20,9 @@
 
 #include <memory>
 #include <list>
+#include <map>
 #include <vector>
+#include <chrono>
 #include <cstdint>
 
 
@@ -28,12 +30,22 @@
 
 CC_DISABLE_WARNINGS()
 #include <QtCore/QObject>
-#include <QtNetwork/QUdpSocket>
+#include <QtCore/QTimer>
 CC_ENABLE_WARNINGS()
 
 #include "mqttsn/gateway/Config.h"
+#include "ClientSocket.h"
+#include "ClientAddrMap.h"
 #include "GatewayWrapper.h"
 #include "SessionWrapper.h"
+#include "TimerWheel.h"
+#include "BrokerConnPool.h"
+#include "BrokerRing.h"
+#include "ConnectScheduler.h"
+#include "FanOutSource.h"
+#include "PubStore.h"
+#include "PubStoreDrainer.h"
+#include "TopicTrie.h"
 
 namespace mqttsn
 {
@@ -51,29 +63,142 @@ class Mgr : public QObject
 {
     Q_OBJECT
 public:
-    explicit Mgr(const Config& config);
+    explicit Mgr(const Config& config, unsigned workerIdx = 0U, unsigned workersCount = 1U);
     ~Mgr();
     bool start();
 
 private slots:
-    void readClientData();
-    void socketErrorOccurred(QAbstractSocket::SocketError err);
+    void timerWheelTimeout();
+    void aboutToBlock();
+    void brokerFlushTimeout();
+    void reportStats();
 
 private:
-    typedef unsigned short PortType;
-    typedef std::map<QString, SessionWrapper*> SessionMap;
+    typedef ClientSocket::PortType PortType;
+    typedef ClientAddrMap<SessionWrapper> SessionMap;
+    typedef std::unique_ptr<ClientSocket> ClientSocketPtr;
 
+    ClientSocketPtr createClientSocket(const std::string& engine);
     bool doListen();
+    void clientDataReceived(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& senderAddr);
+    void clientDataReleased();
     void sendToClient(
         const SessionWrapper& session,
         const std::uint8_t* buf,
         std::size_t bufSize);
+    SessionWrapper* createSession(const ClientAddr& addr, const std::string& clientId);
+    SessionWrapper* createSession(const ClientAddr& addr, std::size_t brokerIdx);
+    void sessionTerminated(const SessionWrapper& session);
+    void forwardPubOnly(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& senderAddr);
+    bool fanOutSubscribe(SessionWrapper& session, const std::string& topic, std::uint8_t qos);
+    bool fanOutUnsubscribe(SessionWrapper& session, const std::string& topic);
+    void fanOutPublish(FanOutSource::BrokerPubInfoPtr info);
+    void fanOutSubackReceived(const std::string& filter);
+    void fanOutClientConnected(SessionWrapper& session, const std::string& clientId);
+    void fanOutDetach(const SessionWrapper& session);
+    bool fanOutRetainedExpected(const SessionWrapper* session) const;
+    void fanOutDropRetainedReqs(const SessionWrapper* session, const std::string* filter);
+    bool openPubStores(const std::string& dir);
+    bool adoptStrayPubStores(const std::string& dir, std::size_t size);
+    void addPubStore(std::unique_ptr<PubStore> store, const std::string& name, std::size_t brokerIdx);
+    static std::string pubStoreName(unsigned workerIdx, const BrokerRing::BrokerInfo& broker);
+    bool storePub(
+        std::size_t brokerIdx,
+        const std::string& topic,
+        const std::uint8_t* buf,
+        std::size_t bufLen,
+        std::uint8_t qos,
+        bool retain);
+    void syncPubStores();
     void broadcastAdvertise(const std::uint8_t* buf, std::size_t bufSize);
+    void programTimerWheel(unsigned ms);
+    void brokerFlushRequested(SessionWrapper& session);
+    void flushBrokerData();
+    void brokerPubQueueUpdated(SessionWrapper& session, std::size_t prevBytes, std::size_t bytes);
+    void updateBrokerPubQueueHold();
+
+    // Includes the sessions that don't belong to a particular client
+    template <typename TFunc>
+    void forEachSession(TFunc&& func)
+    {
+        m_sessions.forEach(func);
+        for (auto* s : m_pubOnlySessions) {
+            if (s != nullptr) {
+                func(*s);
+            }
+        }
+
+        if (m_fanOut && (m_fanOut->session() != nullptr)) {
+            func(*m_fanOut->session());
+        }
+
+        for (auto& drainer : m_pubStoreDrainers) {
+            if (drainer->session() != nullptr) {
+                func(*drainer->session());
+            }
+        }
+    }
 
     const Config& m_config;
+    unsigned m_workerIdx = 0U;
+    unsigned m_workersCount = 1U;
     PortType m_port = 0;
     PortType m_broadcastPort = 0;
-    QUdpSocket m_socket;
+    ClientSocketPtr m_socket;
+    TimerWheel m_timerWheel;
+    QTimer m_timerWheelTimer;
+    ConnectScheduler m_connectScheduler;
+    unsigned m_brokerFlushDelayUs = 0U;
+    std::vector<SessionWrapper*> m_brokerFlushPending;
+    std::chrono::steady_clock::time_point m_brokerFlushFirstReq;
+    QTimer m_brokerFlushTimer;
+    QTimer m_statsTimer;
+    BrokerRing m_brokerRing;
+    std::vector<std::unique_ptr<BrokerConnPool> > m_brokerPools;
+    std::size_t m_brokerInputHighWaterMark = 0U;
+    unsigned long long m_lastReportedConnects = 0U;
+    std::chrono::steady_clock::time_point m_lastStatsReport;
+    unsigned long long m_searchgwAnswered = 0U;
+    unsigned long long m_unknownClientDropped = 0U;
+    unsigned long long m_pubOnlyForwarded = 0U;
+    std::vector<SessionWrapper*> m_pubOnlySessions;
+    std::unique_ptr<FanOutSource> m_fanOut;
+    TopicTrie<SessionWrapper> m_fanOutSubs;
+    std::vector<std::pair<SessionWrapper*, std::uint8_t> > m_fanOutMatches;
+
+    // The broker publishes the retained messages after the SUBACK, they are
+    // delivered only to the sessions which requested the subscription.
+    struct FanOutRetainedReq
+    {
+        const SessionWrapper* m_session = nullptr;
+        std::string m_filter;
+        bool m_acked = false;
+    };
+    std::vector<FanOutRetainedReq> m_fanOutRetainedReqs;
+
+    // Subscriptions of the disconnected clients without clean session,
+    // restored when the client connects again.
+    typedef std::vector<std::pair<std::string, std::uint8_t> > FanOutFiltersList;
+    std::map<std::string, FanOutFiltersList> m_fanOutDetached;
+    std::map<std::string, unsigned> m_fanOutDetachedRefs;
+    unsigned long long m_fanOutReceived = 0U;
+    unsigned long long m_fanOutDelivered = 0U;
+    std::vector<std::unique_ptr<PubStore> > m_pubStores;
+    std::vector<std::unique_ptr<PubStoreDrainer> > m_pubStoreDrainers;
+    unsigned long long m_pubStored = 0U;
+    unsigned long long m_pubStoreRejected = 0U;
+    std::size_t m_brokerPubQueueTotalLimit = 0U;
+    std::size_t m_brokerPubQueueTotal = 0U;
+    std::size_t m_brokerPubQueueTotalHighWaterMark = 0U;
+    bool m_brokerPubQueueHeld = false;
+    std::vector<SessionWrapper*> m_brokerPubQueueHoldPending;
+    unsigned long long m_brokerPubQueueHolds = 0U;
     GatewayWrapper m_gw;
     std::vector<std::uint8_t> m_lastAdvertise;
     SessionMap m_sessions;
@@ -0,0 +1,469 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PubStore.h"
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <array>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif // #ifdef __linux__
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::uint32_t Magic = 0x4c57534d; // "MSWL"
+const std::uint32_t Version = 1U;
+const std::size_t Alignment = 8U;
+const std::uint8_t RecordType_Data = 1U;
+const std::uint8_t RecordType_Pad = 2U;
+
+struct FileHeader
+{
+    std::uint32_t m_magic = 0U;
+    std::uint32_t m_version = 0U;
+    std::uint64_t m_dataSize = 0U;
+    std::uint64_t m_head = 0U;
+};
+
+std::size_t alignUp(std::size_t val)
+{
+    return (val + (Alignment - 1)) & ~(Alignment - 1);
+}
+
+std::uint32_t crc32(std::uint32_t crc, const std::uint8_t* buf, std::size_t bufLen)
+{
+    static const std::array<std::uint32_t, 256> Table =
+        []() -> std::array<std::uint32_t, 256>
+        {
+            std::array<std::uint32_t, 256> table;
+            for (auto idx = 0U; idx < table.size(); ++idx) {
+                std::uint32_t val = idx;
+                for (auto bit = 0U; bit < 8U; ++bit) {
+                    val = (val >> 1) ^ ((val & 1U) != 0U ? 0xedb88320U : 0U);
+                }
+                table[idx] = val;
+            }
+            return table;
+        }();
+
+    crc = ~crc;
+    for (auto idx = 0U; idx < bufLen; ++idx) {
+        crc = Table[(crc ^ buf[idx]) & 0xffU] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+}  // namespace
+
+struct PubStore::RecordHeader
+{
+    std::uint64_t m_pos = 0U;
+    std::uint32_t m_crc = 0U;
+    std::uint32_t m_bodyLen = 0U;
+    std::uint32_t m_topicLen = 0U;
+    std::uint8_t m_type = 0U;
+    std::uint8_t m_qos = 0U;
+    std::uint8_t m_retain = 0U;
+    std::uint8_t m_reserved = 0U;
+
+    std::uint32_t calcCrc(const std::uint8_t* body) const
+    {
+        RecordHeader copy = *this;
+        copy.m_crc = 0U;
+        auto crc = crc32(0U, reinterpret_cast<const std::uint8_t*>(&copy), sizeof(copy));
+        return crc32(crc, body, m_bodyLen);
+    }
+};
+
+PubStore::PubStore() = default;
+
+PubStore::~PubStore()
+{
+    close();
+}
+
+bool PubStore::open(const std::string& path, std::size_t size)
+{
+#ifdef __linux__
+    assert(m_fd < 0);
+    size = alignUp(size);
+    if (size < (sizeof(RecordHeader) * 2)) {
+        std::cerr << "ERROR: Publish store size is too small: " << size << std::endl;
+        return false;
+    }
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0) {
+        std::cerr << "ERROR: Failed to open publish store " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    m_path = path;
+    struct stat fileStat;
+    if (::fstat(m_fd, &fileStat) != 0) {
+        std::cerr << "ERROR: Failed to access publish store " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    FileHeader fileHdr;
+    bool existing = false;
+    bool truncated = false;
+    if ((sizeof(fileHdr) <= static_cast<std::size_t>(fileStat.st_size)) &&
+        (::pread(m_fd, &fileHdr, sizeof(fileHdr), 0) == static_cast<ssize_t>(sizeof(fileHdr))) &&
+        (fileHdr.m_magic == Magic) &&
+        (fileHdr.m_version == Version) &&
+        (static_cast<std::uint64_t>(fileStat.st_size) <= (HeaderSize + fileHdr.m_dataSize))) {
+        existing = true;
+        truncated = (static_cast<std::uint64_t>(fileStat.st_size) < (HeaderSize + fileHdr.m_dataSize));
+        if (truncated) {
+            // The records before the cut are still delivered, the replay
+            // stops at the first one which doesn't survive.
+            std::cerr << "WARNING: Publish store " << path << " is truncated, recovering the complete records" << std::endl;
+        }
+
+        if (fileHdr.m_dataSize != size) {
+            // Don't lose the undelivered messages
+            std::cerr << "WARNING: Publish store " << path << " has different size (" <<
+                fileHdr.m_dataSize << "), using it as is" << std::endl;
+            size = static_cast<std::size_t>(fileHdr.m_dataSize);
+        }
+    }
+
+    m_dataSize = size;
+    m_mapSize = HeaderSize + size;
+    if ((!existing) || truncated) {
+        // Reserve the disk space up front, running out of it when
+        // writing to the mapped memory is fatal.
+        if (((!existing) && (::ftruncate(m_fd, 0) != 0)) ||
+            (::posix_fallocate(m_fd, 0, static_cast<off_t>(m_mapSize)) != 0)) {
+            std::cerr << "ERROR: Failed to allocate " << m_mapSize << " bytes for publish store " << path << std::endl;
+            close();
+            return false;
+        }
+    }
+
+    auto* map = ::mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "ERROR: Failed to map publish store " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    m_map = static_cast<std::uint8_t*>(map);
+    if (!existing) {
+        fileHdr = FileHeader();
+        fileHdr.m_magic = Magic;
+        fileHdr.m_version = Version;
+        fileHdr.m_dataSize = m_dataSize;
+        std::memcpy(m_map, &fileHdr, sizeof(fileHdr));
+        m_head = 0U;
+        m_tail = 0U;
+        markDirty(0U, sizeof(fileHdr));
+        sync();
+        return true;
+    }
+
+    // Replay: find the end of the valid records written after the head
+    m_head = fileHdr.m_head;
+    m_tail = m_head;
+    while (true) {
+        auto offset = static_cast<std::size_t>(m_tail % m_dataSize);
+        auto toEnd = m_dataSize - offset;
+        if (toEnd < sizeof(RecordHeader)) {
+            if ((m_dataSize - usedSize()) < toEnd) {
+                break;
+            }
+
+            m_tail += toEnd;
+            continue;
+        }
+
+        RecordHeader hdr;
+        if (!validRecord(m_tail, hdr)) {
+            break;
+        }
+
+        if (hdr.m_type == RecordType_Pad) {
+            m_tail += toEnd;
+            continue;
+        }
+
+        m_tail += alignUp(sizeof(RecordHeader) + hdr.m_bodyLen);
+    }
+
+    if (!empty()) {
+        std::cerr << "WARNING: Publish store " << path << " contains " << usedSize() <<
+            " bytes of undelivered messages, delivering them to the broker" << std::endl;
+    }
+    return true;
+#else // #ifdef __linux__
+    static_cast<void>(size);
+    std::cerr << "ERROR: Publish store " << path << " is not supported on this platform" << std::endl;
+    return false;
+#endif // #ifdef __linux__
+}
+
+void PubStore::close()
+{
+#ifdef __linux__
+    if (m_map != nullptr) {
+        sync();
+        ::munmap(m_map, m_mapSize);
+        m_map = nullptr;
+    }
+
+    if (0 <= m_fd) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+#endif // #ifdef __linux__
+}
+
+void PubStore::remove()
+{
+    close();
+#ifdef __linux__
+    if ((!m_path.empty()) && (::unlink(m_path.c_str()) != 0)) {
+        std::cerr << "ERROR: Failed to delete publish store " << m_path << ": " << std::strerror(errno) << std::endl;
+    }
+#endif // #ifdef __linux__
+}
+
+bool PubStore::listFiles(
+    const std::string& dir,
+    const std::string& prefix,
+    std::vector<std::string>& names)
+{
+#ifdef __linux__
+    auto* dirPtr = ::opendir(dir.c_str());
+    if (dirPtr == nullptr) {
+        std::cerr << "ERROR: Failed to open publish store directory " << dir << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    while (auto* entry = ::readdir(dirPtr)) {
+        if (std::strncmp(entry->d_name, prefix.c_str(), prefix.size()) == 0) {
+            names.push_back(entry->d_name);
+        }
+    }
+
+    ::closedir(dirPtr);
+    return true;
+#else // #ifdef __linux__
+    static_cast<void>(prefix);
+    static_cast<void>(names);
+    std::cerr << "ERROR: Publish store directory " << dir << " is not supported on this platform" << std::endl;
+    return false;
+#endif // #ifdef __linux__
+}
+
+bool PubStore::append(
+    const std::string& topic,
+    const std::uint8_t* buf,
+    std::size_t bufLen,
+    std::uint8_t qos,
+    bool retain)
+{
+    if (m_map == nullptr) {
+        return false;
+    }
+
+    auto bodyLen = topic.size() + bufLen;
+    auto recLen = alignUp(sizeof(RecordHeader) + bodyLen);
+    auto offset = static_cast<std::size_t>(m_tail % m_dataSize);
+    auto toEnd = m_dataSize - offset;
+
+    // Records are not split at the end of the ring
+    std::size_t skip = 0U;
+    if (toEnd < recLen) {
+        skip = toEnd;
+    }
+
+    if ((m_dataSize - usedSize()) < (skip + recLen)) {
+        return false;
+    }
+
+    if (sizeof(RecordHeader) <= skip) {
+        RecordHeader padHdr;
+        padHdr.m_pos = m_tail;
+        padHdr.m_type = RecordType_Pad;
+        padHdr.m_crc = padHdr.calcCrc(nullptr);
+        std::memcpy(dataPtr(offset), &padHdr, sizeof(padHdr));
+        markDirty(HeaderSize + offset, HeaderSize + offset + sizeof(padHdr));
+    }
+
+    auto pos = m_tail + skip;
+    offset = static_cast<std::size_t>(pos % m_dataSize);
+    auto* body = dataPtr(offset + sizeof(RecordHeader));
+    std::copy_n(topic.begin(), topic.size(), body);
+    if (bufLen != 0U) {
+        std::memcpy(body + topic.size(), buf, bufLen);
+    }
+
+    RecordHeader hdr;
+    hdr.m_pos = pos;
+    hdr.m_bodyLen = static_cast<std::uint32_t>(bodyLen);
+    hdr.m_topicLen = static_cast<std::uint32_t>(topic.size());
+    hdr.m_type = RecordType_Data;
+    hdr.m_qos = qos;
+    hdr.m_retain = retain ? 1U : 0U;
+    hdr.m_crc = hdr.calcCrc(body);
+    std::memcpy(dataPtr(offset), &hdr, sizeof(hdr));
+    markDirty(HeaderSize + offset, HeaderSize + offset + recLen);
+
+    m_tail = pos + recLen;
+    return true;
+}
+
+bool PubStore::read(Position& pos, Record& record) const
+{
+    assert(m_head <= pos);
+    while (pos < m_tail) {
+        auto offset = static_cast<std::size_t>(pos % m_dataSize);
+        auto toEnd = m_dataSize - offset;
+        if (toEnd < sizeof(RecordHeader)) {
+            pos += toEnd;
+            continue;
+        }
+
+        RecordHeader hdr;
+        std::memcpy(&hdr, dataPtr(offset), sizeof(hdr));
+        if (hdr.m_type == RecordType_Pad) {
+            pos += toEnd;
+            continue;
+        }
+
+        assert(hdr.m_pos == pos);
+        auto* body = dataPtr(offset + sizeof(RecordHeader));
+        record.m_topic = reinterpret_cast<const char*>(body);
+        record.m_topicLen = hdr.m_topicLen;
+        record.m_data = body + hdr.m_topicLen;
+        record.m_dataLen = hdr.m_bodyLen - hdr.m_topicLen;
+        record.m_qos = hdr.m_qos;
+        record.m_retain = (hdr.m_retain != 0U);
+        pos += alignUp(sizeof(RecordHeader) + hdr.m_bodyLen);
+        return true;
+    }
+
+    return false;
+}
+
+void PubStore::release(Position pos)
+{
+    assert(m_head <= pos);
+    assert(pos <= m_tail);
+    if (pos == m_head) {
+        return;
+    }
+
+    m_head = pos;
+    writeHead();
+}
+
+void PubStore::sync()
+{
+    if (m_dirtyBegin == m_dirtyEnd) {
+        return;
+    }
+
+#ifdef __linux__
+    // msync() requires page aligned address
+    static const std::size_t PageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    auto begin = (m_dirtyBegin / PageSize) * PageSize;
+    if (::msync(m_map + begin, m_dirtyEnd - begin, MS_SYNC) != 0) {
+        std::cerr << "ERROR: Failed to sync publish store " << m_path << ": " << std::strerror(errno) << std::endl;
+    }
+#endif // #ifdef __linux__
+
+    m_dirtyBegin = 0U;
+    m_dirtyEnd = 0U;
+}
+
+bool PubStore::validRecord(Position pos, RecordHeader& hdr) const
+{
+    auto offset = static_cast<std::size_t>(pos % m_dataSize);
+    std::memcpy(&hdr, dataPtr(offset), sizeof(hdr));
+    if ((hdr.m_pos != pos) ||
+        ((hdr.m_type != RecordType_Data) && (hdr.m_type != RecordType_Pad)) ||
+        (hdr.m_bodyLen < hdr.m_topicLen)) {
+        return false;
+    }
+
+    auto recLen = alignUp(sizeof(RecordHeader) + hdr.m_bodyLen);
+    if (hdr.m_type == RecordType_Pad) {
+        recLen = m_dataSize - offset;
+    }
+
+    if (((m_dataSize - offset) < recLen) ||
+        (m_dataSize < ((pos - m_head) + recLen))) {
+        return false;
+    }
+
+    return hdr.m_crc == hdr.calcCrc(dataPtr(offset + sizeof(RecordHeader)));
+}
+
+void PubStore::writeHead()
+{
+    FileHeader fileHdr;
+    std::memcpy(&fileHdr, m_map, sizeof(fileHdr));
+    fileHdr.m_head = m_head;
+    std::memcpy(m_map, &fileHdr, sizeof(fileHdr));
+    markDirty(0U, sizeof(fileHdr));
+}
+
+void PubStore::markDirty(std::size_t begin, std::size_t end)
+{
+    if (m_dirtyBegin == m_dirtyEnd) {
+        m_dirtyBegin = begin;
+        m_dirtyEnd = end;
+        return;
+    }
+
+    m_dirtyBegin = std::min(m_dirtyBegin, begin);
+    m_dirtyEnd = std::max(m_dirtyEnd, end);
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,156 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Write-ahead log of the messages published by the clients, which are
+// acknowledged to the clients before being delivered to the broker.
+// The log is a preallocated file of fixed size mapped into memory and used
+// as a ring buffer, so the disk usage is bounded. Every record carries its
+// position in the log and a checksum, which allows to find the undelivered
+// records again after restart by scanning from the persisted head.
+class PubStore
+{
+public:
+    typedef std::uint64_t Position;
+
+    struct Record
+    {
+        const char* m_topic = nullptr;
+        std::size_t m_topicLen = 0U;
+        const std::uint8_t* m_data = nullptr;
+        std::size_t m_dataLen = 0U;
+        std::uint8_t m_qos = 0U;
+        bool m_retain = false;
+    };
+
+    PubStore();
+    ~PubStore();
+
+    PubStore(const PubStore&) = delete;
+    PubStore& operator=(const PubStore&) = delete;
+
+    bool open(const std::string& path, std::size_t size);
+    void close();
+
+    // Closes and deletes the file of the store.
+    void remove();
+
+    // Names of the files in the directory starting with the prefix.
+    static bool listFiles(
+        const std::string& dir,
+        const std::string& prefix,
+        std::vector<std::string>& names);
+
+    bool append(
+        const std::string& topic,
+        const std::uint8_t* buf,
+        std::size_t bufLen,
+        std::uint8_t qos,
+        bool retain);
+
+    // Reads the record at the provided position and advances it to
+    // the next record, returns false when the tail is reached.
+    bool read(Position& pos, Record& record) const;
+
+    // All the records before the provided position are delivered.
+    void release(Position pos);
+
+    // Writes the modified data to the disk, expected to be invoked once
+    // per batch of appended records.
+    void sync();
+
+    Position head() const
+    {
+        return m_head;
+    }
+
+    Position tail() const
+    {
+        return m_tail;
+    }
+
+    bool empty() const
+    {
+        return m_head == m_tail;
+    }
+
+    std::size_t usedSize() const
+    {
+        return static_cast<std::size_t>(m_tail - m_head);
+    }
+
+    std::size_t capacity() const
+    {
+        return m_dataSize;
+    }
+
+    const std::string& path() const
+    {
+        return m_path;
+    }
+
+private:
+    struct RecordHeader;
+
+    std::uint8_t* dataPtr(std::size_t offset) const
+    {
+        return m_map + HeaderSize + offset;
+    }
+
+    bool validRecord(Position pos, RecordHeader& hdr) const;
+    void writeHead();
+    void markDirty(std::size_t begin, std::size_t end);
+
+    static const std::size_t HeaderSize = 4096U;
+
+    std::string m_path;
+    int m_fd = -1;
+    std::uint8_t* m_map = nullptr;
+    std::size_t m_mapSize = 0U;
+    std::size_t m_dataSize = 0U;
+    Position m_head = 0U;
+    Position m_tail = 0U;
+    std::size_t m_dirtyBegin = 0U;
+    std::size_t m_dirtyEnd = 0U;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
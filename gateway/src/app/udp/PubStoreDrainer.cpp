@@ -0,0 +1,483 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PubStoreDrainer.h"
+
+#include <cassert>
+#include <iostream>
+#include <algorithm>
+
+#include "mqttsn/protocol/MsgTypeId.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::uint16_t KeepAlivePeriod = 60U;
+const unsigned PingPeriodMs = (KeepAlivePeriod * 1000U) / 2U;
+const unsigned RestartDelayMs = 1000U;
+const unsigned RetryDelayMs = 1000U;
+const std::size_t MaxInFlight = 32U;
+const std::uint8_t ProtocolId = 0x01;
+const std::uint8_t ConnectFlags = 0U; // Not clean session, no will
+const std::uint8_t DupFlag = 0x80;
+const std::uint8_t RetainFlag = 0x10;
+const unsigned QosShift = 5U;
+const std::uint16_t RegisterMsgId = 1U;
+const std::uint8_t ReturnCodeAccepted = 0U;
+const PubStore::Position RecordAlignment = 8U;
+
+// The same record gets the same packet ID after restart of the gateway,
+// which allows the broker to discard the QoS2 duplicates.
+std::uint16_t packetIdFor(PubStore::Position pos)
+{
+    return static_cast<std::uint16_t>(((pos / RecordAlignment) % 0xffff) + 1U);
+}
+
+}  // namespace
+
+PubStoreDrainer::PubStoreDrainer(
+    PubStore& store,
+    TimerWheel& timerWheel,
+    const std::string& clientId)
+  : m_store(store),
+    m_timerWheel(timerWheel),
+    m_clientId(clientId)
+{
+    m_timer.setExpiryCb(
+        [this]()
+        {
+            timeout();
+        });
+}
+
+PubStoreDrainer::~PubStoreDrainer()
+{
+    m_timerWheel.cancel(m_timer);
+}
+
+void PubStoreDrainer::start()
+{
+    m_sendPos = m_store.head();
+    if (!m_store.empty()) {
+        createSession();
+    }
+}
+
+void PubStoreDrainer::dataStored()
+{
+    if (m_session == nullptr) {
+        if (!m_timer.isActive()) {
+            createSession();
+        }
+        return;
+    }
+
+    sendPending();
+}
+
+void PubStoreDrainer::sessionTerminated()
+{
+    m_session = nullptr;
+    m_connected = false;
+    m_sendScheduled = false;
+    m_timerWheel.cancel(m_timer);
+
+    // Everything not acknowledged is sent again with the same packet ID
+    for (auto& info : m_inFlight) {
+        info.m_sendRequired = !info.m_acked;
+    }
+
+    if (m_store.empty()) {
+        return;
+    }
+
+    std::cerr << "WARNING: Publish store session terminated, restarting..." << std::endl;
+    m_timerWheel.start(m_timer, RestartDelayMs);
+}
+
+void PubStoreDrainer::createSession()
+{
+    assert(m_session == nullptr);
+    assert(m_sessionCreateCb);
+    m_session = m_sessionCreateCb();
+    if (m_session == nullptr) {
+        return;
+    }
+
+    m_connected = false;
+    m_topicIds.clear();
+
+    // The messages of this session need to reach the broker
+    m_session->setClientPubStoreReqCb(nullptr);
+    m_session->setSubscribeFanOutReqCb(nullptr);
+    m_session->setUnsubscribeFanOutReqCb(nullptr);
+
+    m_session->setSendDataReqCb(
+        [this](const std::uint8_t* buf, std::size_t bufSize)
+        {
+            dataToClient(buf, bufSize);
+        });
+
+    if (!m_session->start(SessionWrapper::ConnectPriority::Normal)) {
+        assert(!"Unexpected error");
+        return;
+    }
+
+    sendConnect();
+    if (m_session != nullptr) {
+        m_timerWheel.start(m_timer, PingPeriodMs);
+    }
+}
+
+void PubStoreDrainer::timeout()
+{
+    if (m_session == nullptr) {
+        createSession();
+        return;
+    }
+
+    if (m_sendScheduled) {
+        m_sendScheduled = false;
+        resendInFlight();
+        sendPending();
+        if (m_session == nullptr) {
+            return;
+        }
+    }
+    else if (m_connected) {
+        sendPingreq();
+        if (m_session == nullptr) {
+            return;
+        }
+    }
+
+    if (!m_sendScheduled) {
+        m_timerWheel.start(m_timer, PingPeriodMs);
+    }
+}
+
+void PubStoreDrainer::dataToClient(const std::uint8_t* buf, std::size_t bufSize)
+{
+    SnMsgBuf::Frame frame;
+    if (!SnMsgBuf::parse(buf, bufSize, frame)) {
+        return;
+    }
+
+    auto* body = frame.m_body;
+    auto bodyLen = frame.m_bodyLen;
+    switch (frame.m_type) {
+    case mqttsn::protocol::MsgTypeId_CONNACK:
+        if (bodyLen < 1U) {
+            break;
+        }
+
+        if (body[0] != ReturnCodeAccepted) {
+            std::cerr << "ERROR: Publish store session connection rejected (" <<
+                static_cast<unsigned>(body[0]) << ")" << std::endl;
+            break;
+        }
+
+        // Publish outside of the session's processing context
+        m_connected = true;
+        scheduleSend(0U);
+        break;
+
+    case mqttsn::protocol::MsgTypeId_REGACK:
+        // Reported synchronously when the REGISTER is sent
+        if ((bodyLen < 5U) || (body[4] != ReturnCodeAccepted)) {
+            break;
+        }
+
+        m_regTopicId = SnMsgBuf::readU16(body);
+        break;
+
+    case mqttsn::protocol::MsgTypeId_PUBACK:
+        if (bodyLen < 5U) {
+            break;
+        }
+
+        if (body[4] == ReturnCodeAccepted) {
+            acked(SnMsgBuf::readU16(body + 2));
+            break;
+        }
+
+        rejected(SnMsgBuf::readU16(body + 2));
+        break;
+
+    case mqttsn::protocol::MsgTypeId_PUBREC:
+        if (bodyLen < 2U) {
+            break;
+        }
+
+        received(SnMsgBuf::readU16(body));
+        break;
+
+    case mqttsn::protocol::MsgTypeId_PUBCOMP:
+        if (bodyLen < 2U) {
+            break;
+        }
+
+        acked(SnMsgBuf::readU16(body));
+        break;
+
+    default:
+        break;
+    }
+}
+
+void PubStoreDrainer::sendPending()
+{
+    while (m_connected && (m_inFlight.size() < MaxInFlight)) {
+        auto pos = m_sendPos;
+        PubStore::Record record;
+        if (!m_store.read(pos, record)) {
+            break;
+        }
+
+        auto packetId = packetIdFor(m_sendPos);
+        if (findInFlight(packetId) != m_inFlight.end()) {
+            // Wait for the acknowledgement of the older message
+            break;
+        }
+
+        InFlightInfo info;
+        info.m_begin = m_sendPos;
+        info.m_end = pos;
+        info.m_packetId = packetId;
+        m_inFlight.push_back(info);
+        m_sendPos = pos;
+        sendPublish(m_inFlight.back(), record, false);
+    }
+
+    releaseAcked();
+}
+
+void PubStoreDrainer::resendInFlight()
+{
+    for (auto& info : m_inFlight) {
+        if (!m_connected) {
+            break;
+        }
+
+        if (info.m_acked || (!info.m_sendRequired)) {
+            continue;
+        }
+
+        info.m_sendRequired = false;
+        if (info.m_received) {
+            sendPubrel(info.m_packetId);
+            continue;
+        }
+
+        auto pos = info.m_begin;
+        PubStore::Record record;
+        if (!m_store.read(pos, record)) {
+            assert(!"The record must be in the store");
+            continue;
+        }
+
+        sendPublish(info, record, true);
+    }
+
+    releaseAcked();
+}
+
+void PubStoreDrainer::sendConnect()
+{
+    m_msg.begin(mqttsn::protocol::MsgTypeId_CONNECT);
+    m_msg.writeU8(ConnectFlags);
+    m_msg.writeU8(ProtocolId);
+    m_msg.writeU16(KeepAlivePeriod);
+    m_msg.writeData(m_clientId);
+    sendMsg();
+}
+
+void PubStoreDrainer::sendPublish(InFlightInfo& info, const PubStore::Record& record, bool dup)
+{
+    auto topicId = sendRegister(record);
+    if (topicId == 0U) {
+        if (m_session != nullptr) {
+            std::cerr << "ERROR: Failed to register topic of the stored message, dropping it" << std::endl;
+            info.m_acked = true;
+        }
+        return;
+    }
+
+    auto flags = static_cast<std::uint8_t>(record.m_qos << QosShift);
+    if (dup) {
+        flags |= DupFlag;
+    }
+
+    if (record.m_retain) {
+        flags |= RetainFlag;
+    }
+
+    m_msg.begin(mqttsn::protocol::MsgTypeId_PUBLISH);
+    m_msg.writeU8(flags);
+    m_msg.writeU16(topicId);
+    m_msg.writeU16(info.m_packetId);
+    m_msg.writeData(record.m_data, record.m_dataLen);
+    sendMsg();
+}
+
+std::uint16_t PubStoreDrainer::sendRegister(const PubStore::Record& record)
+{
+    m_regTopic.assign(record.m_topic, record.m_topicLen);
+    auto iter = m_topicIds.find(m_regTopic);
+    if (iter != m_topicIds.end()) {
+        return iter->second;
+    }
+
+    m_regTopicId = 0U;
+    m_msg.begin(mqttsn::protocol::MsgTypeId_REGISTER);
+    m_msg.writeU16(0U);
+    m_msg.writeU16(RegisterMsgId);
+    m_msg.writeData(m_regTopic);
+    sendMsg();
+    if (m_regTopicId == 0U) {
+        return 0U;
+    }
+
+    // The session reuses the ID of the oldest registration when its range
+    // of IDs is exhausted, such topic needs to be registered again.
+    for (auto idIter = m_topicIds.begin(); idIter != m_topicIds.end(); ++idIter) {
+        if (idIter->second == m_regTopicId) {
+            m_topicIds.erase(idIter);
+            break;
+        }
+    }
+
+    m_topicIds.insert(std::make_pair(m_regTopic, m_regTopicId));
+    return m_regTopicId;
+}
+
+void PubStoreDrainer::sendPubrel(std::uint16_t packetId)
+{
+    m_msg.begin(mqttsn::protocol::MsgTypeId_PUBREL);
+    m_msg.writeU16(packetId);
+    sendMsg();
+}
+
+void PubStoreDrainer::sendPingreq()
+{
+    m_msg.begin(mqttsn::protocol::MsgTypeId_PINGREQ);
+    sendMsg();
+}
+
+void PubStoreDrainer::sendMsg()
+{
+    assert(m_session != nullptr);
+    std::size_t len = 0U;
+    auto* buf = m_msg.finish(len);
+    m_session->dataFromClient(buf, len);
+}
+
+void PubStoreDrainer::received(std::uint16_t packetId)
+{
+    auto iter = findInFlight(packetId);
+    if (iter == m_inFlight.end()) {
+        return;
+    }
+
+    // PUBREL is sent outside of the session's processing context
+    iter->m_received = true;
+    iter->m_sendRequired = true;
+    scheduleSend(0U);
+}
+
+void PubStoreDrainer::acked(std::uint16_t packetId)
+{
+    auto iter = findInFlight(packetId);
+    if (iter == m_inFlight.end()) {
+        return;
+    }
+
+    iter->m_acked = true;
+    iter->m_sendRequired = false;
+    if (m_inFlight.front().m_acked) {
+        scheduleSend(0U);
+    }
+}
+
+void PubStoreDrainer::rejected(std::uint16_t packetId)
+{
+    auto iter = findInFlight(packetId);
+    if (iter == m_inFlight.end()) {
+        return;
+    }
+
+    // The session is congested, try again later
+    iter->m_sendRequired = true;
+    scheduleSend(RetryDelayMs);
+}
+
+void PubStoreDrainer::releaseAcked()
+{
+    // The head advances over the acknowledged prefix only
+    bool released = false;
+    PubStore::Position head = m_store.head();
+    while ((!m_inFlight.empty()) && m_inFlight.front().m_acked) {
+        head = m_inFlight.front().m_end;
+        m_inFlight.pop_front();
+        released = true;
+    }
+
+    if (released) {
+        m_store.release(head);
+    }
+}
+
+void PubStoreDrainer::scheduleSend(unsigned delayMs)
+{
+    if (m_session == nullptr) {
+        return;
+    }
+
+    m_sendScheduled = true;
+    m_timerWheel.start(m_timer, delayMs);
+}
+
+PubStoreDrainer::InFlightList::iterator PubStoreDrainer::findInFlight(std::uint16_t packetId)
+{
+    return
+        std::find_if(
+            m_inFlight.begin(), m_inFlight.end(),
+            [packetId](InFlightList::const_reference elem) -> bool
+            {
+                return elem.m_packetId == packetId;
+            });
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,144 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <map>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include "PubStore.h"
+#include "SessionWrapper.h"
+#include "SnMsgBuf.h"
+#include "TimerWheel.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Internal client of the gateway delivering the messages from the publish
+// store to the broker through its own session. The messages are published
+// in the order they were stored, and the head of the store advances only
+// when the broker acknowledges them. The session is not clean and the
+// packet IDs are derived from the positions in the store, so the broker
+// recognises the messages published again after reconnection or restart.
+class PubStoreDrainer
+{
+public:
+    typedef std::function<SessionWrapper* ()> SessionCreateCb;
+
+    PubStoreDrainer(PubStore& store, TimerWheel& timerWheel, const std::string& clientId);
+    ~PubStoreDrainer();
+
+    template <typename TFunc>
+    void setSessionCreateCb(TFunc&& cb)
+    {
+        m_sessionCreateCb = std::forward<TFunc>(cb);
+    }
+
+    void start();
+    void dataStored();
+
+    bool isSession(const SessionWrapper& session) const
+    {
+        return m_session == &session;
+    }
+
+    SessionWrapper* session() const
+    {
+        return m_session;
+    }
+
+    void sessionTerminated();
+
+    std::size_t inFlightCount() const
+    {
+        return m_inFlight.size();
+    }
+
+    bool isConnected() const
+    {
+        return m_connected;
+    }
+
+private:
+    struct InFlightInfo
+    {
+        PubStore::Position m_begin = 0U;
+        PubStore::Position m_end = 0U;
+        std::uint16_t m_packetId = 0U;
+        bool m_received = false;
+        bool m_acked = false;
+        bool m_sendRequired = false;
+    };
+
+    typedef std::deque<InFlightInfo> InFlightList;
+    typedef std::map<std::string, std::uint16_t> TopicIdsMap;
+
+    void createSession();
+    void timeout();
+    void dataToClient(const std::uint8_t* buf, std::size_t bufSize);
+    void sendPending();
+    void resendInFlight();
+    void sendConnect();
+    void sendPublish(InFlightInfo& info, const PubStore::Record& record, bool dup);
+    std::uint16_t sendRegister(const PubStore::Record& record);
+    void sendPubrel(std::uint16_t packetId);
+    void sendPingreq();
+    void sendMsg();
+    void received(std::uint16_t packetId);
+    void acked(std::uint16_t packetId);
+    void rejected(std::uint16_t packetId);
+    void releaseAcked();
+    void scheduleSend(unsigned delayMs);
+    InFlightList::iterator findInFlight(std::uint16_t packetId);
+
+    PubStore& m_store;
+    TimerWheel& m_timerWheel;
+    TimerWheel::Timer m_timer;
+    std::string m_clientId;
+    SessionCreateCb m_sessionCreateCb;
+    SessionWrapper* m_session = nullptr;
+    InFlightList m_inFlight;
+    PubStore::Position m_sendPos = 0U;
+    TopicIdsMap m_topicIds;
+    SnMsgBuf m_msg;
+    std::string m_regTopic;
+    std::uint16_t m_regTopicId = 0U;
+    bool m_connected = false;
+    bool m_sendScheduled = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
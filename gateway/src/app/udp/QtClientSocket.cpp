@@ -0,0 +1,223 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "QtClientSocket.h"
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif // #ifdef Q_OS_UNIX
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+ClientAddr toClientAddr(const QHostAddress& addr, quint16 port)
+{
+    if (addr.protocol() == QAbstractSocket::IPv4Protocol) {
+        return ClientAddr::fromIPv4(addr.toIPv4Address(), port);
+    }
+
+    auto ipv6 = addr.toIPv6Address();
+    return ClientAddr::fromIPv6(&ipv6[0], port);
+}
+
+QHostAddress toHostAddress(const ClientAddr& addr)
+{
+    if (addr.isIPv4()) {
+        return QHostAddress(static_cast<quint32>(addr.ipv4()));
+    }
+
+    Q_IPV6ADDR ipv6;
+    std::copy(addr.bytes().begin(), addr.bytes().end(), &ipv6[0]);
+    return QHostAddress(ipv6);
+}
+
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+
+int createReusePortSocket(ClientAddr::PortType port)
+{
+    auto fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "ERROR: Failed to create UDP socket: " << std::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    int enabled = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    ::setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &enabled, sizeof(enabled));
+    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enabled, sizeof(enabled)) != 0) {
+        std::cerr << "ERROR: Failed to share UDP port between workers: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return -1;
+    }
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "ERROR: Failed to bind UDP socket to local port " << port << std::endl;
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+#endif // #if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+
+}  // namespace
+
+QtClientSocket::QtClientSocket(QObject* parent)
+  : Base(parent)
+{
+    connect(
+        &m_socket, SIGNAL(readyRead()),
+        this, SLOT(readClientData()));
+    connect(
+        &m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
+        this, SLOT(socketErrorOccurred(QAbstractSocket::SocketError)));
+}
+
+QtClientSocket::~QtClientSocket()
+{
+    m_socket.blockSignals(true);
+    m_socket.flush();
+}
+
+bool QtClientSocket::bindImpl(PortType port)
+{
+    if (getReusePort()) {
+#if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+        auto fd = createReusePortSocket(port);
+        if (fd < 0) {
+            return false;
+        }
+
+        if (!m_socket.setSocketDescriptor(fd, QUdpSocket::BoundState, QUdpSocket::ReadWrite)) {
+            std::cerr << "ERROR: Failed to open UDP socket" << std::endl;
+            ::close(fd);
+            return false;
+        }
+
+        return true;
+#else // #if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+        std::cerr << "ERROR: Sharing UDP port between workers is not supported on this platform" << std::endl;
+        return false;
+#endif // #if defined(Q_OS_UNIX) && defined(SO_REUSEPORT)
+    }
+
+    if (!m_socket.bind(QHostAddress::AnyIPv4, port, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+        std::cerr << "ERROR: Failed to bind UDP socket to local port " << port << std::endl;
+        return false;
+    }
+
+    if (!m_socket.open(QUdpSocket::ReadWrite)) {
+        std::cerr << "ERROR: Failed to open UDP socket" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void QtClientSocket::sendToImpl(
+    const std::uint8_t* buf,
+    std::size_t bufSize,
+    const ClientAddr& addr)
+{
+    // The datagram is written immediately, i.e. every acknowledgement
+    // requires its own sync.
+    syncBeforeSend();
+
+    auto hostAddr = toHostAddress(addr);
+    std::size_t writtenCount = 0;
+    while (writtenCount < bufSize) {
+        auto remSize = bufSize - writtenCount;
+        auto count =
+            m_socket.writeDatagram(
+                reinterpret_cast<const char*>(&buf[writtenCount]),
+                remSize,
+                hostAddr,
+                addr.port());
+
+        if (count < 0) {
+            std::cerr << "ERROR: Failed to write to UDP socket!" << std::endl;
+            return;
+        }
+
+        writtenCount += count;
+    }
+}
+
+void QtClientSocket::flushImpl()
+{
+    m_socket.flush();
+}
+
+void QtClientSocket::readClientData()
+{
+    QHostAddress senderAddress;
+    quint16 senderPort;
+
+    while (m_socket.hasPendingDatagrams()) {
+        m_data.resize(m_socket.pendingDatagramSize());
+        auto readBytes = m_socket.readDatagram(
+            reinterpret_cast<char*>(&m_data[0]),
+            m_data.size(),
+            &senderAddress,
+            &senderPort);
+        assert(readBytes == static_cast<decltype(readBytes)>(m_data.size()));
+        static_cast<void>(readBytes);
+
+        reportData(&m_data[0], m_data.size(), toClientAddr(senderAddress, senderPort));
+        reportDataRelease();
+    }
+}
+
+void QtClientSocket::socketErrorOccurred(QAbstractSocket::SocketError err)
+{
+    static_cast<void>(err);
+    std::cerr << "ERROR: UDP Socket: " << m_socket.errorString().toStdString() << std::endl;
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
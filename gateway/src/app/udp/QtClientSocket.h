@@ -0,0 +1,76 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtNetwork/QUdpSocket>
+CC_ENABLE_WARNINGS()
+
+#include "ClientSocket.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class QtClientSocket : public ClientSocket
+{
+    Q_OBJECT
+    typedef ClientSocket Base;
+public:
+    explicit QtClientSocket(QObject* parent);
+    ~QtClientSocket();
+
+protected:
+    virtual bool bindImpl(PortType port) override;
+    virtual void sendToImpl(
+        const std::uint8_t* buf,
+        std::size_t bufSize,
+        const ClientAddr& addr) override;
+    virtual void flushImpl() override;
+
+private slots:
+    void readClientData();
+    void socketErrorOccurred(QAbstractSocket::SocketError err);
+
+private:
+    typedef std::vector<std::uint8_t> DataBuf;
+
+    QUdpSocket m_socket;
+    DataBuf m_data;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,182 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "RouteLink.h"
+
+#include <iostream>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::size_t InputBufSize = 4 * 1024;
+const std::size_t MinReadSpace = 1024;
+const unsigned ReconnectDelayMs = 1000U;
+
+}  // namespace
+
+RouteLink::RouteLink(const RouteInfo& info, TimerWheel& timerWheel, QObject* parent)
+  : Base(parent),
+    m_info(info),
+    m_timerWheel(timerWheel),
+    m_in(InputBufSize)
+{
+    m_reconnectTimer.setExpiryCb(
+        [this]()
+        {
+            start();
+        });
+
+    connect(
+        &m_socket, SIGNAL(connected()),
+        this, SLOT(socketConnected()));
+    connect(
+        &m_socket, SIGNAL(disconnected()),
+        this, SLOT(socketDisconnected()));
+    connect(
+        &m_socket, SIGNAL(readyRead()),
+        this, SLOT(readFromSocket()));
+    connect(
+        &m_socket, SIGNAL(error(QAbstractSocket::SocketError)),
+        this, SLOT(socketErrorOccurred(QAbstractSocket::SocketError)));
+}
+
+RouteLink::~RouteLink()
+{
+    close();
+}
+
+void RouteLink::start()
+{
+    if (m_closed) {
+        return;
+    }
+
+    m_socket.connectToBroker(m_info.address, m_info.port);
+}
+
+void RouteLink::write(const std::uint8_t* buf, std::size_t bufSize)
+{
+    if (!m_connected) {
+        return;
+    }
+
+    if (m_socket.write(reinterpret_cast<const char*>(buf), static_cast<qint64>(bufSize)) < 0) {
+        std::cerr << "Failed to write to TCP socket" << std::endl;
+    }
+}
+
+void RouteLink::close()
+{
+    if (m_closed) {
+        return;
+    }
+
+    m_closed = true;
+    m_timerWheel.cancel(m_reconnectTimer);
+    m_socket.blockSignals(true);
+    m_socket.flush();
+    m_socket.disconnectFromHost();
+}
+
+void RouteLink::socketConnected()
+{
+    m_connected = true;
+    if (m_connectionReportCb) {
+        m_connectionReportCb(true);
+    }
+}
+
+void RouteLink::socketDisconnected()
+{
+    connectionLost();
+}
+
+void RouteLink::readFromSocket()
+{
+    while (0 < m_socket.bytesAvailable()) {
+        auto* buf = m_in.writePtr(MinReadSpace);
+        auto count =
+            m_socket.read(
+                reinterpret_cast<char*>(buf),
+                static_cast<qint64>(m_in.freeSpace()));
+
+        if (count <= 0) {
+            break;
+        }
+
+        m_in.commit(static_cast<std::size_t>(count));
+        if (!m_dataReportCb) {
+            m_in.clear();
+            continue;
+        }
+
+        m_in.consume(m_dataReportCb(m_in.data(), m_in.size()));
+    }
+}
+
+void RouteLink::socketErrorOccurred(QAbstractSocket::SocketError err)
+{
+    static_cast<void>(err);
+    std::cerr << "ERROR: TCP Socket (route " << m_info.topicFilter << "): " <<
+        m_socket.errorString().toStdString() << std::endl;
+
+    if (!m_connected) {
+        // Connection attempt has failed
+        connectionLost();
+    }
+}
+
+void RouteLink::connectionLost()
+{
+    m_in.clear();
+    if (m_reconnectTimer.isActive()) {
+        return;
+    }
+
+    if (m_connected) {
+        m_connected = false;
+        if (m_connectionReportCb) {
+            m_connectionReportCb(false);
+        }
+    }
+
+    if (!m_closed) {
+        m_timerWheel.start(m_reconnectTimer, ReconnectDelayMs);
+    }
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
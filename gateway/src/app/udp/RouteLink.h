@@ -0,0 +1,105 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <string>
+#include <cstdint>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QObject>
+CC_ENABLE_WARNINGS()
+
+#include "mqttsn/gateway/Config.h"
+#include "TimerWheel.h"
+#include "StreamBuf.h"
+#include "BrokerSocket.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Connection of a single session to the broker serving one of the
+// topic routes. Reconnects on its own when the connection is lost.
+class RouteLink : public QObject
+{
+    Q_OBJECT
+    typedef QObject Base;
+public:
+    typedef mqttsn::gateway::Config::TopicRouteInfo RouteInfo;
+
+    RouteLink(const RouteInfo& info, TimerWheel& timerWheel, QObject* parent);
+    ~RouteLink();
+
+    typedef std::function<void (bool connected)> ConnectionReportCb;
+    template <typename TFunc>
+    void setConnectionReportCb(TFunc&& cb)
+    {
+        m_connectionReportCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::function<std::size_t (const std::uint8_t* buf, std::size_t bufSize)> DataReportCb;
+    template <typename TFunc>
+    void setDataReportCb(TFunc&& cb)
+    {
+        m_dataReportCb = std::forward<TFunc>(cb);
+    }
+
+    void start();
+    void write(const std::uint8_t* buf, std::size_t bufSize);
+    void close();
+
+private slots:
+    void socketConnected();
+    void socketDisconnected();
+    void readFromSocket();
+    void socketErrorOccurred(QAbstractSocket::SocketError err);
+
+private:
+    void connectionLost();
+
+    const RouteInfo& m_info;
+    TimerWheel& m_timerWheel;
+    TimerWheel::Timer m_reconnectTimer;
+    BrokerSocket m_socket;
+    StreamBuf m_in;
+    ConnectionReportCb m_connectionReportCb;
+    DataReportCb m_dataReportCb;
+    bool m_connected = false;
+    bool m_closed = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -21,6 +21,14 @@
 #include <cassert>
 #include <algorithm>
 #include <iomanip>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif // #ifdef __linux__
 
 namespace mqttsn
 {
@@ -38,14 +46,22 @@ namespace
 {
 
 const std::string WildcardStr("*");
+const std::size_t MaxPendingBrokerData = 64 * 1024;
+const std::size_t BrokerInputBufSize = 16 * 1024;
+const std::size_t MinBrokerReadSpace = 2 * 1024;
 
 }  // namespace
 
 SessionWrapper::SessionWrapper(
     const Config& config,
+    TimerWheel& timerWheel,
+    ConnectScheduler& connectScheduler,
     QObject* parent)
   : Base(parent),
-    m_config(config)
+    m_config(config),
+    m_timerWheel(timerWheel),
+    m_connectScheduler(connectScheduler),
+    m_brokerIn(BrokerInputBufSize)
 {
     m_session.setNextTickProgramReqCb(
         [this](unsigned ms)
@@ -65,6 +81,12 @@ SessionWrapper::SessionWrapper(
             sendDataToBroker(buf, bufSize);
         });
 
+    m_session.setSendPublishBrokerReqCb(
+        [this](const std::uint8_t* header, std::size_t headerSize, const std::uint8_t* payload, std::size_t payloadSize)
+        {
+            sendPublishToBroker(header, headerSize, payload, payloadSize);
+        });
+
     m_session.setTerminationReqCb(
         [this]()
         {
@@ -77,16 +99,37 @@ SessionWrapper::SessionWrapper(
             reconnectBroker();
         });
 
+    m_session.setBrokerDisconnectReqCb(
+        [this]()
+        {
+            releaseBroker();
+        });
+
+    m_session.setBrokerInputPauseReqCb(
+        [this](bool paused)
+        {
+            pauseBrokerInput(paused);
+        });
+
+    m_session.setBrokerPubQueueReportCb(
+        [this](std::size_t bytes)
+        {
+            brokerPubQueueUpdated(bytes);
+        });
+
     m_session.setClientConnectedReportCb(
         [this](const std::string& clientId)
         {
-            addPredefinedTopicsFor(clientId);
+            addPredefinedTopicsFor(configClientId(clientId));
+            if (m_clientConnectedReportCb) {
+                m_clientConnectedReportCb(*this, clientId);
+            }
         });
 
     m_session.setAuthInfoReqCb(
         [this](const std::string& clientId) -> AuthInfo
         {
-            return getAuthInfoFor(clientId);
+            return getAuthInfoFor(configClientId(clientId));
         });
 
     m_session.setGatewayId(m_config.gatewayId());
@@ -95,149 +138,319 @@ SessionWrapper::SessionWrapper(
     m_session.setDefaultClientId(m_config.defaultClientId());
     m_session.setPubOnlyKeepAlive(m_config.pubOnlyKeepAlive());
     m_session.setSleepingClientMsgLimit(m_config.sleepingClientMsgLimit());
+    m_session.setBrokerPubInFlightLimit(m_config.brokerPubInFlightLimit());
+    m_session.setBrokerPubQueueByteLimit(m_config.brokerPubQueueByteLimit(), m_config.brokerPubQueueLowWaterMark());
+    m_brokerInputPausable = (m_config.brokerPubQueueByteLimit() != 0U);
+    m_session.setBrokerPubOverflowPolicy(m_config.brokerPubOverflowPolicy());
+    m_session.setReleaseBrokerWhenAsleep(m_config.sleepingClientReleaseBroker());
 
     auto topicIdAllocRange = m_config.topicIdAllocRange();
     m_session.setTopicIdAllocationRange(topicIdAllocRange.first, topicIdAllocRange.second);
 
     addPredefinedTopicsFor(WildcardStr);
+    addRoutes();
 
-    connect(
-        &m_timer, SIGNAL(timeout()),
-        this, SLOT(tickTimeout()));
-
-    connect(
-        &m_brokerSocket, SIGNAL(connected()),
-        this, SLOT(brokerConnected()));
-    connect(
-        &m_brokerSocket, SIGNAL(disconnected()),
-        this, SLOT(brokerDisconnected()));
-    connect(
-        &m_brokerSocket, SIGNAL(readyRead()),
-        this, SLOT(readFromBrokerSocket()));
-    connect(
-        &m_brokerSocket, SIGNAL(error(QAbstractSocket::SocketError)),
-        this, SLOT(brokerSocketErrorOccurred(QAbstractSocket::SocketError)));
+    m_timer.setExpiryCb(
+        [this]()
+        {
+            tickTimeout();
+        });
 
+    setBrokerSocket(BrokerSocketPtr(new BrokerSocket()));
 }
 
-SessionWrapper::~SessionWrapper() = default;
+SessionWrapper::~SessionWrapper()
+{
+    closeBrokerStream();
+}
 
-bool SessionWrapper::start()
+bool SessionWrapper::start(ConnectPriority priority)
 {
     if (!m_session.start()) {
         std::cerr << "Failed to start new session" << std::endl;
         return false;
     }
 
-    connectToBroker();
+    connectToBroker(priority);
+    for (auto& route : m_routes) {
+        route->start();
+    }
     return true;
 }
 
 void SessionWrapper::tickTimeout()
 {
-    m_reqTicks = 0U;
     m_session.tick();
 }
 
 void SessionWrapper::brokerConnected()
 {
+    connectCompleted(ConnectScheduler::Outcome::Connected);
+    if (m_brokerStreamOpenCb) {
+        m_brokerStream = m_brokerStreamOpenCb(static_cast<int>(m_brokerSocket->socketDescriptor()));
+    }
+
     m_session.setBrokerConnected(true);
     m_reconnectRequested = false;
 }
 
 void SessionWrapper::brokerDisconnected()
 {
+    m_brokerIn.clear();
+    clearBrokerOut();
+    closeBrokerStream();
     m_session.setBrokerConnected(false);
     if (m_reconnectRequested) {
-        connectToBroker();
+        // Reconnection is requested when client sends CONNECT
+        connectToBroker(ConnectPriority::ClientWaiting);
     }
 }
 
 void SessionWrapper::readFromBrokerSocket()
 {
-    auto data = m_brokerSocket.readAll();
-
-//    std::cout << "(BROKER) --> " << std::hex;
-//    for (auto byte : data) {
-//        std::cout << std::setw(2) << std::setfill('0') << (unsigned)byte << ' ';
-//    }
-//    std::cout << std::dec << std::endl;
-
-    if (m_terminating) {
-        return;
-    }
+    // While paused, the data stays in the socket, once its read buffer
+    // is full the TCP flow control slows the broker down.
+    while ((!m_brokerInputPaused) && (0 < m_brokerSocket->bytesAvailable())) {
+        auto* buf = m_brokerIn.writePtr(MinBrokerReadSpace);
+        auto count =
+            m_brokerSocket->read(
+                reinterpret_cast<char*>(buf),
+                static_cast<decltype(m_brokerSocket->bytesAvailable())>(m_brokerIn.freeSpace()));
 
-    auto* buf = reinterpret_cast<const std::uint8_t*>(data.constData());
-    std::size_t bufSize = data.size();
+        if (count <= 0) {
+            break;
+        }
 
-    if (!m_brokerData.empty()) {
-        m_brokerData.insert(m_brokerData.end(), buf, buf + bufSize);
-        buf = &m_brokerData[0];
-        bufSize = m_brokerData.size();
-    }
+//        std::cout << "(BROKER) --> " << std::hex;
+//        for (auto idx = 0; idx < count; ++idx) {
+//            std::cout << std::setw(2) << std::setfill('0') << (unsigned)buf[idx] << ' ';
+//        }
+//        std::cout << std::dec << std::endl;
 
-    std::size_t consumed = m_session.dataFromBroker(buf, bufSize);
-    if (bufSize <= consumed) {
-        m_brokerData.clear();
-        return;
-    }
+        if (m_terminating) {
+            continue;
+        }
 
-    if (!m_brokerData.empty()) {
-        m_brokerData.erase(m_brokerData.begin(), m_brokerData.begin() + consumed);
-        return;
+        m_brokerIn.commit(static_cast<std::size_t>(count));
+        auto consumed = m_session.dataFromBroker(m_brokerIn.data(), m_brokerIn.size());
+        m_brokerIn.consume(consumed);
     }
-
-    m_brokerData.assign(buf + consumed, buf + bufSize);
 }
 
 void SessionWrapper::brokerSocketErrorOccurred(QAbstractSocket::SocketError err)
 {
     static_cast<void>(err);
-    std::cerr << "ERROR: TCP Socket: " << m_brokerSocket.errorString().toStdString() << std::endl;
+    std::cerr << "ERROR: TCP Socket: " << m_brokerSocket->errorString().toStdString() << std::endl;
+    connectCompleted(ConnectScheduler::Outcome::Failed);
 }
 
 void SessionWrapper::programNextTick(unsigned ms)
 {
     assert(!m_terminating);
-    m_reqTicks = ms;
-    m_timer.setSingleShot(true);
-    m_timer.start(ms);
+    m_timerWheel.start(m_timer, ms);
 }
 
 unsigned SessionWrapper::cancelTick()
 {
-    auto rem = m_timer.remainingTime();
-    unsigned result = 0U;
-    do {
-        if (static_cast<decltype(rem)>(m_reqTicks) <= rem) {
-            break;
-        }
+    return m_timerWheel.cancel(m_timer);
+}
+
+void SessionWrapper::sendDataToBroker(const std::uint8_t* buf, std::size_t bufSize)
+{
+    m_brokerOut.insert(m_brokerOut.end(), buf, buf + bufSize);
+    brokerDataAdded();
+}
+
+void SessionWrapper::sendPublishToBroker(
+    const std::uint8_t* header,
+    std::size_t headerSize,
+    const std::uint8_t* payload,
+    std::size_t payloadSize)
+{
+    m_brokerOut.insert(m_brokerOut.end(), header, header + headerSize);
+    if ((!m_clientDataInPlace) || (!m_brokerSocket)) {
+        m_brokerOut.insert(m_brokerOut.end(), payload, payload + payloadSize);
+        brokerDataAdded();
+        return;
+    }
 
-        result = m_reqTicks - rem;
-    } while (false);
+    // The payload points into the data received by the client socket,
+    // it is written together with the rest of the queued data by the
+    // next flush, or copied by retainBrokerData() if the flush is delayed
+    // beyond the release of the received data.
+    if (0U < payloadSize) {
+        BrokerOutPayload info;
+        info.m_pos = m_brokerOut.size();
+        info.m_buf = payload;
+        info.m_len = payloadSize;
+        m_brokerOutPayloads.push_back(info);
+        m_brokerOutPayloadsBytes += payloadSize;
+    }
+    brokerDataAdded();
+}
+
+void SessionWrapper::retainBrokerData()
+{
+    if (m_brokerOutPayloads.empty()) {
+        return;
+    }
 
-    m_timer.stop();
-    return result;
+    DataBuf data;
+    data.reserve(pendingBrokerDataSize());
+    std::size_t pos = 0U;
+    for (auto& p : m_brokerOutPayloads) {
+        data.insert(data.end(), m_brokerOut.begin() + pos, m_brokerOut.begin() + p.m_pos);
+        data.insert(data.end(), p.m_buf, p.m_buf + p.m_len);
+        pos = p.m_pos;
+    }
+    data.insert(data.end(), m_brokerOut.begin() + pos, m_brokerOut.end());
+
+    m_brokerOut.swap(data);
+    m_brokerOutPayloads.clear();
+    m_brokerOutPayloadsBytes = 0U;
 }
 
-void SessionWrapper::sendDataToBroker(const std::uint8_t* buf, std::size_t bufSize)
+void SessionWrapper::brokerDataAdded()
 {
-    std::size_t writtenCount = 0;
-    while (writtenCount < bufSize) {
-        auto remSize = bufSize - writtenCount;
-        auto count =
-            m_brokerSocket.write(
-                reinterpret_cast<const char*>(&buf[writtenCount]),
-                remSize);
-        if (count < 0) {
-            std::cerr << "Failed to write to TCP socket" << std::endl;
-            return;
+    if ((!m_brokerFlushReqCb) ||
+        (MaxPendingBrokerData <= pendingBrokerDataSize())) {
+        flushBrokerData();
+        return;
+    }
+
+    if (!m_brokerFlushRequested) {
+        m_brokerFlushRequested = true;
+        m_brokerFlushReqCb(*this);
+    }
+}
+
+void SessionWrapper::writeToBrokerSocket(const WriteChunk* chunks, std::size_t count)
+{
+    std::size_t chunkIdx = 0U;
+    std::size_t chunkOffset = 0U;
+#ifdef __linux__
+    // Write directly to the socket unless Qt still has some data buffered
+    // (previous write couldn't be completed), saves extra copy and
+    // deferral to the next event loop iteration.
+    auto fd = static_cast<int>(m_brokerSocket->socketDescriptor());
+    if ((0 <= fd) &&
+        (m_brokerSocket->state() == QTcpSocket::ConnectedState) &&
+        (m_brokerSocket->bytesToWrite() == 0)) {
+        while (chunkIdx < count) {
+            static const std::size_t MaxVecCount = 64U;
+            iovec vec[MaxVecCount];
+            std::size_t vecCount = 0U;
+            for (auto idx = chunkIdx; (idx < count) && (vecCount < MaxVecCount); ++idx) {
+                auto offset = std::size_t(0U);
+                if (idx == chunkIdx) {
+                    offset = chunkOffset;
+                }
+
+                vec[vecCount].iov_base = const_cast<std::uint8_t*>(chunks[idx].m_buf + offset);
+                vec[vecCount].iov_len = chunks[idx].m_len - offset;
+                ++vecCount;
+            }
+
+            msghdr msg;
+            std::memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = vec;
+            msg.msg_iovlen = vecCount;
+            auto result = ::sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if ((result < 0) && (errno == EINTR)) {
+                continue;
+            }
+
+            if (result <= 0) {
+                break;
+            }
+
+            auto writtenCount = static_cast<std::size_t>(result);
+            while ((0U < writtenCount) && (chunkIdx < count)) {
+                auto remSize = chunks[chunkIdx].m_len - chunkOffset;
+                if (writtenCount < remSize) {
+                    chunkOffset += writtenCount;
+                    break;
+                }
+
+                writtenCount -= remSize;
+                ++chunkIdx;
+                chunkOffset = 0U;
+            }
         }
+    }
+#endif // #ifdef __linux__
+
+    // The rest is copied into the buffer of Qt socket
+    for (; chunkIdx < count; ++chunkIdx) {
+        auto& chunk = chunks[chunkIdx];
+        while (chunkOffset < chunk.m_len) {
+            auto writeCount =
+                m_brokerSocket->write(
+                    reinterpret_cast<const char*>(&chunk.m_buf[chunkOffset]),
+                    chunk.m_len - chunkOffset);
+            if (writeCount < 0) {
+                std::cerr << "Failed to write to TCP socket" << std::endl;
+                return;
+            }
 
-        writtenCount += count;
+            chunkOffset += static_cast<std::size_t>(writeCount);
+        }
+        chunkOffset = 0U;
     }
 }
 
+void SessionWrapper::clearBrokerOut()
+{
+    m_brokerOut.clear();
+    m_brokerOutPayloads.clear();
+    m_brokerOutPayloadsBytes = 0U;
+}
+
+void SessionWrapper::flushBrokerData()
+{
+    m_brokerFlushRequested = false;
+    if (m_brokerOut.empty() && m_brokerOutPayloads.empty()) {
+        return;
+    }
+
+    // The queued data interleaved with the payloads not copied so far
+    auto& chunks = m_brokerOutChunks;
+    chunks.clear();
+    auto addChunk =
+        [&chunks](const std::uint8_t* buf, std::size_t len)
+        {
+            if (len == 0U) {
+                return;
+            }
+
+            WriteChunk chunk;
+            chunk.m_buf = buf;
+            chunk.m_len = len;
+            chunks.push_back(chunk);
+        };
+
+    std::size_t pos = 0U;
+    for (auto& p : m_brokerOutPayloads) {
+        addChunk(m_brokerOut.data() + pos, p.m_pos - pos);
+        addChunk(p.m_buf, p.m_len);
+        pos = p.m_pos;
+    }
+    addChunk(m_brokerOut.data() + pos, m_brokerOut.size() - pos);
+
+    if (m_brokerStream) {
+        // The submission is asynchronous, the stream keeps its own copy
+        // of the data until the write completes.
+        for (auto& c : chunks) {
+            m_brokerStream->write(c.m_buf, c.m_len);
+        }
+    }
+    else {
+        writeToBrokerSocket(chunks.data(), chunks.size());
+    }
+
+    clearBrokerOut();
+}
+
 void SessionWrapper::termSession()
 {
     if (m_terminating) {
@@ -245,10 +458,18 @@ void SessionWrapper::termSession()
     }
 
     m_terminating = true;
-    m_timer.stop();
-    m_brokerSocket.blockSignals(true);
-    m_brokerSocket.flush();
-    m_brokerSocket.disconnectFromHost();
+    m_timerWheel.cancel(m_timer);
+    m_connectScheduler.cancel(m_connectTicket);
+    m_connectTicket = ConnectScheduler::NoTicket;
+    connectCompleted(ConnectScheduler::Outcome::Abandoned);
+    flushBrokerData();
+    closeBrokerStream();
+    for (auto& route : m_routes) {
+        route->close();
+    }
+    m_brokerSocket->blockSignals(true);
+    m_brokerSocket->flush();
+    m_brokerSocket->disconnectFromHost();
     assert(m_termNotifyCb);
     m_termNotifyCb(*this);
     deleteLater();
@@ -257,15 +478,183 @@ void SessionWrapper::termSession()
 void SessionWrapper::reconnectBroker()
 {
     m_reconnectRequested = true;
-    assert(m_brokerSocket.state() == QTcpSocket::ConnectedState);
-    m_brokerSocket.disconnectFromHost();
+    if (m_brokerSocket->state() == QTcpSocket::UnconnectedState) {
+        // The connection has been released while the client was asleep
+        connectToBroker(ConnectPriority::ClientWaiting);
+        return;
+    }
+
+    m_brokerSocket->disconnectFromHost();
 }
 
-void SessionWrapper::connectToBroker()
+void SessionWrapper::releaseBroker()
 {
-    auto host = QString::fromStdString(m_config.brokerTcpHostAddress());
-    auto port = m_config.brokerTcpHostPort();
-    m_brokerSocket.connectToHost(host, port);
+    // Make sure DISCONNECT reaches the broker
+    flushBrokerData();
+    m_brokerSocket->disconnectFromHost();
+}
+
+void SessionWrapper::closeBrokerStream()
+{
+    if (!m_brokerStream) {
+        return;
+    }
+
+    m_brokerStream->close();
+    m_brokerStream.reset();
+}
+
+void SessionWrapper::pauseBrokerInput(bool paused)
+{
+    m_brokerInputPaused = paused;
+    if (paused) {
+        return;
+    }
+
+    // Invoked from within the session, read the pending data later.
+    QMetaObject::invokeMethod(this, "readFromBrokerSocket", Qt::QueuedConnection);
+}
+
+void SessionWrapper::brokerPubQueueUpdated(std::size_t bytes)
+{
+    auto prevBytes = m_brokerPubQueueBytes;
+    m_brokerPubQueueBytes = bytes;
+    if (m_brokerPubQueueReportCb) {
+        m_brokerPubQueueReportCb(*this, prevBytes, bytes);
+    }
+}
+
+void SessionWrapper::setBrokerSocket(BrokerSocketPtr socket)
+{
+    assert(socket);
+    if (m_brokerSocket) {
+        // May be invoked from within the signal of the old socket
+        m_brokerSocket->disconnect(this);
+        m_brokerSocket.release()->deleteLater();
+    }
+
+    m_brokerSocket = std::move(socket);
+    if (m_brokerInputPausable) {
+        // Keep the data in the kernel while the input is paused
+        m_brokerSocket->setReadBufferSize(static_cast<qint64>(BrokerInputBufSize));
+    }
+
+    connect(
+        m_brokerSocket.get(), SIGNAL(connected()),
+        this, SLOT(brokerConnected()));
+    connect(
+        m_brokerSocket.get(), SIGNAL(disconnected()),
+        this, SLOT(brokerDisconnected()));
+    connect(
+        m_brokerSocket.get(), SIGNAL(readyRead()),
+        this, SLOT(readFromBrokerSocket()));
+    connect(
+        m_brokerSocket.get(), SIGNAL(error(QAbstractSocket::SocketError)),
+        this, SLOT(brokerSocketErrorOccurred(QAbstractSocket::SocketError)));
+}
+
+void SessionWrapper::connectToBroker(ConnectPriority priority)
+{
+    if ((m_connectTicket != ConnectScheduler::NoTicket) || m_connectInFlight) {
+        return;
+    }
+
+    m_connectTicket =
+        m_connectScheduler.request(
+            priority,
+            [this]()
+            {
+                m_connectTicket = ConnectScheduler::NoTicket;
+                m_connectInFlight = true;
+                doConnectToBroker();
+            });
+}
+
+void SessionWrapper::connectCompleted(ConnectScheduler::Outcome outcome)
+{
+    if (!m_connectInFlight) {
+        return;
+    }
+
+    m_connectInFlight = false;
+    m_connectScheduler.complete(outcome);
+
+    auto timed = m_connectTimed;
+    m_connectTimed = false;
+    if ((!timed) ||
+        (outcome == ConnectScheduler::Outcome::Abandoned) ||
+        (!m_brokerConnectReportCb)) {
+        return;
+    }
+
+    auto latencyMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - m_connectStart).count();
+    m_brokerConnectReportCb(
+        *this,
+        outcome == ConnectScheduler::Outcome::Connected,
+        static_cast<unsigned>(latencyMs));
+}
+
+void SessionWrapper::doConnectToBroker()
+{
+    if (m_brokerSocketReqCb) {
+        auto socket = m_brokerSocketReqCb();
+        if (socket) {
+            setBrokerSocket(std::move(socket));
+            brokerConnected();
+            return;
+        }
+    }
+
+    m_connectTimed = true;
+    m_connectStart = std::chrono::steady_clock::now();
+    if (m_broker != nullptr) {
+        m_brokerSocket->connectToBroker(m_broker->address, m_broker->port);
+        return;
+    }
+
+    m_brokerSocket->connectToBroker(m_config.brokerTcpHostAddress(), m_config.brokerTcpHostPort());
+}
+
+void SessionWrapper::addRoutes()
+{
+    auto& routes = m_config.topicRoutes();
+    if (routes.empty()) {
+        return;
+    }
+
+    m_session.setSendDataRouteReqCb(
+        [this](unsigned route, const std::uint8_t* buf, std::size_t bufSize)
+        {
+            assert(route < m_routes.size());
+            m_routes[route]->write(buf, bufSize);
+        });
+
+    for (auto& info : routes) {
+        if (!m_session.addBrokerRoute(info.topicFilter)) {
+            std::cerr << "WARNING: Invalid topic route \"" << info.topicFilter << '"' << std::endl;
+            continue;
+        }
+
+        auto routeIdx = static_cast<unsigned>(m_routes.size());
+        RouteLinkPtr route(new RouteLink(info, m_timerWheel, nullptr));
+        route->setConnectionReportCb(
+            [this, routeIdx](bool connected)
+            {
+                m_session.setRouteConnected(routeIdx, connected);
+            });
+        route->setDataReportCb(
+            [this, routeIdx](const std::uint8_t* buf, std::size_t bufSize) -> std::size_t
+            {
+                if (m_terminating) {
+                    return bufSize;
+                }
+
+                return m_session.dataFromRoute(routeIdx, buf, bufSize);
+            });
+        m_routes.push_back(std::move(route));
+    }
 }
 
 void SessionWrapper::addPredefinedTopicsFor(const std::string& clientId)
@@ -288,6 +677,15 @@ void SessionWrapper::addPredefinedTopicsFor(const std::string& clientId)
     }
 }
 
+const std::string& SessionWrapper::configClientId(const std::string& clientId) const
+{
+    if ((!m_defaultClientId.empty()) && (clientId == m_defaultClientId)) {
+        return m_config.defaultClientId();
+    }
+
+    return clientId;
+}
+
 SessionWrapper::AuthInfo SessionWrapper::getAuthInfoFor(const std::string& clientId)
 {
     auto& authInfos = m_config.authInfos();
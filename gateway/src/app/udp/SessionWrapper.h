@@ -20,19 +20,25 @@
 
 #include <memory>
 #include <vector>
+#include <string>
 #include <cstdint>
+#include <chrono>
 
 #include "comms/CompileControl.h"
 
 CC_DISABLE_WARNINGS()
 #include <QtCore/QObject>
-#include <QtCore/QTimer>
-#include <QtNetwork/QTcpSocket>
-#include <QtNetwork/QHostAddress>
 CC_ENABLE_WARNINGS()
 
 #include "mqttsn/gateway/Config.h"
 #include "mqttsn/gateway/Session.h"
+#include "ClientAddr.h"
+#include "BrokerStream.h"
+#include "TimerWheel.h"
+#include "StreamBuf.h"
+#include "ConnectScheduler.h"
+#include "BrokerSocket.h"
+#include "RouteLink.h"
 
 namespace mqttsn
 {
@@ -54,7 +60,17 @@ public:
     typedef unsigned short PortType;
     typedef mqttsn::gateway::Session::AuthInfo AuthInfo;
 
-    SessionWrapper(const Config& config, QObject* parent);
+    typedef mqttsn::gateway::Session::BrokerPubInfoPtr BrokerPubInfoPtr;
+
+    typedef ConnectScheduler::Priority ConnectPriority;
+
+    typedef mqttsn::gateway::Config::BrokerInfo BrokerInfo;
+
+    SessionWrapper(
+        const Config& config,
+        TimerWheel& timerWheel,
+        ConnectScheduler& connectScheduler,
+        QObject* parent);
     ~SessionWrapper();
 
 
@@ -65,41 +81,178 @@ public:
         m_termNotifyCb = std::forward<TFunc>(cb);
     }
 
+    typedef std::function<BrokerStreamPtr (int fd)> BrokerStreamOpenCb;
+    template <typename TFunc>
+    void setBrokerStreamOpenCb(TFunc&& cb)
+    {
+        m_brokerStreamOpenCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::unique_ptr<BrokerSocket> BrokerSocketPtr;
+    typedef std::function<BrokerSocketPtr ()> BrokerSocketReqCb;
+    template <typename TFunc>
+    void setBrokerSocketReqCb(TFunc&& cb)
+    {
+        m_brokerSocketReqCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::function<void (const SessionWrapper&, bool success, unsigned latencyMs)> BrokerConnectReportCb;
+    template <typename TFunc>
+    void setBrokerConnectReportCb(TFunc&& cb)
+    {
+        m_brokerConnectReportCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::function<void (SessionWrapper&)> BrokerFlushReqCb;
+    template <typename TFunc>
+    void setBrokerFlushReqCb(TFunc&& cb)
+    {
+        m_brokerFlushReqCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::function<void (SessionWrapper&, std::size_t prevBytes, std::size_t bytes)> BrokerPubQueueReportCb;
+    template <typename TFunc>
+    void setBrokerPubQueueReportCb(TFunc&& cb)
+    {
+        m_brokerPubQueueReportCb = std::forward<TFunc>(cb);
+    }
+
+    typedef std::function<void (SessionWrapper&, const std::string& clientId)> ClientConnectedReportCb;
+    template <typename TFunc>
+    void setClientConnectedReportCb(TFunc&& cb)
+    {
+        m_clientConnectedReportCb = std::forward<TFunc>(cb);
+    }
+
     template <typename TFunc>
     void setSendDataReqCb(TFunc&& cb)
     {
         m_session.setSendDataClientReqCb(std::forward<TFunc>(cb));
     }
 
-    bool start();
+    template <typename TFunc>
+    void setBrokerPubReportCb(TFunc&& cb)
+    {
+        m_session.setBrokerPubReportCb(std::forward<TFunc>(cb));
+    }
+
+    template <typename TFunc>
+    void setSubscribeFanOutReqCb(TFunc&& cb)
+    {
+        m_session.setSubscribeFanOutReqCb(std::forward<TFunc>(cb));
+    }
+
+    template <typename TFunc>
+    void setUnsubscribeFanOutReqCb(TFunc&& cb)
+    {
+        m_session.setUnsubscribeFanOutReqCb(std::forward<TFunc>(cb));
+    }
+
+    template <typename TFunc>
+    void setClientPubStoreReqCb(TFunc&& cb)
+    {
+        m_session.setClientPubStoreReqCb(std::forward<TFunc>(cb));
+    }
+
+    bool start(ConnectPriority priority);
+    void flushBrokerData();
+
+    std::size_t pendingBrokerDataSize() const
+    {
+        return m_brokerOut.size() + m_brokerOutPayloadsBytes;
+    }
+
+    // Copies the queued payloads which still point into the received
+    // client data.
+    void retainBrokerData();
+
+    std::size_t brokerInputHighWaterMark() const
+    {
+        return m_brokerIn.highWaterMark();
+    }
+
+    std::size_t brokerPubQueueBytes() const
+    {
+        return m_brokerPubQueueBytes;
+    }
+
+    // Overrides the configured default client ID, the predefined topics
+    // and the authentication info are still looked up by the configured one.
+    void setDefaultClientId(const std::string& value)
+    {
+        m_defaultClientId = value;
+        m_session.setDefaultClientId(value);
+    }
+
+    const std::string& clientId() const
+    {
+        return m_session.clientId();
+    }
+
+    bool isCleanSession() const
+    {
+        return m_session.isCleanSession();
+    }
+
+    bool isBrokerInputPaused() const
+    {
+        return m_brokerInputPaused;
+    }
+
+    void setBrokerInputHeld(bool value)
+    {
+        m_session.setBrokerInputHeld(value);
+    }
+
+    // The read buffer of the broker socket is limited only when its
+    // input may be paused, applies to the sockets set afterwards.
+    void setBrokerInputPausable(bool value)
+    {
+        m_brokerInputPausable = value;
+    }
 
     void dataFromClient(const std::uint8_t* buf, const std::size_t bufLen)
     {
         m_session.dataFromClient(buf, bufLen);
     }
 
-    void setClientAddr(const QString& value)
+    // The buffer belongs to the client socket and stays valid until its
+    // release is reported, the payloads of the forwarded publishes are
+    // queued without copying until then.
+    void dataFromClientSocket(const std::uint8_t* buf, const std::size_t bufLen)
+    {
+        m_clientDataInPlace = true;
+        m_session.dataFromClient(buf, bufLen);
+        m_clientDataInPlace = false;
+    }
+
+    void addBrokerPub(BrokerPubInfoPtr info)
+    {
+        m_session.addBrokerPub(std::move(info));
+    }
+
+    void setClientAddr(const ClientAddr& value)
     {
         m_clientAddr = value;
     }
 
-    const QString& getClientAddr() const
+    const ClientAddr& getClientAddr() const
     {
         return m_clientAddr;
     }
 
-    void setClientPort(PortType value)
+    void setBroker(std::size_t idx, const BrokerInfo& info)
     {
-        m_clientPort = value;
+        m_brokerIdx = idx;
+        m_broker = &info;
     }
 
-    PortType getClientPort() const
+    std::size_t getBrokerIdx() const
     {
-        return m_clientPort;
+        return m_brokerIdx;
     }
 
 private slots:
-    void tickTimeout();
     void brokerConnected();
     void brokerDisconnected();
     void readFromBrokerSocket();
@@ -107,26 +260,87 @@ private slots:
 
 private:
     typedef std::vector<std::uint8_t> DataBuf;
+    typedef std::unique_ptr<RouteLink> RouteLinkPtr;
+
+    // Payload written after m_pos bytes of m_brokerOut
+    struct BrokerOutPayload
+    {
+        std::size_t m_pos = 0U;
+        const std::uint8_t* m_buf = nullptr;
+        std::size_t m_len = 0U;
+    };
+    typedef std::vector<BrokerOutPayload> BrokerOutPayloadsList;
+
+    struct WriteChunk
+    {
+        const std::uint8_t* m_buf = nullptr;
+        std::size_t m_len = 0U;
+    };
+    typedef std::vector<WriteChunk> WriteChunksList;
 
+    typedef std::vector<RouteLinkPtr> RouteLinksList;
+
+    void tickTimeout();
     void programNextTick(unsigned ms);
     unsigned cancelTick();
     void sendDataToBroker(const std::uint8_t* buf, std::size_t bufSize);
+    void sendPublishToBroker(
+        const std::uint8_t* header,
+        std::size_t headerSize,
+        const std::uint8_t* payload,
+        std::size_t payloadSize);
+    void brokerDataAdded();
+    void writeToBrokerSocket(const WriteChunk* chunks, std::size_t count);
+    void clearBrokerOut();
     void termSession();
     void reconnectBroker();
-    void connectToBroker();
+    void releaseBroker();
+    void closeBrokerStream();
+    void pauseBrokerInput(bool paused);
+    void brokerPubQueueUpdated(std::size_t bytes);
+    void setBrokerSocket(BrokerSocketPtr socket);
+    void connectToBroker(ConnectPriority priority);
+    void connectCompleted(ConnectScheduler::Outcome outcome);
+    void doConnectToBroker();
+    void addRoutes();
     void addPredefinedTopicsFor(const std::string& clientId);
     AuthInfo getAuthInfoFor(const std::string& clientId);
+    const std::string& configClientId(const std::string& clientId) const;
 
     const Config& m_config;
-    QTcpSocket m_brokerSocket;
+    BrokerSocketPtr m_brokerSocket;
     mqttsn::gateway::Session m_session;
-    QTimer m_timer;
-    unsigned m_reqTicks = 0;
+    TimerWheel& m_timerWheel;
+    TimerWheel::Timer m_timer;
+    ConnectScheduler& m_connectScheduler;
+    ConnectScheduler::Ticket m_connectTicket = ConnectScheduler::NoTicket;
+    bool m_connectInFlight = false;
     bool m_reconnectRequested = false;
-    DataBuf m_brokerData;
+    StreamBuf m_brokerIn;
+    DataBuf m_brokerOut;
+    BrokerOutPayloadsList m_brokerOutPayloads;
+    std::size_t m_brokerOutPayloadsBytes = 0U;
+    WriteChunksList m_brokerOutChunks;
+    bool m_clientDataInPlace = false;
+    bool m_brokerFlushRequested = false;
+    std::chrono::steady_clock::time_point m_connectStart;
+    bool m_connectTimed = false;
     TermNotifyCb m_termNotifyCb;
-    QString m_clientAddr;
-    PortType m_clientPort = 0;
+    BrokerConnectReportCb m_brokerConnectReportCb;
+    BrokerFlushReqCb m_brokerFlushReqCb;
+    BrokerSocketReqCb m_brokerSocketReqCb;
+    BrokerStreamOpenCb m_brokerStreamOpenCb;
+    BrokerPubQueueReportCb m_brokerPubQueueReportCb;
+    ClientConnectedReportCb m_clientConnectedReportCb;
+    std::size_t m_brokerPubQueueBytes = 0U;
+    bool m_brokerInputPaused = false;
+    bool m_brokerInputPausable = false;
+    BrokerStreamPtr m_brokerStream;
+    RouteLinksList m_routes;
+    ClientAddr m_clientAddr;
+    std::string m_defaultClientId;
+    const BrokerInfo* m_broker = nullptr;
+    std::size_t m_brokerIdx = 0U;
     bool m_terminating = false;
 };
 
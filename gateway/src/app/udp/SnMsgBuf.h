@@ -0,0 +1,140 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Builds and parses the MQTT-SN frames exchanged by the internal clients of
+// the gateway with their sessions. The body is written after the space
+// reserved for the longest length field, which is filled once the size of
+// the message is known, so the frame is never copied.
+class SnMsgBuf
+{
+public:
+    struct Frame
+    {
+        const std::uint8_t* m_body = nullptr;
+        std::size_t m_bodyLen = 0U;
+        std::uint8_t m_type = 0U;
+    };
+
+    void begin(std::uint8_t type)
+    {
+        m_data.resize(HeaderSpace);
+        m_data.push_back(type);
+    }
+
+    void writeU8(std::uint8_t val)
+    {
+        m_data.push_back(val);
+    }
+
+    void writeU16(std::size_t val)
+    {
+        m_data.push_back(static_cast<std::uint8_t>(val >> 8));
+        m_data.push_back(static_cast<std::uint8_t>(val));
+    }
+
+    void writeData(const char* data, std::size_t len)
+    {
+        m_data.insert(m_data.end(), data, data + len);
+    }
+
+    void writeData(const std::uint8_t* data, std::size_t len)
+    {
+        m_data.insert(m_data.end(), data, data + len);
+    }
+
+    void writeData(const std::string& str)
+    {
+        writeData(str.c_str(), str.size());
+    }
+
+    // Writes the length field in front of the type and returns the
+    // beginning of the complete frame.
+    const std::uint8_t* finish(std::size_t& frameLen)
+    {
+        assert(HeaderSpace < m_data.size());
+        auto len = m_data.size() - (HeaderSpace - 1U);
+        std::size_t pos = HeaderSpace - 1U;
+        if (MaxShortLength < len) {
+            len += 2U;
+            pos = 0U;
+            m_data[0] = LongLengthPrefix;
+            m_data[1] = static_cast<std::uint8_t>(len >> 8);
+        }
+
+        m_data[HeaderSpace - 1U] = static_cast<std::uint8_t>(len);
+        frameLen = len;
+        return &m_data[pos];
+    }
+
+    static bool parse(const std::uint8_t* buf, std::size_t bufSize, Frame& frame)
+    {
+        std::size_t typePos = 1U;
+        if ((0U < bufSize) && (buf[0] == LongLengthPrefix)) {
+            typePos = HeaderSpace;
+        }
+
+        if (bufSize <= typePos) {
+            return false;
+        }
+
+        frame.m_type = buf[typePos];
+        frame.m_body = buf + typePos + 1U;
+        frame.m_bodyLen = bufSize - (typePos + 1U);
+        return true;
+    }
+
+    static std::uint16_t readU16(const std::uint8_t* buf)
+    {
+        return static_cast<std::uint16_t>((buf[0] << 8) | buf[1]);
+    }
+
+private:
+    static const std::size_t HeaderSpace = 3U;
+    static const std::size_t MaxShortLength = 0xff;
+    static const std::uint8_t LongLengthPrefix = 0x01;
+
+    std::vector<std::uint8_t> m_data;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
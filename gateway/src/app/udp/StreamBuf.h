@@ -0,0 +1,137 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class StreamBuf
+{
+public:
+    explicit StreamBuf(std::size_t capacity)
+      : m_data(capacity)
+    {
+    }
+
+    const std::uint8_t* data() const
+    {
+        return m_data.data() + m_head;
+    }
+
+    std::size_t size() const
+    {
+        return m_tail - m_head;
+    }
+
+    bool empty() const
+    {
+        return m_head == m_tail;
+    }
+
+    std::size_t capacity() const
+    {
+        return m_data.size();
+    }
+
+    std::size_t highWaterMark() const
+    {
+        return m_highWaterMark;
+    }
+
+    // Returns contiguous free space of at least minSpace bytes after the
+    // stored data. The buffer is compacted only when the space at the end
+    // is insufficient and grows only when a single pending frame exceeds
+    // the current capacity.
+    std::uint8_t* writePtr(std::size_t minSpace)
+    {
+        if (minSpace <= freeSpace()) {
+            return m_data.data() + m_tail;
+        }
+
+        auto count = size();
+        if (m_head != 0U) {
+            std::memmove(m_data.data(), m_data.data() + m_head, count);
+            m_head = 0U;
+            m_tail = count;
+        }
+
+        if (freeSpace() < minSpace) {
+            m_data.resize(std::max(m_data.size() * 2, count + minSpace));
+        }
+
+        return m_data.data() + m_tail;
+    }
+
+    std::size_t freeSpace() const
+    {
+        return m_data.size() - m_tail;
+    }
+
+    void commit(std::size_t count)
+    {
+        assert(count <= freeSpace());
+        m_tail += count;
+        m_highWaterMark = std::max(m_highWaterMark, size());
+    }
+
+    void consume(std::size_t count)
+    {
+        assert(count <= size());
+        m_head += count;
+        if (m_head == m_tail) {
+            clear();
+        }
+    }
+
+    void clear()
+    {
+        m_head = 0U;
+        m_tail = 0U;
+    }
+
+private:
+    std::vector<std::uint8_t> m_data;
+    std::size_t m_head = 0U;
+    std::size_t m_tail = 0U;
+    std::size_t m_highWaterMark = 0U;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
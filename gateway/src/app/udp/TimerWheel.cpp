@@ -0,0 +1,353 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "TimerWheel.h"
+
+#include <cassert>
+#include <chrono>
+#include <algorithm>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+// Distance (1 - 64) from "from" position to the next set bit, 0 if none
+unsigned nextSetBitDist(std::uint64_t bits, unsigned from)
+{
+    if (bits == 0U) {
+        return 0U;
+    }
+
+    auto start = (from + 1) & 63U;
+    auto rotated = (bits >> start) | ((start == 0U) ? 0U : (bits << (64U - start)));
+    return static_cast<unsigned>(__builtin_ctzll(rotated)) + 1U;
+}
+
+}  // namespace
+
+TimerWheel::Timer::~Timer()
+{
+    if (m_wheel != nullptr) {
+        m_wheel->cancel(*this);
+    }
+}
+
+TimerWheel::TimerWheel()
+  : m_now(nowMs())
+{
+    m_level0.fill(nullptr);
+    for (auto& level : m_levels) {
+        level.fill(nullptr);
+    }
+    m_level0Bitmap.fill(0U);
+    m_bitmaps.fill(0U);
+}
+
+TimerWheel::~TimerWheel()
+{
+    auto detachAll =
+        [](Timer* timer)
+        {
+            while (timer != nullptr) {
+                auto* next = timer->m_next;
+                timer->m_wheel = nullptr;
+                timer->m_prev = nullptr;
+                timer->m_next = nullptr;
+                timer = next;
+            }
+        };
+
+    for (auto* head : m_level0) {
+        detachAll(head);
+    }
+
+    for (auto& level : m_levels) {
+        for (auto* head : level) {
+            detachAll(head);
+        }
+    }
+}
+
+TimerWheel::Timestamp TimerWheel::nowMs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<Timestamp>(std::chrono::duration_cast<std::chrono::milliseconds>(now).count());
+}
+
+void TimerWheel::start(Timer& timer, unsigned ms)
+{
+    if (timer.m_wheel != nullptr) {
+        cancel(timer);
+    }
+
+    auto now = std::max(nowMs(), m_now);
+    timer.m_wheel = this;
+    timer.m_start = now;
+    timer.m_duration = ms;
+    timer.m_expiry = now + ms;
+    place(timer, 1U);
+    ++m_activeCount;
+
+    if (timer.m_expiry < m_wakeupAt) {
+        requestWakeup(now);
+    }
+}
+
+unsigned TimerWheel::cancel(Timer& timer)
+{
+    if (timer.m_wheel == nullptr) {
+        return 0U;
+    }
+
+    assert(timer.m_wheel == this);
+    unlink(timer);
+    timer.m_wheel = nullptr;
+    assert(0U < m_activeCount);
+    --m_activeCount;
+
+    auto now = nowMs();
+    if (now <= timer.m_start) {
+        return 0U;
+    }
+
+    auto elapsed = now - timer.m_start;
+    return static_cast<unsigned>(std::min<Timestamp>(elapsed, timer.m_duration));
+}
+
+void TimerWheel::advance()
+{
+    advanceTo(nowMs());
+}
+
+void TimerWheel::advanceTo(Timestamp now)
+{
+    m_wakeupAt = NoWakeup;
+    while (true) {
+        auto next = nextExpiry();
+        if (now < next) {
+            break;
+        }
+
+        m_now = next;
+        auto slot = static_cast<unsigned>(m_now & (Level0Size - 1));
+        if (slot == 0U) {
+            for (auto level = 1U; level < LevelsCount; ++level) {
+                auto levelSlot = static_cast<unsigned>((m_now >> levelShift(level)) & (LevelNSize - 1));
+                cascade(level, levelSlot);
+                if (levelSlot != 0U) {
+                    break;
+                }
+            }
+        }
+
+        expireSlot(slot);
+    }
+
+    m_now = std::max(m_now, now);
+    requestWakeup(now);
+}
+
+TimerWheel::Timestamp TimerWheel::nextExpiry() const
+{
+    if (m_activeCount == 0U) {
+        return NoWakeup;
+    }
+
+    auto result = NoWakeup;
+    auto pos = static_cast<unsigned>(m_now & (Level0Size - 1));
+    for (auto dist = 1U; dist <= Level0Size; ) {
+        auto idx = (pos + dist) & (Level0Size - 1);
+        auto word = m_level0Bitmap[idx / 64U];
+        auto bit = idx % 64U;
+        auto remaining = word >> bit;
+        if (remaining != 0U) {
+            auto skip = static_cast<unsigned>(__builtin_ctzll(remaining));
+            if ((dist + skip) <= Level0Size) {
+                result = m_now + dist + skip;
+            }
+            break;
+        }
+
+        dist += 64U - bit;
+    }
+
+    for (auto level = 1U; level < LevelsCount; ++level) {
+        auto shift = levelShift(level);
+        auto base = m_now >> shift;
+        auto levelDist = nextSetBitDist(m_bitmaps[level - 1], static_cast<unsigned>(base & (LevelNSize - 1)));
+        if (levelDist == 0U) {
+            continue;
+        }
+
+        result = std::min(result, (base + levelDist) << shift);
+    }
+
+    return result;
+}
+
+void TimerWheel::place(Timer& timer, Timestamp minDelta)
+{
+    auto delta = (m_now < timer.m_expiry) ? (timer.m_expiry - m_now) : 0U;
+    delta = std::max(delta, minDelta);
+    auto expiry = m_now + delta;
+    unsigned level = 0U;
+    unsigned slot = 0U;
+    if (delta < Level0Size) {
+        slot = static_cast<unsigned>(expiry & (Level0Size - 1));
+    }
+    else {
+        level = 1U;
+        while ((level < (LevelsCount - 1)) &&
+               ((static_cast<Timestamp>(1U) << (levelShift(level) + LevelNBits)) <= delta)) {
+            ++level;
+        }
+
+        auto maxDelta = (static_cast<Timestamp>(1U) << (levelShift(level) + LevelNBits)) - 1;
+        if (maxDelta < delta) {
+            expiry = m_now + maxDelta;
+        }
+        slot = static_cast<unsigned>((expiry >> levelShift(level)) & (LevelNSize - 1));
+    }
+
+    timer.m_level = level;
+    timer.m_slot = slot;
+
+    auto& head = slotHead(level, slot);
+    timer.m_prev = nullptr;
+    timer.m_next = head;
+    if (head != nullptr) {
+        head->m_prev = &timer;
+    }
+    head = &timer;
+
+    if (level == 0U) {
+        m_level0Bitmap[slot / 64U] |= (static_cast<std::uint64_t>(1U) << (slot % 64U));
+    }
+    else {
+        m_bitmaps[level - 1] |= (static_cast<std::uint64_t>(1U) << slot);
+    }
+}
+
+void TimerWheel::unlink(Timer& timer)
+{
+    auto& head = slotHead(timer.m_level, timer.m_slot);
+    if (timer.m_prev != nullptr) {
+        timer.m_prev->m_next = timer.m_next;
+    }
+    else {
+        assert(head == &timer);
+        head = timer.m_next;
+    }
+
+    if (timer.m_next != nullptr) {
+        timer.m_next->m_prev = timer.m_prev;
+    }
+
+    timer.m_prev = nullptr;
+    timer.m_next = nullptr;
+
+    if (head != nullptr) {
+        return;
+    }
+
+    if (timer.m_level == 0U) {
+        m_level0Bitmap[timer.m_slot / 64U] &= ~(static_cast<std::uint64_t>(1U) << (timer.m_slot % 64U));
+    }
+    else {
+        m_bitmaps[timer.m_level - 1] &= ~(static_cast<std::uint64_t>(1U) << timer.m_slot);
+    }
+}
+
+void TimerWheel::cascade(unsigned level, unsigned slot)
+{
+    auto& head = slotHead(level, slot);
+    auto* timer = head;
+    head = nullptr;
+    m_bitmaps[level - 1] &= ~(static_cast<std::uint64_t>(1U) << slot);
+
+    while (timer != nullptr) {
+        auto* next = timer->m_next;
+        place(*timer, 0U);
+        timer = next;
+    }
+}
+
+void TimerWheel::expireSlot(unsigned slot)
+{
+    auto& head = m_level0[slot];
+    while (head != nullptr) {
+        auto* timer = head;
+        if (m_now < timer->m_expiry) {
+            // Timer with too long duration got placed at max possible delay
+            unlink(*timer);
+            place(*timer, 1U);
+            continue;
+        }
+
+        unlink(*timer);
+        timer->m_wheel = nullptr;
+        --m_activeCount;
+        if (timer->m_expiryCb) {
+            timer->m_expiryCb();
+        }
+    }
+}
+
+TimerWheel::Timer*& TimerWheel::slotHead(unsigned level, unsigned slot)
+{
+    if (level == 0U) {
+        return m_level0[slot];
+    }
+
+    return m_levels[level - 1][slot];
+}
+
+void TimerWheel::requestWakeup(Timestamp now)
+{
+    auto next = nextExpiry();
+    if (next == NoWakeup) {
+        m_wakeupAt = NoWakeup;
+        return;
+    }
+
+    m_wakeupAt = next;
+    if (!m_wakeupReqCb) {
+        return;
+    }
+
+    auto ms = (now < next) ? static_cast<unsigned>(std::min<Timestamp>(next - now, std::numeric_limits<unsigned>::max())) : 0U;
+    m_wakeupReqCb(ms);
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,152 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <limits>
+#include <cstdint>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class TimerWheel
+{
+public:
+    typedef std::uint64_t Timestamp;
+
+    class Timer
+    {
+    public:
+        typedef std::function<void ()> ExpiryCb;
+
+        Timer() = default;
+        ~Timer();
+
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        template <typename TFunc>
+        void setExpiryCb(TFunc&& func)
+        {
+            m_expiryCb = std::forward<TFunc>(func);
+        }
+
+        bool isActive() const
+        {
+            return m_wheel != nullptr;
+        }
+
+    private:
+        friend class TimerWheel;
+
+        TimerWheel* m_wheel = nullptr;
+        Timer* m_prev = nullptr;
+        Timer* m_next = nullptr;
+        Timestamp m_start = 0U;
+        Timestamp m_expiry = 0U;
+        unsigned m_duration = 0U;
+        unsigned m_level = 0U;
+        unsigned m_slot = 0U;
+        ExpiryCb m_expiryCb;
+    };
+
+    typedef std::function<void (unsigned ms)> WakeupReqCb;
+
+    static const Timestamp NoWakeup = std::numeric_limits<Timestamp>::max();
+
+    TimerWheel();
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    template <typename TFunc>
+    void setWakeupReqCb(TFunc&& func)
+    {
+        m_wakeupReqCb = std::forward<TFunc>(func);
+    }
+
+    static Timestamp nowMs();
+
+    void start(Timer& timer, unsigned ms);
+    unsigned cancel(Timer& timer);
+
+    void advance();
+    void advanceTo(Timestamp now);
+
+    Timestamp nextExpiry() const;
+
+    std::size_t activeCount() const
+    {
+        return m_activeCount;
+    }
+
+private:
+    static const unsigned Level0Bits = 8U;
+    static const unsigned Level0Size = 1U << Level0Bits;
+    static const unsigned LevelNBits = 6U;
+    static const unsigned LevelNSize = 1U << LevelNBits;
+    static const unsigned LevelsCount = 5U;
+    static const unsigned Level0Words = Level0Size / 64U;
+
+    typedef std::array<Timer*, Level0Size> Level0Slots;
+    typedef std::array<Timer*, LevelNSize> LevelNSlots;
+    typedef std::array<LevelNSlots, LevelsCount - 1> UpperLevels;
+    typedef std::array<std::uint64_t, Level0Words> Level0Bitmap;
+    typedef std::array<std::uint64_t, LevelsCount - 1> UpperBitmaps;
+
+    static unsigned levelShift(unsigned level)
+    {
+        return Level0Bits + ((level - 1) * LevelNBits);
+    }
+
+    void place(Timer& timer, Timestamp minDelta);
+    void unlink(Timer& timer);
+    void cascade(unsigned level, unsigned slot);
+    void expireSlot(unsigned slot);
+    Timer*& slotHead(unsigned level, unsigned slot);
+    void requestWakeup(Timestamp now);
+
+    Timestamp m_now = 0U;
+    Timestamp m_wakeupAt = NoWakeup;
+    std::size_t m_activeCount = 0U;
+    Level0Slots m_level0;
+    UpperLevels m_levels;
+    Level0Bitmap m_level0Bitmap;
+    UpperBitmaps m_bitmaps;
+    WakeupReqCb m_wakeupReqCb;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
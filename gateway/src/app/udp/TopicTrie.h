@@ -0,0 +1,348 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+// Subscriptions of multiple subscribers to MQTT topic filters,
+// matched level by level against the published topics.
+template <typename TSub>
+class TopicTrie
+{
+public:
+    typedef std::uint8_t QosType;
+
+    // Returns true when the filter gets its first subscriber
+    bool add(const std::string& filter, TSub* sub, QosType qos)
+    {
+        auto* node = &m_root;
+        forEachLevel(
+            filter,
+            [&node](const std::string& level)
+            {
+                auto& child = node->m_children[level];
+                if (!child) {
+                    child.reset(new Node);
+                }
+                node = child.get();
+            });
+
+        bool firstSub = node->m_subs.empty();
+        auto iter = findSub(*node, sub);
+        if (iter != node->m_subs.end()) {
+            iter->second = qos;
+            return false;
+        }
+
+        node->m_subs.emplace_back(sub, qos);
+        m_subFilters[sub].push_back(filter);
+        if (firstSub) {
+            ++m_filtersCount;
+        }
+        return firstSub;
+    }
+
+    // Returns true when the filter loses its last subscriber
+    bool remove(const std::string& filter, const TSub* sub)
+    {
+        auto filtersIter = m_subFilters.find(sub);
+        if (filtersIter == m_subFilters.end()) {
+            return false;
+        }
+
+        auto& filters = filtersIter->second;
+        auto filterIter = std::find(filters.begin(), filters.end(), filter);
+        if (filterIter == filters.end()) {
+            return false;
+        }
+
+        filters.erase(filterIter);
+        if (filters.empty()) {
+            m_subFilters.erase(filtersIter);
+        }
+
+        return removeFromNode(filter, sub);
+    }
+
+    // Invokes func(filter) for every filter left without subscribers
+    template <typename TFunc>
+    void removeAll(const TSub* sub, TFunc&& func)
+    {
+        auto filtersIter = m_subFilters.find(sub);
+        if (filtersIter == m_subFilters.end()) {
+            return;
+        }
+
+        auto filters = std::move(filtersIter->second);
+        m_subFilters.erase(filtersIter);
+        for (auto& f : filters) {
+            if (removeFromNode(f, sub)) {
+                func(f);
+            }
+        }
+    }
+
+    // Invokes func(sub, qos) for every matching subscription, the same
+    // subscriber may be reported multiple times if multiple filters match.
+    template <typename TFunc>
+    void match(const std::string& topic, TFunc&& func) const
+    {
+        m_levels.clear();
+        forEachLevel(
+            topic,
+            [this](const std::string& level)
+            {
+                m_levels.push_back(level);
+            });
+
+        matchNode(m_root, 0U, func);
+    }
+
+    // Invokes func(filter, qos) for every filter of the subscriber
+    template <typename TFunc>
+    void forEachFilter(const TSub* sub, TFunc&& func) const
+    {
+        auto filtersIter = m_subFilters.find(sub);
+        if (filtersIter == m_subFilters.end()) {
+            return;
+        }
+
+        for (auto& f : filtersIter->second) {
+            auto* node = findNode(f);
+            assert(node != nullptr);
+            auto iter = std::find_if(
+                node->m_subs.begin(), node->m_subs.end(),
+                [sub](const SubInfo& elem) -> bool
+                {
+                    return elem.first == sub;
+                });
+            assert(iter != node->m_subs.end());
+            func(f, iter->second);
+        }
+    }
+
+    // Returns true when the filter has at least one subscriber
+    bool hasSubs(const std::string& filter) const
+    {
+        auto* node = findNode(filter);
+        return (node != nullptr) && (!node->m_subs.empty());
+    }
+
+    std::size_t filtersCount() const
+    {
+        return m_filtersCount;
+    }
+
+private:
+    struct Node;
+    typedef std::unique_ptr<Node> NodePtr;
+    typedef std::pair<TSub*, QosType> SubInfo;
+    typedef std::vector<SubInfo> SubsList;
+
+    struct Node
+    {
+        std::map<std::string, NodePtr> m_children;
+        SubsList m_subs;
+    };
+
+    typedef std::vector<std::string> LevelsList;
+    typedef std::unordered_map<const TSub*, LevelsList> SubFiltersMap;
+
+    template <typename TFunc>
+    static void forEachLevel(const std::string& str, TFunc&& func)
+    {
+        std::size_t pos = 0U;
+        while (true) {
+            auto sepPos = str.find('/', pos);
+            if (sepPos == std::string::npos) {
+                func(str.substr(pos));
+                return;
+            }
+
+            func(str.substr(pos, sepPos - pos));
+            pos = sepPos + 1;
+        }
+    }
+
+    const Node* findNode(const std::string& filter) const
+    {
+        const Node* node = &m_root;
+        forEachLevel(
+            filter,
+            [&node](const std::string& level)
+            {
+                if (node == nullptr) {
+                    return;
+                }
+
+                auto iter = node->m_children.find(level);
+                if (iter == node->m_children.end()) {
+                    node = nullptr;
+                    return;
+                }
+
+                node = iter->second.get();
+            });
+        return node;
+    }
+
+    static typename SubsList::iterator findSub(Node& node, const TSub* sub)
+    {
+        return std::find_if(
+            node.m_subs.begin(), node.m_subs.end(),
+            [sub](const SubInfo& elem) -> bool
+            {
+                return elem.first == sub;
+            });
+    }
+
+    bool removeFromNode(const std::string& filter, const TSub* sub)
+    {
+        std::vector<std::pair<Node*, std::string> > path;
+        auto* node = &m_root;
+        bool found = true;
+        forEachLevel(
+            filter,
+            [&node, &path, &found](const std::string& level)
+            {
+                if (!found) {
+                    return;
+                }
+
+                auto iter = node->m_children.find(level);
+                if (iter == node->m_children.end()) {
+                    found = false;
+                    return;
+                }
+
+                path.emplace_back(node, level);
+                node = iter->second.get();
+            });
+
+        if (!found) {
+            return false;
+        }
+
+        auto iter = findSub(*node, sub);
+        if (iter == node->m_subs.end()) {
+            return false;
+        }
+
+        node->m_subs.erase(iter);
+        if (!node->m_subs.empty()) {
+            return false;
+        }
+
+        --m_filtersCount;
+
+        // Release the nodes which are not needed any more
+        while (!path.empty()) {
+            auto& parent = *path.back().first;
+            auto childIter = parent.m_children.find(path.back().second);
+            auto& child = *childIter->second;
+            if ((!child.m_subs.empty()) || (!child.m_children.empty())) {
+                break;
+            }
+
+            parent.m_children.erase(childIter);
+            path.pop_back();
+        }
+
+        return true;
+    }
+
+    template <typename TFunc>
+    void matchNode(const Node& node, std::size_t idx, TFunc& func) const
+    {
+        static const std::string SingleLevelWildcard("+");
+        static const std::string MultiLevelWildcard("#");
+
+        // Topics starting with '$' are not matched by the wildcards at the first level
+        bool wildcardsAllowed =
+            (idx != 0U) ||
+            (m_levels.empty()) ||
+            (m_levels[0].empty()) ||
+            (m_levels[0][0] != '$');
+
+        if (wildcardsAllowed) {
+            auto multiIter = node.m_children.find(MultiLevelWildcard);
+            if (multiIter != node.m_children.end()) {
+                reportSubs(*multiIter->second, func);
+            }
+        }
+
+        if (idx == m_levels.size()) {
+            reportSubs(node, func);
+            return;
+        }
+
+        if (wildcardsAllowed) {
+            auto singleIter = node.m_children.find(SingleLevelWildcard);
+            if (singleIter != node.m_children.end()) {
+                matchNode(*singleIter->second, idx + 1, func);
+            }
+        }
+
+        auto iter = node.m_children.find(m_levels[idx]);
+        if (iter != node.m_children.end()) {
+            matchNode(*iter->second, idx + 1, func);
+        }
+    }
+
+    template <typename TFunc>
+    static void reportSubs(const Node& node, TFunc& func)
+    {
+        for (auto& s : node.m_subs) {
+            func(s.first, s.second);
+        }
+    }
+
+    Node m_root;
+    SubFiltersMap m_subFilters;
+    std::size_t m_filtersCount = 0U;
+    mutable LevelsList m_levels;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,165 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Worker.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif // #ifdef __linux__
+
+#include "Mgr.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+namespace
+{
+
+const std::string UdpWorkersKey("udp_workers");
+const std::string UdpWorkerCpusKey("udp_worker_cpus");
+const unsigned MaxWorkers = 256U;
+
+}  // namespace
+
+Worker::Worker(const Config& config, unsigned idx, unsigned count)
+  : m_config(config),
+    m_idx(idx),
+    m_count(count)
+{
+}
+
+Worker::~Worker()
+{
+    quit();
+    wait();
+}
+
+bool Worker::startWorker()
+{
+    start();
+    m_startSem.acquire();
+    return m_started;
+}
+
+unsigned Worker::workersCount(const Config& config)
+{
+    auto& map = config.configMap();
+    auto iter = map.find(UdpWorkersKey);
+    if ((iter == map.end()) ||
+        (iter->second.empty())) {
+        return 1U;
+    }
+
+    try {
+        auto value = static_cast<unsigned>(std::stoul(iter->second));
+        if (value == 0U) {
+            value = QThread::idealThreadCount();
+        }
+
+        if (MaxWorkers < value) {
+            std::cerr << "WARNING: Too many workers requested, limiting to " << MaxWorkers << std::endl;
+            value = MaxWorkers;
+        }
+        return std::max(1U, value);
+    }
+    catch (...) {
+        std::cerr << "WARNING: Invalid value of \"" << UdpWorkersKey << "\" option, using single worker." << std::endl;
+    }
+
+    return 1U;
+}
+
+std::vector<int> Worker::workerCpus(const Config& config)
+{
+    std::vector<int> result;
+    auto& map = config.configMap();
+    auto iter = map.find(UdpWorkerCpusKey);
+    if (iter == map.end()) {
+        return result;
+    }
+
+    std::istringstream stream(iter->second);
+    std::string cpuStr;
+    while (stream >> cpuStr) {
+        try {
+            result.push_back(std::stoi(cpuStr));
+        }
+        catch (...) {
+            std::cerr << "WARNING: Invalid CPU number \"" << cpuStr << "\" is ignored." << std::endl;
+        }
+    }
+
+    return result;
+}
+
+bool Worker::pinCurrentThread(int cpu)
+{
+    if (cpu < 0) {
+        return true;
+    }
+
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (::pthread_setaffinity_np(::pthread_self(), sizeof(cpuSet), &cpuSet) != 0) {
+        std::cerr << "WARNING: Failed to pin worker thread to CPU " << cpu << std::endl;
+        return false;
+    }
+    return true;
+#else // #ifdef __linux__
+    std::cerr << "WARNING: Pinning worker threads to CPUs is not supported on this platform" << std::endl;
+    return false;
+#endif // #ifdef __linux__
+}
+
+void Worker::run()
+{
+    pinCurrentThread(m_cpu);
+
+    Mgr mgr(m_config, m_idx, m_count);
+    m_started = mgr.start();
+    m_startSem.release();
+    if (!m_started) {
+        return;
+    }
+
+    exec();
+}
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,80 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+
+#include "comms/CompileControl.h"
+
+CC_DISABLE_WARNINGS()
+#include <QtCore/QThread>
+#include <QtCore/QSemaphore>
+CC_ENABLE_WARNINGS()
+
+#include "mqttsn/gateway/Config.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace app
+{
+
+namespace udp
+{
+
+class Worker : public QThread
+{
+    typedef QThread Base;
+public:
+    Worker(const Config& config, unsigned idx, unsigned count);
+    ~Worker();
+
+    void setCpu(int cpu)
+    {
+        m_cpu = cpu;
+    }
+
+    bool startWorker();
+
+    static unsigned workersCount(const Config& config);
+    static std::vector<int> workerCpus(const Config& config);
+    static bool pinCurrentThread(int cpu);
+
+protected:
+    virtual void run() override;
+
+private:
+    const Config& m_config;
+    unsigned m_idx = 0U;
+    unsigned m_count = 1U;
+    int m_cpu = -1;
+    QSemaphore m_startSem;
+    bool m_started = false;
+};
+
+}  // namespace udp
+
+}  // namespace app
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -18,6 +18,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <memory>
+#include <vector>
 
 #include "comms/CompileControl.h"
 
@@ -30,6 +32,7 @@ CC_DISABLE_WARNINGS()
 CC_ENABLE_WARNINGS()
 
 #include "Mgr.h"
+#include "Worker.h"
 #include "mqttsn/gateway/Config.h"
 
 namespace
@@ -50,6 +53,17 @@ void prepareCommandLineOptions(QCommandLineParser& parser)
 
 }
 
+void prewarmConfig(const mqttsn::gateway::Config& config)
+{
+    // Config caches some parsed values on first access, make sure it is
+    // done before the object is shared between the worker threads.
+    static_cast<void>(config.predefinedTopics());
+    static_cast<void>(config.authInfos());
+    static_cast<void>(config.brokerTcpHostAddress());
+    static_cast<void>(config.brokerTcpHostPort());
+    static_cast<void>(config.topicRoutes());
+}
+
 }  // namespace
 
 int main(int argc, char *argv[])
@@ -76,7 +90,34 @@ int main(int argc, char *argv[])
         config.read(stream);
     } while (false);
 
-    mqttsn::gateway::app::udp::Mgr gw(config);
+    typedef mqttsn::gateway::app::udp::Worker Worker;
+    typedef std::unique_ptr<Worker> WorkerPtr;
+
+    prewarmConfig(config);
+    auto workersCount = Worker::workersCount(config);
+    auto cpus = Worker::workerCpus(config);
+    auto cpuFor =
+        [&cpus](unsigned idx) -> int
+        {
+            if (cpus.empty()) {
+                return -1;
+            }
+            return cpus[idx % cpus.size()];
+        };
+
+    std::vector<WorkerPtr> workers;
+    for (auto idx = 1U; idx < workersCount; ++idx) {
+        WorkerPtr worker(new Worker(config, idx, workersCount));
+        worker->setCpu(cpuFor(idx));
+        if (!worker->startWorker()) {
+            std::cerr << "Failed to start worker " << idx << "!" << std::endl;
+            return -1;
+        }
+        workers.push_back(std::move(worker));
+    }
+
+    Worker::pinCurrentThread(cpuFor(0U));
+    mqttsn::gateway::app::udp::Mgr gw(config, 0U, workersCount);
     if (!gw.start()) {
         std::cerr << "Failed to start!" << std::endl;
         return -1;
@@ -77,6 +77,31 @@ std::size_t Config::sleepingClientMsgLimit() const
     return m_pImpl->sleepingClientMsgLimit();
 }
 
+std::size_t Config::brokerPubInFlightLimit() const
+{
+    return m_pImpl->brokerPubInFlightLimit();
+}
+
+std::size_t Config::brokerPubQueueByteLimit() const
+{
+    return m_pImpl->brokerPubQueueByteLimit();
+}
+
+std::size_t Config::brokerPubQueueLowWaterMark() const
+{
+    return m_pImpl->brokerPubQueueLowWaterMark();
+}
+
+Session::BrokerPubOverflowPolicy Config::brokerPubOverflowPolicy() const
+{
+    return m_pImpl->brokerPubOverflowPolicy();
+}
+
+bool Config::sleepingClientReleaseBroker() const
+{
+    return m_pImpl->sleepingClientReleaseBroker();
+}
+
 const Config::PredefinedTopicsList& Config::predefinedTopics() const
 {
     return m_pImpl->predefinedTopics();
@@ -102,6 +127,16 @@ std::uint16_t Config::brokerTcpHostPort() const
     return m_pImpl->brokerTcpHostPort();
 }
 
+const Config::BrokersList& Config::brokers() const
+{
+    return m_pImpl->brokers();
+}
+
+const Config::TopicRoutesList& Config::topicRoutes() const
+{
+    return m_pImpl->topicRoutes();
+}
+
 
 }  // namespace gateway
 
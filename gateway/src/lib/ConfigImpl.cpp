@@ -42,10 +42,16 @@ const std::string RetryCountKey("mqttsn_retry_count");
 const std::string DefaultClientIdKey("mqttsn_default_client_id");
 const std::string PubOnlyKeepAliveKey("mqttsn_pub_only_keep_alive");
 const std::string SleepingClientMsgLimitKey("mqttsn_sleeping_client_msg_limit");
+const std::string BrokerPubInFlightLimitKey("mqttsn_broker_pub_inflight_limit");
+const std::string SleepingClientReleaseBrokerKey("mqttsn_sleeping_client_release_broker");
+const std::string BrokerPubQueueByteLimitKey("mqttsn_broker_pub_queue_byte_limit");
+const std::string BrokerPubQueueLowWaterMarkKey("mqttsn_broker_pub_queue_low_water_mark");
+const std::string BrokerPubOverflowPolicyKey("mqttsn_broker_pub_overflow_policy");
 const std::string PredefinedTopicKey("mqttsn_predefined_topic");
 const std::string AuthKey("mqttsn_auth");
 const std::string TopicIdAllocRangeKey("mqttsn_topic_id_alloc_range");
 const std::string BrokerKey("mqttsn_broker");
+const std::string TopicRouteKey("mqttsn_topic_route");
 
 const std::uint16_t DefaultAdvertise = 15 * 60;
 const unsigned DefaultRetryPeriod = 10;
@@ -150,6 +156,36 @@ std::size_t ConfigImpl::sleepingClientMsgLimit() const
     return numericValue<std::size_t>(SleepingClientMsgLimitKey, DefaultMsgLimit);
 }
 
+std::size_t ConfigImpl::brokerPubInFlightLimit() const
+{
+    return numericValue<std::size_t>(BrokerPubInFlightLimitKey, 0U);
+}
+
+std::size_t ConfigImpl::brokerPubQueueByteLimit() const
+{
+    return numericValue<std::size_t>(BrokerPubQueueByteLimitKey, 0U);
+}
+
+std::size_t ConfigImpl::brokerPubQueueLowWaterMark() const
+{
+    return numericValue<std::size_t>(BrokerPubQueueLowWaterMarkKey, brokerPubQueueByteLimit() / 2U);
+}
+
+Session::BrokerPubOverflowPolicy ConfigImpl::brokerPubOverflowPolicy() const
+{
+    auto value = numericValue<unsigned>(BrokerPubOverflowPolicyKey, 0U);
+    if (static_cast<unsigned>(Session::BrokerPubOverflowPolicy::NumOfValues) <= value) {
+        return Session::BrokerPubOverflowPolicy::Block;
+    }
+
+    return static_cast<Session::BrokerPubOverflowPolicy>(value);
+}
+
+bool ConfigImpl::sleepingClientReleaseBroker() const
+{
+    return numericValue<unsigned>(SleepingClientReleaseBrokerKey, 0U) != 0U;
+}
+
 const ConfigImpl::PredefinedTopicsList& ConfigImpl::predefinedTopics() const
 {
     if (!m_topics.empty()) {
@@ -360,22 +396,85 @@ ConfigImpl::TopicIdsRange ConfigImpl::topicIdAllocRange() const
 
 const std::string& ConfigImpl::brokerTcpHostAddress() const
 {
-    if (m_brokerAddress.empty()) {
-        readBrokerAddrInfo();
+    auto& brokersList = brokers();
+    assert(!brokersList.empty());
+    return brokersList.front().address;
+}
+
+std::uint16_t ConfigImpl::brokerTcpHostPort() const
+{
+    auto& brokersList = brokers();
+    assert(!brokersList.empty());
+    return brokersList.front().port;
+}
+
+const ConfigImpl::BrokersList& ConfigImpl::brokers() const
+{
+    if (m_brokers.empty()) {
+        readBrokersInfo();
     }
 
-    assert(!m_brokerAddress.empty());
-    return m_brokerAddress;
+    assert(!m_brokers.empty());
+    return m_brokers;
 }
 
-std::uint16_t ConfigImpl::brokerTcpHostPort() const
+const ConfigImpl::TopicRoutesList& ConfigImpl::topicRoutes() const
 {
-    if (m_brokerPort == 0) {
-        readBrokerAddrInfo();
+    if (!m_topicRoutes.empty()) {
+        return m_topicRoutes;
+    }
+
+    auto range = m_map.equal_range(TopicRouteKey);
+    if (range.first == range.second) {
+        return m_topicRoutes;
+    }
+
+    decltype(m_topicRoutes) routesList;
+    routesList.reserve(std::distance(range.first, range.second));
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        auto& valStr = iter->second;
+
+        auto firstSpacePos = valStr.find_first_of(SpaceChars);
+        if (firstSpacePos == std::string::npos) {
+            continue;
+        }
+
+        auto addressPos = valStr.find_first_not_of(SpaceChars, firstSpacePos + 1);
+        if (addressPos == std::string::npos) {
+            continue;
+        }
+
+        TopicRouteInfo info;
+        info.topicFilter.assign(valStr.begin(), valStr.begin() + firstSpacePos);
+        info.port = DefaultBrokerPort;
+
+        auto secondSpacePos = valStr.find_first_of(SpaceChars, addressPos + 1);
+        if (secondSpacePos == std::string::npos) {
+            info.address.assign(valStr.begin() + addressPos, valStr.end());
+            routesList.push_back(std::move(info));
+            continue;
+        }
+
+        info.address.assign(valStr.begin() + addressPos, valStr.begin() + secondSpacePos);
+
+        auto portPos = valStr.find_first_not_of(SpaceChars, secondSpacePos + 1);
+        if (portPos != std::string::npos) {
+            try {
+                auto port = static_cast<decltype(info.port)>(std::stoul(valStr.substr(portPos)));
+                if (port != 0U) {
+                    info.port = port;
+                }
+            }
+            catch (...) {
+                // Nothing to do
+            }
+        }
+
+        routesList.push_back(std::move(info));
     }
 
-    assert(m_brokerPort != 0);
-    return m_brokerPort;
+    m_topicRoutes.swap(routesList);
+    return m_topicRoutes;
 }
 
 const std::string& ConfigImpl::stringValue(
@@ -397,42 +496,60 @@ const std::string& ConfigImpl::stringValue(
     return stringValue(key, EmptyString);
 }
 
-void ConfigImpl::readBrokerAddrInfo() const
+void ConfigImpl::readBrokersInfo() const
 {
-    m_brokerAddress = DefaultBrokerAddress;
-    m_brokerPort = DefaultBrokerPort;
+    BrokersList brokersList;
+    auto range = m_map.equal_range(BrokerKey);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        BrokerInfo info;
+        info.address = DefaultBrokerAddress;
+        info.port = DefaultBrokerPort;
 
-    auto iter = m_map.find(BrokerKey);
-    if (iter == m_map.end()) {
-        return;
-    }
+        auto& valStr = iter->second;
+        do {
+            auto firstSpacePos = valStr.find_first_of(SpaceChars);
+            if (firstSpacePos == std::string::npos) {
+                if (!valStr.empty()) {
+                    info.address = valStr;
+                }
+                break;
+            }
 
-    auto& valStr = iter->second;
-    auto firstSpacePos = valStr.find_first_of(SpaceChars);
-    if (firstSpacePos == std::string::npos) {
-        m_brokerAddress = valStr;
-        return;
-    }
+            info.address.assign(valStr.begin(), valStr.begin() + firstSpacePos);
 
-    m_brokerAddress.assign(valStr.begin(), valStr.begin() + firstSpacePos);
+            auto portPos = valStr.find_first_not_of(SpaceChars, firstSpacePos + 1);
+            if (portPos == std::string::npos) {
+                break;
+            }
 
-    auto portPos = valStr.find_first_not_of(SpaceChars, firstSpacePos + 1);
-    if (portPos == std::string::npos) {
-        return;
-    }
+            std::string portStr(valStr.begin() + portPos, valStr.end());
+            auto secondSpacePos = valStr.find_first_of(SpaceChars, portPos + 1);
+            if (secondSpacePos != std::string::npos) {
+                portStr.assign(valStr.begin() + portPos, valStr.begin() + secondSpacePos);
+            }
 
-    std::string portStr(valStr.begin() + portPos, valStr.end());
-    auto secondSpacePos = valStr.find_first_of(SpaceChars, portPos + 1);
-    if (secondSpacePos != std::string::npos) {
-        portStr.assign(valStr.begin() + portPos, valStr.begin() + secondSpacePos);
-    }
+            try {
+                auto port = static_cast<decltype(info.port)>(std::stoul(portStr));
+                if (port != 0U) {
+                    info.port = port;
+                }
+            }
+            catch (...) {
+                // Nothing to do
+            }
+        } while (false);
 
-    try {
-        m_brokerPort = static_cast<decltype(m_brokerPort)>(std::stoul(portStr));
+        brokersList.push_back(std::move(info));
     }
-    catch (...) {
-        // Nothing to do
+
+    if (brokersList.empty()) {
+        BrokerInfo info;
+        info.address = DefaultBrokerAddress;
+        info.port = DefaultBrokerPort;
+        brokersList.push_back(std::move(info));
     }
+
+    m_brokers.swap(brokersList);
 }
 
 }  // namespace gateway
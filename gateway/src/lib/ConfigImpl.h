@@ -37,6 +37,10 @@ public:
     typedef Config::AuthInfo AuthInfo;
     typedef Config::AuthInfosList AuthInfosList;
     typedef Config::TopicIdsRange TopicIdsRange;
+    typedef Config::BrokerInfo BrokerInfo;
+    typedef Config::BrokersList BrokersList;
+    typedef Config::TopicRouteInfo TopicRouteInfo;
+    typedef Config::TopicRoutesList TopicRoutesList;
 
 
     ConfigImpl() = default;
@@ -63,6 +67,16 @@ public:
 
     std::size_t sleepingClientMsgLimit() const;
 
+    std::size_t brokerPubInFlightLimit() const;
+
+    std::size_t brokerPubQueueByteLimit() const;
+
+    std::size_t brokerPubQueueLowWaterMark() const;
+
+    Session::BrokerPubOverflowPolicy brokerPubOverflowPolicy() const;
+
+    bool sleepingClientReleaseBroker() const;
+
     const PredefinedTopicsList& predefinedTopics() const;
     const AuthInfosList& authInfos() const;
 
@@ -70,6 +84,8 @@ public:
 
     const std::string& brokerTcpHostAddress() const;
     std::uint16_t brokerTcpHostPort() const;
+    const BrokersList& brokers() const;
+    const TopicRoutesList& topicRoutes() const;
 
 private:
     template <typename T>
@@ -77,13 +93,13 @@ private:
 
     const std::string& stringValue(const std::string& key, const std::string& defaultValue) const;
     const std::string& stringValue(const std::string& key) const;
-    void readBrokerAddrInfo() const;
+    void readBrokersInfo() const;
 
     ConfigMap m_map;
     mutable PredefinedTopicsList m_topics;
     mutable AuthInfosList m_authInfos;
-    mutable std::string m_brokerAddress;
-    mutable std::uint16_t m_brokerPort = 0;
+    mutable BrokersList m_brokers;
+    mutable TopicRoutesList m_topicRoutes;
 };
 
 }  // namespace gateway
@@ -18,6 +18,9 @@
 
 #pragma once
 
+#include <tuple>
+#include <type_traits>
+
 #include "comms/comms.h"
 #include "mqttsn/protocol/AllMessages.h"
 #include "mqtt/protocol/v311/AllMessages.h"
@@ -53,6 +56,62 @@ public:
     virtual ~MsgHandler() = default;
 };
 
+template <typename TDerived, typename TBase, typename TMsgs>
+class StaticDispatchHandlerBase;
+
+template <typename TDerived, typename TBase>
+class StaticDispatchHandlerBase<TDerived, TBase, std::tuple<> > : public TBase
+{
+public:
+    using TBase::handle;
+};
+
+template <typename TDerived, typename TBase, typename TFirst, typename... TRest>
+class StaticDispatchHandlerBase<TDerived, TBase, std::tuple<TFirst, TRest...> > :
+    public StaticDispatchHandlerBase<TDerived, TBase, std::tuple<TRest...> >
+{
+    typedef StaticDispatchHandlerBase<TDerived, TBase, std::tuple<TRest...> > Base;
+public:
+    using Base::handle;
+
+    virtual void handle(TFirst& msg) override
+    {
+        static_cast<TDerived*>(this)->dispatchInput(msg);
+    }
+};
+
+// Checks whether TMsg is one of the types listed in TMsgs tuple.
+template <typename TMsg, typename TMsgs>
+struct IsMsgInList;
+
+template <typename TMsg>
+struct IsMsgInList<TMsg, std::tuple<> > : public std::false_type
+{
+};
+
+template <typename TMsg, typename TFirst, typename... TRest>
+struct IsMsgInList<TMsg, std::tuple<TFirst, TRest...> > :
+    public std::integral_constant<
+        bool,
+        std::is_same<TMsg, TFirst>::value || IsMsgInList<TMsg, std::tuple<TRest...> >::value
+    >
+{
+};
+
+// Handler which passes every received message to the dispatchInput()
+// member function of TDerived with its actual type.
+template <typename TDerived>
+using StaticDispatchHandler =
+    StaticDispatchHandlerBase<
+        TDerived,
+        StaticDispatchHandlerBase<
+            TDerived,
+            MsgHandler,
+            InputMqttsnMessages<MqttsnMessage>
+        >,
+        mqtt::protocol::v311::AllMessages<MqttMessage>
+    >;
+
 
 }  // namespace gateway
 
@@ -25,6 +25,8 @@ namespace mqttsn
 namespace gateway
 {
 
+const Session::Timestamp Session::NoDeadline;
+
 Session::Session()
   : m_pImpl(new SessionImpl)
 {
@@ -52,6 +54,16 @@ void Session::setSendDataBrokerReqCb(SendDataReqCb&& func)
     m_pImpl->setSendDataBrokerReqCb(std::move(func));
 }
 
+void Session::setSendDataRouteReqCb(SendDataRouteReqCb&& func)
+{
+    m_pImpl->setSendDataRouteReqCb(std::move(func));
+}
+
+void Session::setSendPublishBrokerReqCb(SendPublishReqCb&& func)
+{
+    m_pImpl->setSendPublishBrokerReqCb(std::move(func));
+}
+
 void Session::setTerminationReqCb(TerminationReqCb&& func)
 {
     m_pImpl->setTerminationReqCb(std::move(func));
@@ -62,6 +74,21 @@ void Session::setBrokerReconnectReqCb(BrokerReconnectReqCb&& func)
     m_pImpl->setBrokerReconnectReqCb(std::move(func));
 }
 
+void Session::setBrokerDisconnectReqCb(BrokerDisconnectReqCb&& func)
+{
+    m_pImpl->setBrokerDisconnectReqCb(std::move(func));
+}
+
+void Session::setBrokerInputPauseReqCb(BrokerInputPauseReqCb&& func)
+{
+    m_pImpl->setBrokerInputPauseReqCb(std::move(func));
+}
+
+void Session::setBrokerPubQueueReportCb(BrokerPubQueueReportCb&& func)
+{
+    m_pImpl->setBrokerPubQueueReportCb(std::move(func));
+}
+
 void Session::setClientConnectedReportCb(ClientConnectedReportCb&& func)
 {
     m_pImpl->setClientConnectedReportCb(std::move(func));
@@ -72,6 +99,26 @@ void Session::setAuthInfoReqCb(AuthInfoReqCb&& func)
     m_pImpl->setAuthInfoReqCb(std::move(func));
 }
 
+void Session::setBrokerPubReportCb(BrokerPubReportCb&& func)
+{
+    m_pImpl->setBrokerPubReportCb(std::move(func));
+}
+
+void Session::setSubscribeFanOutReqCb(SubscribeFanOutReqCb&& func)
+{
+    m_pImpl->setSubscribeFanOutReqCb(std::move(func));
+}
+
+void Session::setUnsubscribeFanOutReqCb(UnsubscribeFanOutReqCb&& func)
+{
+    m_pImpl->setUnsubscribeFanOutReqCb(std::move(func));
+}
+
+void Session::setClientPubStoreReqCb(ClientPubStoreReqCb&& func)
+{
+    m_pImpl->setClientPubStoreReqCb(std::move(func));
+}
+
 void Session::setGatewayId(std::uint8_t value)
 {
     m_pImpl->setGatewayId(value);
@@ -92,6 +139,46 @@ void Session::setSleepingClientMsgLimit(std::size_t value)
     m_pImpl->setSleepingClientMsgLimit(value);
 }
 
+void Session::setBrokerPubInFlightLimit(std::size_t value)
+{
+    m_pImpl->setBrokerPubInFlightLimit(value);
+}
+
+void Session::setBrokerPubQueueByteLimit(std::size_t limit, std::size_t lowWaterMark)
+{
+    m_pImpl->setBrokerPubQueueByteLimit(limit, lowWaterMark);
+}
+
+void Session::setBrokerPubOverflowPolicy(BrokerPubOverflowPolicy value)
+{
+    m_pImpl->setBrokerPubOverflowPolicy(value);
+}
+
+void Session::setBrokerInputHeld(bool value)
+{
+    m_pImpl->setBrokerInputHeld(value);
+}
+
+std::size_t Session::brokerPubQueueBytes() const
+{
+    return m_pImpl->brokerPubQueueBytes();
+}
+
+const std::string& Session::clientId() const
+{
+    return m_pImpl->clientId();
+}
+
+bool Session::isCleanSession() const
+{
+    return m_pImpl->isCleanSession();
+}
+
+void Session::setReleaseBrokerWhenAsleep(bool value)
+{
+    m_pImpl->setReleaseBrokerWhenAsleep(value);
+}
+
 void Session::setDefaultClientId(const std::string& value)
 {
     m_pImpl->setDefaultClientId(value);
@@ -107,6 +194,11 @@ bool Session::start()
     return m_pImpl->start();
 }
 
+bool Session::start(Timestamp now)
+{
+    return m_pImpl->start(now);
+}
+
 void Session::stop()
 {
     m_pImpl->stop();
@@ -122,21 +214,51 @@ void Session::tick()
     m_pImpl->tick();
 }
 
+void Session::tick(Timestamp now)
+{
+    m_pImpl->tick(now);
+}
+
+Session::Timestamp Session::nextDeadline() const
+{
+    return m_pImpl->nextDeadline();
+}
+
 std::size_t Session::dataFromClient(const std::uint8_t* buf, std::size_t len)
 {
     return m_pImpl->dataFromClient(buf, len);
 }
 
+std::size_t Session::dataFromClient(const std::uint8_t* buf, std::size_t len, Timestamp now)
+{
+    return m_pImpl->dataFromClient(buf, len, now);
+}
+
 std::size_t Session::dataFromBroker(const std::uint8_t* buf, std::size_t len)
 {
     return m_pImpl->dataFromBroker(buf, len);
 }
 
+std::size_t Session::dataFromBroker(const std::uint8_t* buf, std::size_t len, Timestamp now)
+{
+    return m_pImpl->dataFromBroker(buf, len, now);
+}
+
+std::size_t Session::dataFromRoute(unsigned route, const std::uint8_t* buf, std::size_t len)
+{
+    return m_pImpl->dataFromRoute(route, buf, len);
+}
+
 void Session::setBrokerConnected(bool connected)
 {
     m_pImpl->setBrokerConnected(connected);
 }
 
+void Session::setRouteConnected(unsigned route, bool connected)
+{
+    m_pImpl->setRouteConnected(route, connected);
+}
+
 bool Session::addPredefinedTopic(const std::string& topic, std::uint16_t topicId)
 {
     return m_pImpl->addPredefinedTopic(topic, topicId);
@@ -147,6 +269,16 @@ bool Session::setTopicIdAllocationRange(std::uint16_t minVal, std::uint16_t maxV
     return m_pImpl->setTopicIdAllocationRange(minVal, maxVal);
 }
 
+void Session::addBrokerPub(BrokerPubInfoPtr info)
+{
+    m_pImpl->addBrokerPub(std::move(info));
+}
+
+bool Session::addBrokerRoute(const std::string& topicFilter)
+{
+    return m_pImpl->addBrokerRoute(topicFilter);
+}
+
 }  // namespace gateway
 
 }  // namespace mqttsn
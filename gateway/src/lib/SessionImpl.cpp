@@ -22,14 +22,7 @@
 #include <algorithm>
 #include <limits>
 
-#include "session_op/Connect.h"
-#include "session_op/Disconnect.h"
-#include "session_op/Asleep.h"
-#include "session_op/AsleepMonitor.h"
-#include "session_op/PubRecv.h"
-#include "session_op/PubSend.h"
-#include "session_op/Forward.h"
-#include "session_op/WillUpdate.h"
+#include "comms/util/Tuple.h"
 
 namespace mqttsn
 {
@@ -44,6 +37,81 @@ const unsigned NoTimeout = std::numeric_limits<unsigned>::max();
 
 }  // namespace
 
+class SessionImpl::OpStarter
+{
+public:
+    explicit OpStarter(SessionImpl& session) : m_session(session) {}
+
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        op.setSession(m_session);
+        op.startImpl();
+    }
+
+private:
+    SessionImpl& m_session;
+};
+
+struct SessionImpl::OpTimestampUpdater
+{
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        if (op.tickDue()) {
+            op.tickImpl();
+        }
+    }
+};
+
+class SessionImpl::OpNextTickCalc
+{
+public:
+    explicit OpNextTickCalc(unsigned& delay) : m_delay(delay) {}
+
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        m_delay = std::min(m_delay, op.nextTick());
+    }
+
+private:
+    unsigned& m_delay;
+};
+
+struct SessionImpl::OpBrokerConnectionNotifier
+{
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        op.brokerConnectionUpdatedImpl();
+    }
+};
+
+struct SessionImpl::OpBrokerPubsNotifier
+{
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        op.brokerPubsUpdatedImpl();
+    }
+};
+
+class SessionImpl::OpRouteConnectionNotifier
+{
+public:
+    explicit OpRouteConnectionNotifier(unsigned route) : m_route(route) {}
+
+    template <typename TOp>
+    void operator()(TOp& op) const
+    {
+        op.routeConnectionUpdatedImpl(m_route);
+    }
+
+private:
+    unsigned m_route;
+};
+
 template <typename TStack>
 std::size_t SessionImpl::processInputData(const std::uint8_t* buf, std::size_t len, TStack& stack)
 {
@@ -71,6 +139,12 @@ std::size_t SessionImpl::processInputData(const std::uint8_t* buf, std::size_t l
             break;
         }
 
+        if (es == comms::ErrorStatus::MsgAllocFailure) {
+            // The only message object of the stack is still in use by
+            // the outer call, leave the rest of the data to the caller.
+            break;
+        }
+
         if (es == comms::ErrorStatus::ProtocolError) {
             ++bufTmp;
             continue;
@@ -91,12 +165,8 @@ std::size_t SessionImpl::processInputData(const std::uint8_t* buf, std::size_t l
 }
 
 template <typename TMsg, typename TStack>
-void SessionImpl::sendMessage(const TMsg& msg, TStack& stack, SendDataReqCb& func, DataBuf& buf)
+std::size_t SessionImpl::writeMessage(const TMsg& msg, TStack& stack, DataBuf& buf)
 {
-    if (!func) {
-        return;
-    }
-
     typedef typename TStack::MsgPtr::element_type MsgType;
 
     buf.resize(std::max(buf.size(), stack.length(msg)));
@@ -104,57 +174,38 @@ void SessionImpl::sendMessage(const TMsg& msg, TStack& stack, SendDataReqCb& fun
     auto es = stack.write(msg, iter, buf.size());
     static_cast<void>(es);
     assert(es == comms::ErrorStatus::Success);
-    auto writtenCount =
+    return
         static_cast<std::size_t>(
             std::distance(comms::writeIteratorFor<MsgType>(&buf[0]), iter));
-
-    func(&buf[0], writtenCount);
 }
 
-template <typename TMsg>
-void SessionImpl::dispatchToOpsCommon(TMsg& msg)
+template <typename TMsg, typename TStack>
+void SessionImpl::sendMessage(const TMsg& msg, TStack& stack, SendDataReqCb& func, DataBuf& buf)
 {
-    for (auto& op : m_ops) {
-        msg.dispatch(*op);
+    if (!func) {
+        return;
     }
+
+    auto writtenCount = writeMessage(msg, stack, buf);
+    func(&buf[0], writtenCount);
 }
 
 SessionImpl::SessionImpl()
+  : m_ops(
+        // Every operation is constructed in place with reference to the state
+        m_state, m_state, m_state, m_state, m_state,
+        m_state, m_state, m_state, m_state, m_state)
 {
-    std::unique_ptr<session_op::Connect> connectOp(new session_op::Connect(m_state));
-    connectOp->setClientConnectedReportCb(
-        [this](const std::string& clientId)
-        {
-            if (m_clientConnectedCb) {
-                m_clientConnectedCb(clientId);
-            }
-        });
-    connectOp->setAuthInfoReqCb(
-        [this](const std::string& clientId) -> AuthInfo
-        {
-            if (!m_authInfoReqCb) {
-                return AuthInfo();
-            }
-
-            return m_authInfoReqCb(clientId);
-        });
-
-    m_ops.push_back(std::move(connectOp));
-    m_ops.emplace_back(new session_op::Disconnect(m_state));
-    m_ops.emplace_back(new session_op::Asleep(m_state));
-    m_ops.emplace_back(new session_op::AsleepMonitor(m_state));
-    m_ops.emplace_back(new session_op::PubRecv(m_state));
-    m_ops.emplace_back(new session_op::PubSend(m_state));
-    m_ops.emplace_back(new session_op::Forward(m_state));
-    m_ops.emplace_back(new session_op::WillUpdate(m_state));
-
-    for (auto& op : m_ops) {
-        startOp(*op);
-    }
+    comms::util::tupleForEach(m_ops, OpStarter(*this));
 }
 
 void SessionImpl::tick()
 {
+    if (m_deadlineMode) {
+        tick(m_now + m_state.m_tickReq);
+        return;
+    }
+
     if ((!isRunning()) || m_state.m_terminating) {
         return;
     }
@@ -166,13 +217,73 @@ void SessionImpl::tick()
     updateOps();
 }
 
+void SessionImpl::tick(Timestamp now)
+{
+    if (!m_deadlineMode) {
+        tick();
+        return;
+    }
+
+    if ((!isRunning()) || m_state.m_terminating) {
+        return;
+    }
+
+    advanceTime(now);
+    auto guard = apiCall();
+}
+
+Timestamp SessionImpl::nextDeadline() const
+{
+    if ((!m_deadlineMode) ||
+        (!isRunning()) ||
+        (m_state.m_tickReq == 0U)) {
+        return Session::NoDeadline;
+    }
+
+    return m_now + m_state.m_tickReq;
+}
+
 std::size_t SessionImpl::dataFromClient(const std::uint8_t* buf, std::size_t len)
 {
     return processInputData(buf, len, m_mqttsnStack);
 }
 
+std::size_t SessionImpl::dataFromClient(const std::uint8_t* buf, std::size_t len, Timestamp now)
+{
+    advanceTime(now);
+    return dataFromClient(buf, len);
+}
+
 std::size_t SessionImpl::dataFromBroker(const std::uint8_t* buf, std::size_t len)
 {
+    auto consumed = processInputData(buf, len, m_mqttStack);
+    if (consumed != 0U) {
+        m_state.m_lastBrokerRecvTimestamp = m_state.m_timestamp;
+    }
+    return consumed;
+}
+
+std::size_t SessionImpl::dataFromBroker(const std::uint8_t* buf, std::size_t len, Timestamp now)
+{
+    advanceTime(now);
+    return dataFromBroker(buf, len);
+}
+
+std::size_t SessionImpl::dataFromRoute(unsigned route, const std::uint8_t* buf, std::size_t len)
+{
+    if (m_state.m_routes.size() <= route) {
+        return 0U;
+    }
+
+    assert(m_routeInput == NoRouteInput);
+    m_routeInput = route;
+    auto routeInputGuard =
+        comms::util::makeScopeGuard(
+            [this]()
+            {
+                m_routeInput = NoRouteInput;
+            });
+
     return processInputData(buf, len, m_mqttStack);
 }
 
@@ -188,9 +299,7 @@ void SessionImpl::setBrokerConnected(bool connected)
     }
 
     m_state.m_brokerConnected = connected;
-    for (auto& op : m_ops) {
-        op->brokerConnectionUpdated();
-    }
+    comms::util::tupleForEach(m_ops, OpBrokerConnectionNotifier());
 }
 
 bool SessionImpl::addPredefinedTopic(const std::string& topic, std::uint16_t topicId)
@@ -203,6 +312,44 @@ bool SessionImpl::setTopicIdAllocationRange(std::uint16_t minVal, std::uint16_t
     return m_state.m_regMgr.setTopicIdAllocationRange(minVal, maxVal);
 }
 
+void SessionImpl::addBrokerPub(PubInfoPtr info)
+{
+    if ((!isRunning()) || m_state.m_terminating || (!info)) {
+        return;
+    }
+
+    auto guard = apiCall();
+    pushBrokerPub(m_state, std::move(info));
+    comms::util::tupleForEach(m_ops, OpBrokerPubsNotifier());
+}
+
+bool SessionImpl::addBrokerRoute(const std::string& topicFilter)
+{
+    if (topicFilter.empty()) {
+        return false;
+    }
+
+    BrokerRoute info;
+    info.m_topicFilter = topicFilter;
+    m_state.m_routes.push_back(std::move(info));
+    return true;
+}
+
+void SessionImpl::setRouteConnected(unsigned route, bool connected)
+{
+    if ((!isRunning()) ||
+        (m_state.m_routes.size() <= route) ||
+        (m_state.m_routes[route].m_connected == connected)) {
+        return;
+    }
+
+    auto guard = apiCall();
+    auto& info = m_state.m_routes[route];
+    info.m_connected = connected;
+    info.m_ready = false;
+    comms::util::tupleForEach(m_ops, OpRouteConnectionNotifier(route));
+}
+
 void SessionImpl::handle(SearchgwMsg_SN& msg)
 {
     static_cast<void>(msg);
@@ -211,10 +358,6 @@ void SessionImpl::handle(SearchgwMsg_SN& msg)
     auto& gwIdField = std::get<decltype(respMsg)::FieldIdx_gwId>(fields);
     gwIdField.value() = m_state.m_gwId;
     sendToClient(respMsg);
-
-    if (m_state.m_connStatus != ConnectionStatus::Disconnected) {
-        sendToBroker(PingreqMsg());
-    }
 }
 
 void SessionImpl::handle(RegisterMsg_SN& msg)
@@ -240,18 +383,31 @@ void SessionImpl::handle(RegisterMsg_SN& msg)
         respRetCodeField.value() = mqttsn::protocol::field::ReturnCodeVal_NotSupported;
     }
     sendToClient(respMsg);
+}
 
-    if (m_state.m_connStatus != ConnectionStatus::Disconnected) {
-        sendToBroker(PingreqMsg());
+void SessionImpl::handle(ConnackMsg& msg)
+{
+    if (m_routeInput != NoRouteInput) {
+        routeOp().routeConnack(m_routeInput, msg);
+        return;
     }
+
+    dispatchToOps(msg);
+}
+
+void SessionImpl::handle(PubackMsg& msg)
+{
+    // Acknowledgements of the routed publishes are processed the
+    // same way as the ones received from the broker.
+    dispatchToOps(msg);
 }
 
-void SessionImpl::handle(MqttsnMessage& msg)
+void SessionImpl::handle(PubrecMsg& msg)
 {
     dispatchToOps(msg);
 }
 
-void SessionImpl::handle(MqttMessage& msg)
+void SessionImpl::handle(PubcompMsg& msg)
 {
     dispatchToOps(msg);
 }
@@ -263,46 +419,186 @@ void SessionImpl::sendToClient(const MqttsnMessage& msg)
 
 void SessionImpl::sendToBroker(const MqttMessage& msg)
 {
+    m_state.m_lastBrokerSendTimestamp = m_state.m_timestamp;
     sendMessage(msg, m_mqttStack, m_sendToBrokerCb, m_mqttMsgData);
 }
 
-void SessionImpl::startOp(SessionOp& op)
+void SessionImpl::sendToRoute(unsigned route, const MqttMessage& msg)
+{
+    if (!m_sendToRouteCb) {
+        return;
+    }
+
+    assert(route < m_state.m_routes.size());
+    m_state.m_routes[route].m_lastSend = m_state.m_timestamp;
+    auto writtenCount = writeMessage(msg, m_mqttStack, m_mqttMsgData);
+    m_sendToRouteCb(route, &m_mqttMsgData[0], writtenCount);
+}
+
+bool SessionImpl::sendPublishToBroker(
+    const std::string& topic,
+    std::uint16_t packetId,
+    QoS qos,
+    bool retain,
+    bool dup,
+    const std::uint8_t* payload,
+    std::size_t payloadLen)
+{
+    if (!m_sendPublishToBrokerCb) {
+        return false;
+    }
+
+    m_state.m_lastBrokerSendTimestamp = m_state.m_timestamp;
+
+    // Serialise everything but the payload, the latter is passed as is
+    static const std::uint8_t PublishType = 3U;
+    std::uint8_t flags =
+        static_cast<std::uint8_t>(
+            (PublishType << 4) |
+            (static_cast<unsigned>(dup) << 3) |
+            (static_cast<unsigned>(qos) << 1) |
+            static_cast<unsigned>(retain));
+
+    auto remLen = 2U + topic.size() + payloadLen;
+    if (qos != QoS_AtMostOnceDelivery) {
+        remLen += 2U;
+    }
+
+    auto& buf = m_mqttPubHeaderData;
+    buf.clear();
+    buf.push_back(flags);
+    do {
+        auto byte = static_cast<std::uint8_t>(remLen & 0x7f);
+        remLen >>= 7;
+        if (remLen != 0U) {
+            byte |= 0x80;
+        }
+        buf.push_back(byte);
+    } while (remLen != 0U);
+
+    buf.push_back(static_cast<std::uint8_t>(topic.size() >> 8));
+    buf.push_back(static_cast<std::uint8_t>(topic.size()));
+    buf.insert(buf.end(), topic.begin(), topic.end());
+    if (qos != QoS_AtMostOnceDelivery) {
+        buf.push_back(static_cast<std::uint8_t>(packetId >> 8));
+        buf.push_back(static_cast<std::uint8_t>(packetId));
+    }
+
+    m_sendPublishToBrokerCb(&buf[0], buf.size(), payload, payloadLen);
+    return true;
+}
+
+void SessionImpl::termRequest()
+{
+    if ((!m_termReqCb) || (m_state.m_terminating)) {
+        return;
+    }
+
+    m_state.m_terminating = true;
+}
+
+void SessionImpl::brokerReconnectRequest()
+{
+    if ((!m_brokerReconnectReqCb) ||
+        (m_state.m_reconnectingBroker) ||
+        (m_state.m_terminating)) {
+        return;
+    }
+
+    m_state.m_reconnectingBroker = true;
+    m_brokerReconnectReqCb();
+}
+
+void SessionImpl::brokerDisconnectRequest()
+{
+    if ((!m_brokerDisconnectReqCb) ||
+        (m_state.m_terminating)) {
+        return;
+    }
+
+    m_brokerDisconnectReqCb();
+}
+
+void SessionImpl::clientConnectedReport(const std::string& clientId)
+{
+    if (m_clientConnectedCb) {
+        m_clientConnectedCb(clientId);
+    }
+}
+
+SessionImpl::AuthInfo SessionImpl::authInfoRequest(const std::string& clientId)
+{
+    if (!m_authInfoReqCb) {
+        return AuthInfo();
+    }
+
+    return m_authInfoReqCb(clientId);
+}
+
+bool SessionImpl::brokerPubReport(const PubInfoPtr& info)
 {
-    op.setSendToClientCb(std::bind(&SessionImpl::sendToClient, this, std::placeholders::_1));
-    op.setSendToBrokerCb(std::bind(&SessionImpl::sendToBroker, this, std::placeholders::_1));
-    op.setSessionTermReqCb(
-        [this]()
-        {
-            if ((!m_termReqCb) || (m_state.m_terminating)) {
-                return;
-            }
+    if (!m_brokerPubReportCb) {
+        return false;
+    }
 
-            m_state.m_terminating = true;
-        });
+    m_brokerPubReportCb(info);
+    return true;
+}
 
-    op.setBrokerReconnectReqCb(
-        [this]()
-        {
-            if ((!m_brokerReconnectReqCb) ||
-                (m_state.m_reconnectingBroker) ||
-                (m_state.m_terminating)) {
-                return;
-            }
+bool SessionImpl::subscribeFanOutRequest(const std::string& topic, std::uint8_t qos)
+{
+    if (!m_subscribeFanOutReqCb) {
+        return false;
+    }
 
-            m_state.m_reconnectingBroker = true;
-            m_brokerReconnectReqCb();
-        });
-    op.start();
+    return m_subscribeFanOutReqCb(topic, qos);
 }
 
-void SessionImpl::dispatchToOps(MqttsnMessage& msg)
+bool SessionImpl::unsubscribeFanOutRequest(const std::string& topic)
 {
-    dispatchToOpsCommon(msg);
+    if (!m_unsubscribeFanOutReqCb) {
+        return false;
+    }
+
+    return m_unsubscribeFanOutReqCb(topic);
 }
 
-void SessionImpl::dispatchToOps(MqttMessage& msg)
+bool SessionImpl::clientPubStoreRequest(
+    const std::string& topic,
+    const std::uint8_t* buf,
+    std::size_t bufLen,
+    std::uint8_t qos,
+    bool retain)
 {
-    dispatchToOpsCommon(msg);
+    if (!m_clientPubStoreReqCb) {
+        return false;
+    }
+
+    return m_clientPubStoreReqCb(topic, buf, bufLen, qos, retain);
+}
+
+bool SessionImpl::startInternal(bool deadlineMode)
+{
+    if ((m_state.m_running) ||
+        (!m_sendToClientCb) ||
+        (!m_sendToBrokerCb) ||
+        (!m_termReqCb) ||
+        (!m_brokerReconnectReqCb)) {
+        return false;
+    }
+
+    if (!m_brokerDisconnectReqCb) {
+        m_state.m_releaseBrokerWhenAsleep = false;
+    }
+
+    if (m_deadlineMode != deadlineMode) {
+        // The time measurement of the other mode is not running
+        m_state.m_tickReq = 0U;
+        m_deadlineMode = deadlineMode;
+    }
+
+    m_state.m_running = true;
+    return true;
 }
 
 void SessionImpl::programNextTimeout()
@@ -313,16 +609,16 @@ void SessionImpl::programNextTimeout()
 
     assert(m_state.m_tickReq == 0U);
     unsigned delay = NoTimeout;
-    for (auto& op : m_ops) {
-        delay = std::min(delay, op->nextTick());
-    }
+    comms::util::tupleForEach(m_ops, OpNextTickCalc(delay));
 
     if (delay == NoTimeout) {
         return;
     }
 
-    GASSERT(m_nextTickProgramCb != nullptr);
-    m_nextTickProgramCb(delay);
+    if (!m_deadlineMode) {
+        GASSERT(m_nextTickProgramCb != nullptr);
+        m_nextTickProgramCb(delay);
+    }
     m_state.m_tickReq = delay;
 }
 
@@ -332,19 +628,44 @@ void SessionImpl::updateTimestamp()
         return;
     }
 
-    GASSERT(m_cancelTickCb);
-    m_state.m_timestamp += m_cancelTickCb();
+    // In deadline mode the time has already been advanced
+    // by advanceTime().
+    if (!m_deadlineMode) {
+        GASSERT(m_cancelTickCb);
+        m_state.m_timestamp += m_cancelTickCb();
+    }
+
     m_state.m_tickReq = 0U;
     updateOps();
 }
 
-void SessionImpl::updateOps()
+void SessionImpl::advanceTime(Timestamp now)
+{
+    // The time is taken only at the entry to the API, the clock
+    // is expected to be monotonic.
+    if ((!m_deadlineMode) ||
+        (m_state.m_callStackCount != 0U) ||
+        (now <= m_now)) {
+        return;
+    }
+
+    m_state.m_timestamp += (now - m_now);
+    m_now = now;
+}
+
+void SessionImpl::setBrokerInputHeld(bool value)
 {
-    for (auto& op : m_ops) {
-        op->timestampUpdated();
+    m_state.m_brokerInputHeld = value;
+    if (m_state.m_callStackCount == 0U) {
+        updateBrokerInput();
     }
 }
 
+void SessionImpl::updateOps()
+{
+    comms::util::tupleForEach(m_ops, OpTimestampUpdater());
+}
+
 void SessionImpl::apiCallExit()
 {
     GASSERT(0U < m_state.m_callStackCount);
@@ -357,10 +678,57 @@ void SessionImpl::apiCallExit()
     }
 
     if (m_state.m_callStackCount == 0U) {
+        updateBrokerInput();
         programNextTimeout();
     }
 }
 
+void SessionImpl::updateBrokerInput()
+{
+    auto& st = m_state;
+    if ((m_reportedBrokerPubsBytes != st.m_brokerPubsBytes) && m_brokerPubQueueReportCb) {
+        m_reportedBrokerPubsBytes = st.m_brokerPubsBytes;
+        m_brokerPubQueueReportCb(st.m_brokerPubsBytes);
+    }
+
+    if (!m_brokerInputPauseReqCb) {
+        return;
+    }
+
+    // The broker input may be paused only when nothing but the messages
+    // published to the client is expected from the broker, otherwise
+    // the session may wait forever for the broker's responses.
+    bool canPause =
+        (st.m_brokerPubsOverflowPolicy == BrokerPubOverflowPolicy::Block) &&
+        st.m_brokerConnected &&
+        (!st.m_brokerReleased) &&
+        (st.m_connStatus != ConnectionStatus::Disconnected);
+
+    bool paused = st.m_brokerInputPaused;
+    if (!canPause) {
+        paused = false;
+    }
+    else if (!paused) {
+        paused =
+            st.m_brokerInputHeld ||
+            (st.m_sleepPubAccLimit <= st.m_brokerPubs.size()) ||
+            (st.m_brokerPubsByteLimit <= st.m_brokerPubsBytes);
+    }
+    else {
+        paused =
+            st.m_brokerInputHeld ||
+            (st.m_sleepPubAccLimit <= st.m_brokerPubs.size()) ||
+            (st.m_brokerPubsLowWaterMark < st.m_brokerPubsBytes);
+    }
+
+    if (paused == st.m_brokerInputPaused) {
+        return;
+    }
+
+    st.m_brokerInputPaused = paused;
+    m_brokerInputPauseReqCb(paused);
+}
+
 #ifdef _MSC_VER
 // VS compiler
 auto SessionImpl::apiCall() -> decltype(comms::util::makeScopeGuard(std::declval<ApiCallGuard>()))
@@ -23,12 +23,24 @@
 #include <list>
 #include <algorithm>
 #include <limits>
+#include <tuple>
+#include <type_traits>
 
 #include "mqttsn/gateway/Session.h"
 #include "MsgHandler.h"
 #include "SessionOp.h"
 #include "common.h"
 #include "comms/util/ScopeGuard.h"
+#include "session_op/Connect.h"
+#include "session_op/Disconnect.h"
+#include "session_op/Asleep.h"
+#include "session_op/AsleepMonitor.h"
+#include "session_op/PubRecv.h"
+#include "session_op/PubSend.h"
+#include "session_op/Forward.h"
+#include "session_op/WillUpdate.h"
+#include "session_op/Route.h"
+#include "session_op/KeepAlive.h"
 
 namespace mqttsn
 {
@@ -36,19 +48,32 @@ namespace mqttsn
 namespace gateway
 {
 
-class SessionImpl : public MsgHandler
+class SessionImpl : public StaticDispatchHandler<SessionImpl>
 {
-    typedef MsgHandler Base;
+    typedef StaticDispatchHandler<SessionImpl> Base;
+    friend class SessionOp;
+    template <typename, typename, typename> friend class StaticDispatchHandlerBase;
+
 public:
     typedef Session::AuthInfo AuthInfo;
 
     typedef Session::NextTickProgramReqCb NextTickProgramReqCb;
     typedef Session::SendDataReqCb SendDataReqCb;
+    typedef Session::SendDataRouteReqCb SendDataRouteReqCb;
+    typedef Session::SendPublishReqCb SendPublishReqCb;
     typedef Session::CancelTickWaitReqCb CancelTickWaitReqCb;
     typedef Session::TerminationReqCb TerminationReqCb;
     typedef Session::BrokerReconnectReqCb BrokerReconnectReqCb;
+    typedef Session::BrokerDisconnectReqCb BrokerDisconnectReqCb;
+    typedef Session::BrokerInputPauseReqCb BrokerInputPauseReqCb;
+    typedef Session::BrokerPubQueueReportCb BrokerPubQueueReportCb;
+    typedef Session::BrokerPubOverflowPolicy BrokerPubOverflowPolicy;
     typedef Session::ClientConnectedReportCb ClientConnectedReportCb;
     typedef Session::AuthInfoReqCb AuthInfoReqCb;
+    typedef Session::BrokerPubReportCb BrokerPubReportCb;
+    typedef Session::SubscribeFanOutReqCb SubscribeFanOutReqCb;
+    typedef Session::UnsubscribeFanOutReqCb UnsubscribeFanOutReqCb;
+    typedef Session::ClientPubStoreReqCb ClientPubStoreReqCb;
 
     SessionImpl();
     ~SessionImpl() = default;
@@ -78,6 +103,18 @@ public:
         m_sendToBrokerCb = std::forward<TFunc>(func);
     }
 
+    template <typename TFunc>
+    void setSendDataRouteReqCb(TFunc&& func)
+    {
+        m_sendToRouteCb = std::forward<TFunc>(func);
+    }
+
+    template <typename TFunc>
+    void setSendPublishBrokerReqCb(TFunc&& func)
+    {
+        m_sendPublishToBrokerCb = std::forward<TFunc>(func);
+    }
+
     template <typename TFunc>
     void setTerminationReqCb(TFunc&& func)
     {
@@ -90,6 +127,25 @@ public:
         m_brokerReconnectReqCb = std::forward<TFunc>(func);
     }
 
+    template <typename TFunc>
+    void setBrokerDisconnectReqCb(TFunc&& func)
+    {
+        m_brokerDisconnectReqCb = std::forward<TFunc>(func);
+    }
+
+    template <typename TFunc>
+    void setBrokerInputPauseReqCb(TFunc&& func)
+    {
+        m_brokerInputPauseReqCb = std::forward<TFunc>(func);
+        m_state.m_brokerInputPauseSupported = static_cast<bool>(m_brokerInputPauseReqCb);
+    }
+
+    template <typename TFunc>
+    void setBrokerPubQueueReportCb(TFunc&& func)
+    {
+        m_brokerPubQueueReportCb = std::forward<TFunc>(func);
+    }
+
     template <typename TFunc>
     void setClientConnectedReportCb(TFunc&& func)
     {
@@ -102,6 +158,30 @@ public:
         m_authInfoReqCb = std::forward<TFunc>(func);
     }
 
+    template  <typename TFunc>
+    void setBrokerPubReportCb(TFunc&& func)
+    {
+        m_brokerPubReportCb = std::forward<TFunc>(func);
+    }
+
+    template  <typename TFunc>
+    void setSubscribeFanOutReqCb(TFunc&& func)
+    {
+        m_subscribeFanOutReqCb = std::forward<TFunc>(func);
+    }
+
+    template  <typename TFunc>
+    void setUnsubscribeFanOutReqCb(TFunc&& func)
+    {
+        m_unsubscribeFanOutReqCb = std::forward<TFunc>(func);
+    }
+
+    template  <typename TFunc>
+    void setClientPubStoreReqCb(TFunc&& func)
+    {
+        m_clientPubStoreReqCb = std::forward<TFunc>(func);
+    }
+
     void setGatewayId(std::uint8_t value)
     {
         m_state.m_gwId = value;
@@ -122,6 +202,43 @@ public:
         m_state.m_sleepPubAccLimit = std::min(m_state.m_brokerPubs.max_size(), value);
     }
 
+    void setBrokerPubInFlightLimit(std::size_t value)
+    {
+        if (value == 0U) {
+            value = std::numeric_limits<std::size_t>::max();
+        }
+        m_state.m_brokerPubInFlightLimit = value;
+    }
+
+    void setBrokerPubQueueByteLimit(std::size_t limit, std::size_t lowWaterMark)
+    {
+        if (limit == 0U) {
+            limit = std::numeric_limits<std::size_t>::max();
+        }
+        m_state.m_brokerPubsByteLimit = limit;
+        m_state.m_brokerPubsLowWaterMark = std::min(limit - 1, lowWaterMark);
+    }
+
+    void setBrokerPubOverflowPolicy(BrokerPubOverflowPolicy value)
+    {
+        if (BrokerPubOverflowPolicy::NumOfValues <= value) {
+            return;
+        }
+        m_state.m_brokerPubsOverflowPolicy = value;
+    }
+
+    void setBrokerInputHeld(bool value);
+
+    std::size_t brokerPubQueueBytes() const
+    {
+        return m_state.m_brokerPubsBytes;
+    }
+
+    void setReleaseBrokerWhenAsleep(bool value)
+    {
+        m_state.m_releaseBrokerWhenAsleep = value;
+    }
+
     void setDefaultClientId(const std::string& value)
     {
         m_state.m_defaultClientId = value;
@@ -134,17 +251,21 @@ public:
 
     bool start()
     {
-        if ((m_state.m_running) ||
-            (!m_nextTickProgramCb) ||
-            (!m_cancelTickCb) ||
-            (!m_sendToClientCb) ||
-            (!m_sendToBrokerCb) ||
-            (!m_termReqCb) ||
-            (!m_brokerReconnectReqCb)) {
+        if ((!m_nextTickProgramCb) ||
+            (!m_cancelTickCb)) {
+            return false;
+        }
+
+        return startInternal(false);
+    }
+
+    bool start(Timestamp now)
+    {
+        if (!startInternal(true)) {
             return false;
         }
 
-        m_state.m_running = true;
+        m_now = now;
         return true;
     }
 
@@ -158,44 +279,202 @@ public:
         return m_state.m_running;
     }
 
+    const std::string& clientId() const
+    {
+        return m_state.m_clientId;
+    }
+
+    bool isCleanSession() const
+    {
+        return m_state.m_cleanSession;
+    }
+
     void tick();
+    void tick(Timestamp now);
+    Timestamp nextDeadline() const;
 
     std::size_t dataFromClient(const std::uint8_t* buf, std::size_t len);
+    std::size_t dataFromClient(const std::uint8_t* buf, std::size_t len, Timestamp now);
     std::size_t dataFromBroker(const std::uint8_t* buf, std::size_t len);
+    std::size_t dataFromBroker(const std::uint8_t* buf, std::size_t len, Timestamp now);
+    std::size_t dataFromRoute(unsigned route, const std::uint8_t* buf, std::size_t len);
 
     void setBrokerConnected(bool connected);
     bool addPredefinedTopic(const std::string& topic, std::uint16_t topicId);
     bool setTopicIdAllocationRange(std::uint16_t minVal, std::uint16_t maxVal);
+    void addBrokerPub(PubInfoPtr info);
+    bool addBrokerRoute(const std::string& topicFilter);
+    void setRouteConnected(unsigned route, bool connected);
 
 private:
 
-    typedef std::vector<SessionOpPtr> OpsList;
+    // The order defines the order in which the operations
+    // receive the messages and events.
+    typedef std::tuple<
+        session_op::Connect,
+        session_op::Disconnect,
+        session_op::Asleep,
+        session_op::AsleepMonitor,
+        session_op::PubRecv,
+        session_op::PubSend,
+        session_op::Forward,
+        session_op::WillUpdate,
+        session_op::Route,
+        session_op::KeepAlive
+    > OpsList;
+
+    enum OpIdx
+    {
+        OpIdx_Connect,
+        OpIdx_Disconnect,
+        OpIdx_Asleep,
+        OpIdx_AsleepMonitor,
+        OpIdx_PubRecv,
+        OpIdx_PubSend,
+        OpIdx_Forward,
+        OpIdx_WillUpdate,
+        OpIdx_Route,
+        OpIdx_KeepAlive,
+        OpIdx_NumOfValues
+    };
+
+    static_assert(
+        std::tuple_size<OpsList>::value == OpIdx_NumOfValues,
+        "Operation indices must match the operations list");
+
+    // The handlers and hooks of the operations are invoked on their actual
+    // type, a virtual function in any of them is a regression.
+    static_assert(
+        HasNoPolymorphicTypes<OpsList>::value,
+        "The operations must not have virtual functions");
+
+    static const unsigned NoRouteInput = std::numeric_limits<unsigned>::max();
 
     using Base::handle;
     virtual void handle(SearchgwMsg_SN& msg) override;
     virtual void handle(RegisterMsg_SN& msg) override;
-    virtual void handle(MqttsnMessage& msg) override;
 
-    virtual void handle(MqttMessage& msg) override;
+    virtual void handle(ConnackMsg& msg) override;
+    virtual void handle(PubackMsg& msg) override;
+    virtual void handle(PubrecMsg& msg) override;
+    virtual void handle(PubcompMsg& msg) override;
+
+    template <typename TMsg>
+    void dispatchInput(TMsg& msg)
+    {
+        if (m_routeInput != NoRouteInput) {
+            // Nothing else is expected from the route connection
+            return;
+        }
+
+        dispatchToOps(msg);
+    }
+
+    template <typename TMsg>
+    void dispatchToOps(TMsg& msg)
+    {
+        dispatchToOpsFrom<0U>(msg);
+    }
+
+    template <std::size_t TIdx, typename TMsg>
+    typename std::enable_if<(TIdx < std::tuple_size<OpsList>::value)>::type
+    dispatchToOpsFrom(TMsg& msg)
+    {
+        typedef typename std::tuple_element<TIdx, OpsList>::type OpType;
+        typedef IsMsgInList<TMsg, typename OpType::HandledMsgs> HandledTag;
+
+        // Resolved at compile time, the operation receives only the
+        // messages it handles or the notification it reacts to.
+        routeToOp(std::get<TIdx>(m_ops), msg, HandledTag());
+        dispatchToOpsFrom<TIdx + 1>(msg);
+    }
+
+    template <std::size_t TIdx, typename TMsg>
+    typename std::enable_if<(std::tuple_size<OpsList>::value <= TIdx)>::type
+    dispatchToOpsFrom(TMsg& msg)
+    {
+        static_cast<void>(msg);
+    }
+
+    template <typename TOp, typename TMsg>
+    static void routeToOp(TOp& op, TMsg& msg, std::true_type)
+    {
+        op.handle(msg);
+    }
+
+    template <typename TOp, typename TMsg>
+    static void routeToOp(TOp& op, TMsg& msg, std::false_type)
+    {
+        notifyOp(op, msg);
+    }
+
+    // The operations are final, the calls below are not virtual.
+    template <typename TOp>
+    static void notifyOp(TOp& op, MqttsnMessage&)
+    {
+        op.clientMsgReceivedImpl();
+    }
+
+    template <typename TOp>
+    static void notifyOp(TOp& op, MqttMessage&)
+    {
+        op.brokerMsgReceivedImpl();
+    }
+
+    // Invoke the hooks of every operation on its actual type
+    class OpStarter;
+    struct OpTimestampUpdater;
+    class OpNextTickCalc;
+    struct OpBrokerConnectionNotifier;
+    struct OpBrokerPubsNotifier;
+    class OpRouteConnectionNotifier;
+
+    session_op::Route& routeOp()
+    {
+        return std::get<OpIdx_Route>(m_ops);
+    }
 
     template <typename TStack>
     std::size_t processInputData(const std::uint8_t* buf, std::size_t len, TStack& stack);
 
     template <typename TMsg, typename TStack>
-    void sendMessage(const TMsg& msg, TStack& stack, SendDataReqCb& func, DataBuf& buf);
+    std::size_t writeMessage(const TMsg& msg, TStack& stack, DataBuf& buf);
 
-    template <typename TMsg>
-    void dispatchToOpsCommon(TMsg& msg);
+    template <typename TMsg, typename TStack>
+    void sendMessage(const TMsg& msg, TStack& stack, SendDataReqCb& func, DataBuf& buf);
 
     void sendToClient(const MqttsnMessage& msg);
     void sendToBroker(const MqttMessage& msg);
-    void startOp(SessionOp& op);
-    void dispatchToOps(MqttsnMessage& msg);
-    void dispatchToOps(MqttMessage& msg);
+    void sendToRoute(unsigned route, const MqttMessage& msg);
+    bool sendPublishToBroker(
+        const std::string& topic,
+        std::uint16_t packetId,
+        QoS qos,
+        bool retain,
+        bool dup,
+        const std::uint8_t* payload,
+        std::size_t payloadLen);
+    void termRequest();
+    void brokerReconnectRequest();
+    void brokerDisconnectRequest();
+    void clientConnectedReport(const std::string& clientId);
+    AuthInfo authInfoRequest(const std::string& clientId);
+    bool brokerPubReport(const PubInfoPtr& info);
+    bool subscribeFanOutRequest(const std::string& topic, std::uint8_t qos);
+    bool unsubscribeFanOutRequest(const std::string& topic);
+    bool clientPubStoreRequest(
+        const std::string& topic,
+        const std::uint8_t* buf,
+        std::size_t bufLen,
+        std::uint8_t qos,
+        bool retain);
+    bool startInternal(bool deadlineMode);
     void programNextTimeout();
     void updateTimestamp();
+    void advanceTime(Timestamp now);
     void updateOps();
     void apiCallExit();
+    void updateBrokerInput();
 
 #ifdef _MSC_VER
     typedef std::function<void ()> ApiCallGuard;
@@ -208,20 +487,34 @@ private:
     CancelTickWaitReqCb m_cancelTickCb;
     SendDataReqCb m_sendToClientCb;
     SendDataReqCb m_sendToBrokerCb;
+    SendDataRouteReqCb m_sendToRouteCb;
+    SendPublishReqCb m_sendPublishToBrokerCb;
     TerminationReqCb m_termReqCb;
     BrokerReconnectReqCb m_brokerReconnectReqCb;
+    BrokerDisconnectReqCb m_brokerDisconnectReqCb;
+    BrokerInputPauseReqCb m_brokerInputPauseReqCb;
+    BrokerPubQueueReportCb m_brokerPubQueueReportCb;
     ClientConnectedReportCb m_clientConnectedCb;
     AuthInfoReqCb m_authInfoReqCb;
+    BrokerPubReportCb m_brokerPubReportCb;
+    SubscribeFanOutReqCb m_subscribeFanOutReqCb;
+    UnsubscribeFanOutReqCb m_unsubscribeFanOutReqCb;
+    ClientPubStoreReqCb m_clientPubStoreReqCb;
 
     MqttsnProtStack m_mqttsnStack;
     MqttProtStack m_mqttStack;
 
     DataBuf m_mqttsnMsgData;
     DataBuf m_mqttMsgData;
+    DataBuf m_mqttPubHeaderData;
 
-    OpsList m_ops;
+    unsigned m_routeInput = NoRouteInput;
+    bool m_deadlineMode = false;
+    Timestamp m_now = 0U;
+    std::size_t m_reportedBrokerPubsBytes = 0U;
 
     SessionState m_state;
+    OpsList m_ops;
 };
 
 }  // namespace gateway
@@ -16,6 +16,7 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "SessionOp.h"
+#include "SessionImpl.h"
 
 namespace mqttsn
 {
@@ -23,6 +24,102 @@ namespace mqttsn
 namespace gateway
 {
 
+void SessionOp::sendToClient(const MqttsnMessage& msg)
+{
+    assert(m_session != nullptr);
+    m_session->sendToClient(msg);
+}
+
+void SessionOp::sendToBroker(const MqttMessage& msg)
+{
+    assert(m_session != nullptr);
+    m_session->sendToBroker(msg);
+}
+
+void SessionOp::sendToRoute(unsigned route, const MqttMessage& msg)
+{
+    assert(m_session != nullptr);
+    m_session->sendToRoute(route, msg);
+}
+
+bool SessionOp::sendPublishToBroker(
+    const std::string& topic,
+    std::uint16_t packetId,
+    QoS qos,
+    bool retain,
+    bool dup,
+    const std::uint8_t* payload,
+    std::size_t payloadLen)
+{
+    assert(m_session != nullptr);
+    return m_session->sendPublishToBroker(topic, packetId, qos, retain, dup, payload, payloadLen);
+}
+
+void SessionOp::termRequest()
+{
+    assert(m_session != nullptr);
+    m_session->termRequest();
+}
+
+void SessionOp::brokerReconnectRequest()
+{
+    assert(m_session != nullptr);
+    m_session->brokerReconnectRequest();
+}
+
+void SessionOp::brokerDisconnectRequest()
+{
+    assert(m_session != nullptr);
+    m_session->brokerDisconnectRequest();
+}
+
+void SessionOp::clientConnectedReport(const std::string& clientId)
+{
+    assert(m_session != nullptr);
+    m_session->clientConnectedReport(clientId);
+}
+
+Session::AuthInfo SessionOp::authInfoRequest(const std::string& clientId)
+{
+    assert(m_session != nullptr);
+    return m_session->authInfoRequest(clientId);
+}
+
+bool SessionOp::brokerPubReport(const PubInfoPtr& info)
+{
+    assert(m_session != nullptr);
+    return m_session->brokerPubReport(info);
+}
+
+bool SessionOp::subscribeFanOutRequest(const std::string& topic, std::uint8_t qos)
+{
+    assert(m_session != nullptr);
+    return m_session->subscribeFanOutRequest(topic, qos);
+}
+
+bool SessionOp::unsubscribeFanOutRequest(const std::string& topic)
+{
+    assert(m_session != nullptr);
+    return m_session->unsubscribeFanOutRequest(topic);
+}
+
+bool SessionOp::clientPubStoreAvailable() const
+{
+    assert(m_session != nullptr);
+    return static_cast<bool>(m_session->m_clientPubStoreReqCb);
+}
+
+bool SessionOp::clientPubStoreRequest(
+    const std::string& topic,
+    const std::uint8_t* buf,
+    std::size_t bufLen,
+    std::uint8_t qos,
+    bool retain)
+{
+    assert(m_session != nullptr);
+    return m_session->clientPubStoreRequest(topic, buf, bufLen, qos, retain);
+}
+
 void SessionOp::sendDisconnectToClient()
 {
     DisconnectMsg_SN msg;
@@ -33,6 +130,44 @@ void SessionOp::sendDisconnectToClient()
 
 }
 
+void SessionOp::sendConnectToBroker(
+    const std::string& clientId,
+    std::uint16_t keepAlive,
+    bool clean,
+    const WillInfo& will,
+    const std::string& username,
+    const DataBuf& password)
+{
+    ConnectMsg msg;
+    typedef typename std::decay<decltype(msg.field_flags().field_flagsLow())>::type LowFlagsFieldType;
+    typedef typename std::decay<decltype(msg.field_flags().field_flagsHigh())>::type HighFlagsFieldType;
+
+    msg.field_clientId().value() = clientId;
+    msg.field_keepAlive().value() = keepAlive;
+    msg.field_flags().field_flagsLow().setBitValue(LowFlagsFieldType::BitIdx_cleanSession, clean);
+
+    if (!will.m_topic.empty()) {
+        msg.field_flags().field_flagsLow().setBitValue(LowFlagsFieldType::BitIdx_willFlag, true);
+        msg.field_willTopic().field().value() = will.m_topic;
+        msg.field_willMessage().field().value() = will.m_msg;
+        msg.field_flags().field_willQos().value() = translateQosForBroker(will.m_qos);
+        msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_willRetain, will.m_retain);
+    }
+
+    if (!username.empty()) {
+        msg.field_userName().field().value() = username;
+        msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_username, true);
+
+        if (!password.empty()) {
+            msg.field_password().field().value() = password;
+            msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_password, true);
+        }
+    }
+
+    msg.doRefresh();
+    sendToBroker(msg);
+}
+
 }  // namespace gateway
 
 }  // namespace mqttsn
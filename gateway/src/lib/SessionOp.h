@@ -18,9 +18,10 @@
 
 #pragma once
 
-#include <functional>
 #include <cassert>
-#include <memory>
+#include <limits>
+#include <tuple>
+#include <type_traits>
 
 #include "mqttsn/gateway/Session.h"
 #include "MsgHandler.h"
@@ -32,52 +33,24 @@ namespace mqttsn
 namespace gateway
 {
 
-class SessionOp : public MsgHandler
+class SessionImpl;
+
+// The operations are owned by value by the SessionImpl. Every operation
+// lists the messages it handles in its HandledMsgs tuple, the session
+// passes only these messages to it using their actual type. About
+// any other message received from the client or the broker the operation
+// is notified via clientMsgReceivedImpl() or brokerMsgReceivedImpl().
+// The operations are final and the session invokes their handlers and
+// the *Impl() hooks below on the actual type, i.e. the hooks are hidden
+// rather than overridden and none of the calls is virtual. The requests
+// from the operations are direct calls into the owning session.
+class SessionOp
 {
-    typedef MsgHandler Base;
-public:
+    friend class SessionImpl;
 
-    typedef std::function<void (const MqttsnMessage&)> SendToClientCb;
-    typedef std::function<void (const MqttMessage&)> SendToBrokerCb;
-    typedef std::function<void ()> SessionTermReqCb;
-    typedef std::function<void ()> BrokerReconnectReqCb;
+public:
     typedef unsigned long long Timestamp;
 
-    virtual ~SessionOp() = default;
-
-    template <typename TFunc>
-    void setSendToClientCb(TFunc&& func)
-    {
-        m_sendToClientFunc = std::forward<TFunc>(func);
-    }
-
-    template <typename TFunc>
-    void setSendToBrokerCb(TFunc&& func)
-    {
-        m_sendToBrokerFunc = std::forward<TFunc>(func);
-    }
-
-    template <typename TFunc>
-    void setSessionTermReqCb(TFunc&& func)
-    {
-        m_termReqFunc = std::forward<TFunc>(func);
-    }
-
-    template <typename TFunc>
-    void setBrokerReconnectReqCb(TFunc&& func)
-    {
-        m_brokerReconnectReqFunc = std::forward<TFunc>(func);
-    }
-
-    void timestampUpdated()
-    {
-        if ((m_nextTickTimestamp != 0) &&
-            (m_nextTickTimestamp <= m_state.m_timestamp)) {
-            m_nextTickTimestamp = 0;
-            tickImpl();
-        }
-    }
-
     unsigned nextTick()
     {
         if (m_nextTickTimestamp == 0) {
@@ -91,45 +64,40 @@ public:
         return static_cast<unsigned>(m_nextTickTimestamp - m_state.m_timestamp);
     }
 
-    void start()
-    {
-        startImpl();
-    }
-
-    void brokerConnectionUpdated()
-    {
-        brokerConnectionUpdatedImpl();
-    }
-
 protected:
     SessionOp(SessionState& state)
       : m_state(state)
     {
     }
 
-    void sendToClient(const MqttsnMessage& msg)
-    {
-        assert(m_sendToClientFunc);
-        m_sendToClientFunc(msg);
-    }
-
-    void sendToBroker(const MqttMessage& msg)
-    {
-        assert(m_sendToBrokerFunc);
-        m_sendToBrokerFunc(msg);
-    }
-
-    void termRequest()
-    {
-        assert(m_termReqFunc);
-        m_termReqFunc();
-    }
-
-    void brokerReconnectRequest()
-    {
-        assert(m_brokerReconnectReqFunc);
-        m_brokerReconnectReqFunc();
-    }
+    ~SessionOp() = default;
+
+    void sendToClient(const MqttsnMessage& msg);
+    void sendToBroker(const MqttMessage& msg);
+    void sendToRoute(unsigned route, const MqttMessage& msg);
+    bool sendPublishToBroker(
+        const std::string& topic,
+        std::uint16_t packetId,
+        QoS qos,
+        bool retain,
+        bool dup,
+        const std::uint8_t* payload,
+        std::size_t payloadLen);
+    void termRequest();
+    void brokerReconnectRequest();
+    void brokerDisconnectRequest();
+    void clientConnectedReport(const std::string& clientId);
+    Session::AuthInfo authInfoRequest(const std::string& clientId);
+    bool brokerPubReport(const PubInfoPtr& info);
+    bool subscribeFanOutRequest(const std::string& topic, std::uint8_t qos);
+    bool unsubscribeFanOutRequest(const std::string& topic);
+    bool clientPubStoreAvailable() const;
+    bool clientPubStoreRequest(
+        const std::string& topic,
+        const std::uint8_t* buf,
+        std::size_t bufLen,
+        std::uint8_t qos,
+        bool retain);
 
     void nextTickReq(unsigned ms)
     {
@@ -147,22 +115,65 @@ protected:
     }
 
     void sendDisconnectToClient();
-
-    virtual void tickImpl() {};
-    virtual void startImpl() {};
-    virtual void brokerConnectionUpdatedImpl() {}
+    void sendConnectToBroker(
+        const std::string& clientId,
+        std::uint16_t keepAlive,
+        bool clean,
+        const WillInfo& will,
+        const std::string& username,
+        const DataBuf& password);
+
+    void tickImpl() {}
+    void startImpl() {}
+    void brokerConnectionUpdatedImpl() {}
+    void brokerPubsUpdatedImpl() {}
+    void routeConnectionUpdatedImpl(unsigned route) { static_cast<void>(route); }
+    void clientMsgReceivedImpl() {}
+    void brokerMsgReceivedImpl() {}
 
 private:
-    SessionState& m_state;
+    void setSession(SessionImpl& session)
+    {
+        m_session = &session;
+    }
 
-    SendToClientCb m_sendToClientFunc;
-    SendToBrokerCb m_sendToBrokerFunc;
-    SessionTermReqCb m_termReqFunc;
-    BrokerReconnectReqCb m_brokerReconnectReqFunc;
+    // Returns true when the requested tick is due
+    bool tickDue()
+    {
+        if ((m_nextTickTimestamp != 0) &&
+            (m_nextTickTimestamp <= m_state.m_timestamp)) {
+            m_nextTickTimestamp = 0;
+            return true;
+        }
+
+        return false;
+    }
+
+    SessionState& m_state;
+    SessionImpl* m_session = nullptr;
     Timestamp m_nextTickTimestamp = 0;
 };
 
-typedef std::unique_ptr<SessionOp> SessionOpPtr;
+static_assert(!std::is_polymorphic<SessionOp>::value,
+    "The session operations must not have virtual functions");
+
+// Checks that none of the types listed in TTypes tuple is polymorphic.
+template <typename TTypes>
+struct HasNoPolymorphicTypes;
+
+template <>
+struct HasNoPolymorphicTypes<std::tuple<> > : public std::true_type
+{
+};
+
+template <typename TFirst, typename... TRest>
+struct HasNoPolymorphicTypes<std::tuple<TFirst, TRest...> > :
+    public std::integral_constant<
+        bool,
+        (!std::is_polymorphic<TFirst>::value) && HasNoPolymorphicTypes<std::tuple<TRest...> >::value
+    >
+{
+};
 
 }  // namespace gateway
 
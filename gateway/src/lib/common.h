@@ -24,6 +24,7 @@
 #include <memory>
 #include <limits>
 
+#include "mqttsn/gateway/Session.h"
 #include "mqtt/protocol/v311/field.h"
 #include "mqttsn/protocol/field.h"
 #include "RegMgr.h"
@@ -105,16 +106,18 @@ enum class ConnectionStatus
 
 typedef unsigned long long Timestamp;
 
-struct PubInfo
+struct BrokerRoute
 {
-    std::string m_topic;
-    DataBuf m_msg;
-    QoS m_qos = QoS_AtMostOnceDelivery;
-    bool m_retain = false;
-    bool m_dup = false;
+    std::string m_topicFilter;
+    Timestamp m_lastSend = 0U;
+    bool m_connected = false;
+    bool m_ready = false;
 };
 
-typedef std::unique_ptr<PubInfo> PubInfoPtr;
+typedef std::vector<BrokerRoute> BrokerRoutesList;
+
+typedef Session::BrokerPubInfo PubInfo;
+typedef Session::BrokerPubInfoPtr PubInfoPtr;
 
 struct SessionState
 {
@@ -132,8 +135,13 @@ struct SessionState
     bool m_terminating = false;
     bool m_pendingClientDisconnect = false;
     bool m_clientConnectReported = false;
+    bool m_cleanSession = true;
+    bool m_releaseBrokerWhenAsleep = false;
+    bool m_brokerReleased = false;
     Timestamp m_timestamp = InitialTimestamp;
     Timestamp m_lastMsgTimestamp = InitialTimestamp;
+    Timestamp m_lastBrokerSendTimestamp = InitialTimestamp;
+    Timestamp m_lastBrokerRecvTimestamp = InitialTimestamp;
     unsigned m_callStackCount = 0U;
 
     ConnectionStatus m_connStatus = ConnectionStatus::Disconnected;
@@ -141,6 +149,14 @@ struct SessionState
     std::string m_defaultClientId;
     WillInfo m_will;
     std::size_t m_sleepPubAccLimit = std::numeric_limits<std::size_t>::max();
+    std::size_t m_brokerPubInFlightLimit = std::numeric_limits<std::size_t>::max();
+    std::size_t m_brokerPubsBytes = 0U;
+    std::size_t m_brokerPubsByteLimit = std::numeric_limits<std::size_t>::max();
+    std::size_t m_brokerPubsLowWaterMark = std::numeric_limits<std::size_t>::max();
+    Session::BrokerPubOverflowPolicy m_brokerPubsOverflowPolicy = Session::BrokerPubOverflowPolicy::Block;
+    bool m_brokerInputPauseSupported = false;
+    bool m_brokerInputHeld = false;
+    bool m_brokerInputPaused = false;
     std::uint16_t m_keepAlive = 0U;
     std::uint16_t m_pubOnlyKeepAlive = DefaultKeepAlive;
     std::uint8_t m_gwId = 0U;
@@ -148,9 +164,60 @@ struct SessionState
     DataBuf m_password;
 
     std::list<PubInfoPtr> m_brokerPubs;
+    BrokerRoutesList m_routes;
     RegMgr m_regMgr;
 };
 
+inline
+std::size_t brokerPubSize(const PubInfo& info)
+{
+    return info.m_topic.size() + info.m_msg.size();
+}
+
+inline
+bool isBrokerPubsQueueFull(const SessionState& st, std::size_t extraBytes = 0U)
+{
+    return
+        (st.m_sleepPubAccLimit <= st.m_brokerPubs.size()) ||
+        (st.m_brokerPubsByteLimit < (st.m_brokerPubsBytes + extraBytes));
+}
+
+inline
+PubInfoPtr popBrokerPub(SessionState& st)
+{
+    auto info = std::move(st.m_brokerPubs.front());
+    st.m_brokerPubs.pop_front();
+    st.m_brokerPubsBytes -= brokerPubSize(*info);
+    return info;
+}
+
+inline
+void pushBrokerPub(SessionState& st, PubInfoPtr info)
+{
+    auto size = brokerPubSize(*info);
+    auto policy = st.m_brokerPubsOverflowPolicy;
+    if ((policy == Session::BrokerPubOverflowPolicy::Block) && (!st.m_brokerInputPauseSupported)) {
+        // Nothing to block
+        policy = Session::BrokerPubOverflowPolicy::DropOldest;
+    }
+
+    if (policy == Session::BrokerPubOverflowPolicy::DropNewest) {
+        if (isBrokerPubsQueueFull(st, size)) {
+            return;
+        }
+    }
+    else if (policy == Session::BrokerPubOverflowPolicy::DropOldest) {
+        while ((!st.m_brokerPubs.empty()) && isBrokerPubsQueueFull(st, size)) {
+            popBrokerPub(st);
+        }
+    }
+
+    // With "Block" policy the queue grows beyond the limits only by the data
+    // already received before the broker input was paused.
+    st.m_brokerPubsBytes += size;
+    st.m_brokerPubs.push_back(std::move(info));
+}
+
 }  // namespace gateway
 
 }  // namespace mqttsn
@@ -203,6 +203,38 @@ void mqttsn_gw_session_set_send_data_to_broker_cb(
         });
 }
 
+void mqttsn_gw_session_set_send_publish_to_broker_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionSendPublishReqCb cb,
+    void* data)
+{
+    if ((session.obj == nullptr) || (cb == nullptr)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setSendPublishBrokerReqCb(
+        [cb, data](const std::uint8_t* header, std::size_t headerLen, const std::uint8_t* payload, std::size_t payloadLen)
+        {
+            cb(data, header, static_cast<unsigned>(headerLen), payload, static_cast<unsigned>(payloadLen));
+        });
+}
+
+void mqttsn_gw_session_set_send_data_to_route_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionSendDataRouteReqCb cb,
+    void* data)
+{
+    if ((session.obj == nullptr) || (cb == nullptr)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setSendDataRouteReqCb(
+        [cb, data](unsigned route, const std::uint8_t* buf, std::size_t bufLen)
+        {
+            cb(data, route, buf, static_cast<unsigned>(bufLen));
+        });
+}
+
 void mqttsn_gw_session_set_term_req_cb(
     MqttsnSessionHandle session,
     MqttsnSessionTermReqCb cb,
@@ -235,6 +267,57 @@ void mqttsn_gw_session_set_broker_reconnect_req_cb(
         });
 }
 
+void mqttsn_gw_session_set_broker_disconnect_req_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerDisconnectReqCb cb,
+    void* data)
+{
+    if ((session.obj == nullptr) || (cb == nullptr)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerDisconnectReqCb(
+        [cb, data]()
+        {
+            cb(data);
+        });
+}
+
+void mqttsn_gw_session_set_broker_input_pause_req_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerInputPauseReqCb cb,
+    void* data)
+{
+    if ((session.obj == nullptr) || (cb == nullptr)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerInputPauseReqCb(
+        [cb, data](bool paused)
+        {
+            cb(data, paused);
+        });
+}
+
+void mqttsn_gw_session_set_broker_pub_queue_report_cb(
+    MqttsnSessionHandle session,
+    MqttsnSessionBrokerPubQueueReportCb cb,
+    void* data)
+{
+    if ((session.obj == nullptr) || (cb == nullptr)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerPubQueueReportCb(
+        [cb, data](std::size_t bytes)
+        {
+            cb(
+                data,
+                static_cast<unsigned>(
+                    std::min(bytes, static_cast<std::size_t>(std::numeric_limits<unsigned>::max()))));
+        });
+}
+
 void mqttsn_gw_session_set_client_connect_report_cb(
     MqttsnSessionHandle session,
     MqttsnSessionClientConnectReportCb cb,
@@ -329,6 +412,64 @@ void mqttsn_gw_session_set_sleeping_client_msg_limit(
     reinterpret_cast<Session*>(session.obj)->setSleepingClientMsgLimit(value);
 }
 
+void mqttsn_gw_session_set_broker_pub_inflight_limit(
+    MqttsnSessionHandle session,
+    unsigned value)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerPubInFlightLimit(value);
+}
+
+void mqttsn_gw_session_set_broker_pub_queue_byte_limit(
+    MqttsnSessionHandle session,
+    unsigned limit,
+    unsigned lowWaterMark)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerPubQueueByteLimit(limit, lowWaterMark);
+}
+
+void mqttsn_gw_session_set_broker_pub_overflow_policy(
+    MqttsnSessionHandle session,
+    unsigned value)
+{
+    if ((session.obj == nullptr) ||
+        (static_cast<unsigned>(Session::BrokerPubOverflowPolicy::NumOfValues) <= value)) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerPubOverflowPolicy(
+        static_cast<Session::BrokerPubOverflowPolicy>(value));
+}
+
+void mqttsn_gw_session_set_broker_input_held(
+    MqttsnSessionHandle session,
+    bool value)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setBrokerInputHeld(value);
+}
+
+void mqttsn_gw_session_set_release_broker_when_asleep(
+    MqttsnSessionHandle session,
+    bool value)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setReleaseBrokerWhenAsleep(value);
+}
+
 void mqttsn_gw_session_set_default_client_id(MqttsnSessionHandle session, const char* clientId)
 {
     if (session.obj == nullptr) {
@@ -358,6 +499,15 @@ bool mqttsn_gw_session_start(MqttsnSessionHandle session)
     return reinterpret_cast<Session*>(session.obj)->start();
 }
 
+bool mqttsn_gw_session_start_with_deadlines(MqttsnSessionHandle session, unsigned long long now)
+{
+    if (session.obj == nullptr) {
+        return false;
+    }
+
+    return reinterpret_cast<Session*>(session.obj)->start(now);
+}
+
 void mqttsn_gw_session_stop(MqttsnSessionHandle session)
 {
     if (session.obj == nullptr) {
@@ -376,6 +526,24 @@ void mqttsn_gw_session_tick(MqttsnSessionHandle session)
     reinterpret_cast<Session*>(session.obj)->tick();
 }
 
+void mqttsn_gw_session_tick_at(MqttsnSessionHandle session, unsigned long long now)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->tick(now);
+}
+
+unsigned long long mqttsn_gw_session_next_deadline(MqttsnSessionHandle session)
+{
+    if (session.obj == nullptr) {
+        return Session::NoDeadline;
+    }
+
+    return reinterpret_cast<const Session*>(session.obj)->nextDeadline();
+}
+
 unsigned mqttsn_gw_session_data_from_client(
     MqttsnSessionHandle session,
     const unsigned char* buf,
@@ -390,6 +558,20 @@ unsigned mqttsn_gw_session_data_from_client(
 
 }
 
+unsigned mqttsn_gw_session_data_from_client_at(
+    MqttsnSessionHandle session,
+    const unsigned char* buf,
+    unsigned bufLen,
+    unsigned long long now)
+{
+    if (session.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        reinterpret_cast<Session*>(session.obj)->dataFromClient(buf, bufLen, now));
+}
+
 unsigned mqttsn_gw_session_data_from_broker(
     MqttsnSessionHandle session,
     const unsigned char* buf,
@@ -404,6 +586,20 @@ unsigned mqttsn_gw_session_data_from_broker(
 
 }
 
+unsigned mqttsn_gw_session_data_from_broker_at(
+    MqttsnSessionHandle session,
+    const unsigned char* buf,
+    unsigned bufLen,
+    unsigned long long now)
+{
+    if (session.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        reinterpret_cast<Session*>(session.obj)->dataFromBroker(buf, bufLen, now));
+}
+
 void mqttsn_gw_session_broker_connected(MqttsnSessionHandle session, bool connected)
 {
     if (session.obj == nullptr) {
@@ -413,6 +609,43 @@ void mqttsn_gw_session_broker_connected(MqttsnSessionHandle session, bool connec
     reinterpret_cast<Session*>(session.obj)->setBrokerConnected(connected);
 }
 
+unsigned mqttsn_gw_session_data_from_route(
+    MqttsnSessionHandle session,
+    unsigned route,
+    const unsigned char* buf,
+    unsigned bufLen)
+{
+    if (session.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        reinterpret_cast<Session*>(session.obj)->dataFromRoute(route, buf, bufLen));
+}
+
+void mqttsn_gw_session_route_connected(
+    MqttsnSessionHandle session,
+    unsigned route,
+    bool connected)
+{
+    if (session.obj == nullptr) {
+        return;
+    }
+
+    reinterpret_cast<Session*>(session.obj)->setRouteConnected(route, connected);
+}
+
+bool mqttsn_gw_session_add_broker_route(
+    MqttsnSessionHandle session,
+    const char* topicFilter)
+{
+    if ((session.obj == nullptr) || (topicFilter == nullptr)) {
+        return false;
+    }
+
+    return reinterpret_cast<Session*>(session.obj)->addBrokerRoute(topicFilter);
+}
+
 bool mqttsn_gw_session_add_predefined_topic(
     MqttsnSessionHandle session,
     const char* topic,
@@ -543,6 +776,61 @@ unsigned mqttsn_gw_config_sleeping_client_msg_limit(MqttsnConfigHandle config)
             static_cast<std::size_t>(std::numeric_limits<unsigned>::max())));
 }
 
+unsigned mqttsn_gw_config_broker_pub_inflight_limit(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        std::min(
+            reinterpret_cast<const Config*>(config.obj)->brokerPubInFlightLimit(),
+            static_cast<std::size_t>(std::numeric_limits<unsigned>::max())));
+}
+
+unsigned mqttsn_gw_config_broker_pub_queue_byte_limit(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        std::min(
+            reinterpret_cast<const Config*>(config.obj)->brokerPubQueueByteLimit(),
+            static_cast<std::size_t>(std::numeric_limits<unsigned>::max())));
+}
+
+unsigned mqttsn_gw_config_broker_pub_queue_low_water_mark(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        std::min(
+            reinterpret_cast<const Config*>(config.obj)->brokerPubQueueLowWaterMark(),
+            static_cast<std::size_t>(std::numeric_limits<unsigned>::max())));
+}
+
+unsigned mqttsn_gw_config_broker_pub_overflow_policy(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(
+        reinterpret_cast<const Config*>(config.obj)->brokerPubOverflowPolicy());
+}
+
+bool mqttsn_gw_config_sleeping_client_release_broker(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return false;
+    }
+
+    return reinterpret_cast<const Config*>(config.obj)->sleepingClientReleaseBroker();
+}
+
 unsigned mqttsn_gw_config_available_predefined_topics(MqttsnConfigHandle config)
 {
     if (config.obj == nullptr) {
@@ -650,6 +938,73 @@ unsigned short mqttsn_gw_config_broker_port(MqttsnConfigHandle config)
     return reinterpret_cast<const Config*>(config.obj)->brokerTcpHostPort();
 }
 
+unsigned mqttsn_gw_config_available_brokers(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(reinterpret_cast<const Config*>(config.obj)->brokers().size());
+}
+
+unsigned mqttsn_gw_config_get_brokers(
+    MqttsnConfigHandle config,
+    MqttsnBrokerInfo* buf,
+    unsigned bufLen)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    auto& brokers = reinterpret_cast<const Config*>(config.obj)->brokers();
+    auto total = std::min(static_cast<unsigned>(brokers.size()), bufLen);
+
+    std::transform(
+        brokers.begin(), brokers.begin() + total, buf,
+        [](const mqttsn::gateway::Config::BrokerInfo& info) -> MqttsnBrokerInfo
+        {
+            MqttsnBrokerInfo retInfo;
+            retInfo.address = info.address.c_str();
+            retInfo.port = info.port;
+            return retInfo;
+        });
+    return total;
+}
+
+unsigned mqttsn_gw_config_available_topic_routes(MqttsnConfigHandle config)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    return static_cast<unsigned>(reinterpret_cast<const Config*>(config.obj)->topicRoutes().size());
+}
+
+unsigned mqttsn_gw_config_get_topic_routes(
+    MqttsnConfigHandle config,
+    MqttsnTopicRouteInfo* buf,
+    unsigned bufLen)
+{
+    if (config.obj == nullptr) {
+        return 0U;
+    }
+
+    auto& routes = reinterpret_cast<const Config*>(config.obj)->topicRoutes();
+    auto total = std::min(static_cast<unsigned>(routes.size()), bufLen);
+
+    std::transform(
+        routes.begin(), routes.begin() + total, buf,
+        [](const mqttsn::gateway::Config::TopicRouteInfo& info) -> MqttsnTopicRouteInfo
+        {
+            MqttsnTopicRouteInfo retInfo;
+            retInfo.topicFilter = info.topicFilter.c_str();
+            retInfo.address = info.address.c_str();
+            retInfo.port = info.port;
+            return retInfo;
+        });
+    return total;
+}
+
 unsigned mqttsn_gw_config_values_count(MqttsnConfigHandle config, const char* key)
 {
     if (config.obj == nullptr) {
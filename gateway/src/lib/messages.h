@@ -103,7 +103,13 @@ using InputMqttsnMessages =
     protocol::message::Willmsgupd<TMsgBase, GwOptions>
 >;
 
-typedef mqttsn::protocol::Stack<MqttsnMessage, InputMqttsnMessages<MqttsnMessage> > MqttsnProtStack;
+// The session processes one received message at a time, the message
+// objects are allocated in place inside the stacks rather than on the heap.
+typedef mqttsn::protocol::Stack<
+    MqttsnMessage,
+    InputMqttsnMessages<MqttsnMessage>,
+    comms::option::InPlaceAllocation
+> MqttsnProtStack;
 
 typedef mqtt::protocol::v311::message::Connect<MqttMessage> ConnectMsg;
 typedef mqtt::protocol::v311::message::Connack<MqttMessage> ConnackMsg;
@@ -119,7 +125,11 @@ typedef mqtt::protocol::v311::message::Unsuback<MqttMessage> UnsubackMsg;
 typedef mqtt::protocol::v311::message::Pingreq<MqttMessage> PingreqMsg;
 typedef mqtt::protocol::v311::message::Pingresp<MqttMessage> PingrespMsg;
 typedef mqtt::protocol::v311::message::Disconnect<MqttMessage> DisconnectMsg;
-typedef mqtt::protocol::v311::Stack<MqttMessage> MqttProtStack;
+typedef mqtt::protocol::v311::Stack<
+    MqttMessage,
+    mqtt::protocol::v311::AllMessages<MqttMessage>,
+    comms::option::InPlaceAllocation
+> MqttProtStack;
 
 }  // namespace gateway
 
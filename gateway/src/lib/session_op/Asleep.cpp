@@ -44,15 +44,38 @@ void Asleep::tickImpl()
         return;
     }
 
+    if (m_resumeStage != ResumeStage::None) {
+        abortResume();
+        return;
+    }
+
+    if (canReleaseBroker()) {
+        releaseBroker();
+        return;
+    }
+
     doPing();
 }
 
 void Asleep::brokerConnectionUpdatedImpl()
 {
     auto& st = state();
+    if ((m_resumeStage == ResumeStage::Reconnect) &&
+        (st.m_brokerConnected)) {
+        // Resume the persistent session the broker has kept
+        sendConnectToBroker(st.m_clientId, st.m_keepAlive, false, st.m_will, st.m_username, st.m_password);
+        m_resumeStage = ResumeStage::Connack;
+        nextTickReq(st.m_retryPeriod);
+        return;
+    }
+
     if ((!st.m_brokerConnected) &&
         (!st.m_reconnectingBroker)) {
         cancelTick();
+
+        if (m_resumeStage != ResumeStage::None) {
+            abortResume();
+        }
     }
 }
 
@@ -64,19 +87,75 @@ void Asleep::handle(DisconnectMsg_SN& msg)
     }
 
     sendDisconnectToClient();
-    state().m_connStatus = ConnectionStatus::Asleep;
+    auto& st = state();
+    st.m_connStatus = ConnectionStatus::Asleep;
     m_attempt = 0;
+    if (st.m_brokerReleased) {
+        return;
+    }
+
+    if (canReleaseBroker()) {
+        releaseBroker();
+        return;
+    }
+
     doPing();
 }
 
-void Asleep::handle(MqttsnMessage& msg)
+void Asleep::handle(PingreqMsg_SN& msg)
+{
+    auto& st = state();
+    if (st.m_connStatus != ConnectionStatus::Asleep) {
+        cancelTick();
+        return;
+    }
+
+    if ((!st.m_brokerReleased) ||
+        (m_resumeStage != ResumeStage::None) ||
+        (msg.field_clientId().value() != st.m_clientId)) {
+        return;
+    }
+
+    // The client woke up, the pending messages are held by the broker.
+    // Reply with PINGRESP is postponed (see PubSend) until they are
+    // received.
+    m_resumeStage = ResumeStage::Reconnect;
+    nextTickReq(st.m_retryPeriod);
+    brokerReconnectRequest();
+}
+
+void Asleep::clientMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     if (state().m_connStatus != ConnectionStatus::Asleep) {
+        m_resumeStage = ResumeStage::None;
         cancelTick();
     }
 }
 
+void Asleep::handle(ConnackMsg& msg)
+{
+    auto& st = state();
+    if (st.m_connStatus != ConnectionStatus::Asleep) {
+        cancelTick();
+        return;
+    }
+
+    if (m_resumeStage != ResumeStage::Connack) {
+        return;
+    }
+
+    if (msg.field_responseCode().value() != mqtt::protocol::v311::field::ConnackResponseCodeVal::Accepted) {
+        abortResume();
+        return;
+    }
+
+    // The broker sends the stored messages right after CONNACK, the
+    // response to PINGREQ is expected to follow them.
+    sendToBroker(PingreqMsg());
+    m_resumeStage = ResumeStage::Sync;
+    nextTickReq(st.m_retryPeriod);
+}
+
 void Asleep::handle(PingrespMsg& msg)
 {
     static_cast<void>(msg);
@@ -86,15 +165,25 @@ void Asleep::handle(PingrespMsg& msg)
         return;
     }
 
+    if (m_resumeStage == ResumeStage::Sync) {
+        // Give the client a chance to receive the messages before
+        // releasing the connection again.
+        m_resumeStage = ResumeStage::None;
+        st.m_brokerReleased = false;
+        m_attempt = 0;
+        nextTickReq(st.m_retryPeriod);
+        return;
+    }
+
     m_lastResp = st.m_timestamp;
     m_attempt = 0;
     reqNextTick();
 }
 
-void Asleep::handle(MqttMessage& msg)
+void Asleep::brokerMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     if (state().m_connStatus != ConnectionStatus::Asleep) {
+        m_resumeStage = ResumeStage::None;
         cancelTick();
     }
 }
@@ -137,6 +226,35 @@ void Asleep::reqNextTick()
     nextTickReq(static_cast<unsigned>(nextTickTimestamp - st.m_timestamp));
 }
 
+bool Asleep::canReleaseBroker()
+{
+    // The messages published while the client is asleep are stored
+    // by the broker only when the session is persistent.
+    auto& st = state();
+    return
+        (st.m_releaseBrokerWhenAsleep) &&
+        (!st.m_cleanSession) &&
+        (st.m_brokerConnected) &&
+        (!st.m_brokerReleased) &&
+        (!st.m_pendingClientDisconnect);
+}
+
+void Asleep::releaseBroker()
+{
+    auto& st = state();
+    sendToBroker(DisconnectMsg());
+    st.m_brokerReleased = true;
+    cancelTick();
+    brokerDisconnectRequest();
+}
+
+void Asleep::abortResume()
+{
+    m_resumeStage = ResumeStage::None;
+    sendDisconnectToClient();
+    termRequest();
+}
+
 }  // namespace session_op
 
 }  // namespace gateway
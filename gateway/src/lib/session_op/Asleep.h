@@ -30,28 +30,49 @@ namespace gateway
 namespace session_op
 {
 
-class Asleep : public SessionOp
+class Asleep final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     Asleep(SessionState& sessionState);
     ~Asleep();
 
 protected:
-    virtual void tickImpl() override;
-    virtual void brokerConnectionUpdatedImpl() override;
+    void tickImpl();
+    void brokerConnectionUpdatedImpl();
+    void clientMsgReceivedImpl();
+    void brokerMsgReceivedImpl();
 
 private:
-    using Base::handle;
-    virtual void handle(DisconnectMsg_SN& msg) override;
-    virtual void handle(MqttsnMessage& msg) override;
-    virtual void handle(PingrespMsg& msg) override;
-    virtual void handle(MqttMessage& msg) override;
+    enum class ResumeStage
+    {
+        None,
+        Reconnect,
+        Connack,
+        Sync
+    };
+
+    typedef std::tuple<
+        DisconnectMsg_SN,
+        PingreqMsg_SN,
+        ConnackMsg,
+        PingrespMsg
+    > HandledMsgs;
+
+    void handle(DisconnectMsg_SN& msg);
+    void handle(PingreqMsg_SN& msg);
+    void handle(ConnackMsg& msg);
+    void handle(PingrespMsg& msg);
 
     void doPing();
     void reqNextTick();
+    bool canReleaseBroker();
+    void releaseBroker();
+    void abortResume();
 
+    ResumeStage m_resumeStage = ResumeStage::None;
     unsigned m_attempt = 0;
     Timestamp m_lastReq = 0;
     Timestamp m_lastResp = 0;
@@ -71,15 +71,13 @@ void AsleepMonitor::handle(PingreqMsg_SN& msg)
     }
 }
 
-void AsleepMonitor::handle(MqttsnMessage& msg)
+void AsleepMonitor::clientMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     checkTickRequired();
 }
 
-void AsleepMonitor::handle(MqttMessage& msg)
+void AsleepMonitor::brokerMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     checkTickRequired();
 }
 
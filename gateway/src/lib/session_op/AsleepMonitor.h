@@ -30,23 +30,28 @@ namespace gateway
 namespace session_op
 {
 
-class AsleepMonitor : public SessionOp
+class AsleepMonitor final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     AsleepMonitor(SessionState& sessionState);
     ~AsleepMonitor();
 
 protected:
-    virtual void tickImpl() override;
+    void tickImpl();
+    void clientMsgReceivedImpl();
+    void brokerMsgReceivedImpl();
 
 private:
-    using Base::handle;
-    virtual void handle(DisconnectMsg_SN& msg) override;
-    virtual void handle(PingreqMsg_SN& msg) override;
-    virtual void handle(MqttsnMessage& msg) override;
-    virtual void handle(MqttMessage& msg) override;
+    typedef std::tuple<
+        DisconnectMsg_SN,
+        PingreqMsg_SN
+    > HandledMsgs;
+
+    void handle(DisconnectMsg_SN& msg);
+    void handle(PingreqMsg_SN& msg);
 
     void checkTickRequired();
     void reqNextTick();
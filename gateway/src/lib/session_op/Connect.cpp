@@ -101,6 +101,22 @@ void Connect::handle(ConnectMsg_SN& msg)
         m_will = state().m_will;
     } while (false);
 
+    if (st.m_brokerReleased) {
+        // The connection to the broker has been released while the client
+        // was asleep. Drop the one, which may be re-established on behalf
+        // of the client at the moment, and connect from scratch.
+        st.m_brokerReleased = false;
+        if (st.m_brokerConnected) {
+            sendToBroker(DisconnectMsg());
+        }
+
+        clearConnectionInfo();
+        m_internalState.m_waitingForReconnect = true;
+        nextTickReq(st.m_retryPeriod);
+        brokerReconnectRequest();
+        return;
+    }
+
     if ((st.m_connStatus == ConnectionStatus::Disconnected) &&
         (!st.m_brokerConnected) &&
         (!m_internalState.m_waitingForReconnect) &&
@@ -133,9 +149,6 @@ void Connect::handle(WilltopicMsg_SN& msg)
     if (m_will.m_topic.empty()) {
         m_internalState.m_hasWillMsg = true;
     }
-    else if (state().m_connStatus == ConnectionStatus::Connected) {
-        sendToBroker(PingreqMsg());
-    }
 
     doNextStep();
 }
@@ -252,11 +265,6 @@ void Connect::doNextStep()
                 break;
             }
 
-            if ((st.m_connStatus == ConnectionStatus::Asleep) &&
-                (st.m_brokerConnected)) {
-                sendToBroker(PingreqMsg());
-            }
-
             if (m_clean) {
                 st.m_regMgr.clearRegistrations();
             }
@@ -280,8 +288,7 @@ void Connect::doNextStep()
 
         if ((m_clientId != st.m_clientId) ||
             (st.m_clientId.empty() && (!st.m_clientConnectReported))) {
-            assert(m_authInfoReqCb);
-            m_authInfo = m_authInfoReqCb(m_clientId);
+            m_authInfo = authInfoRequest(m_clientId);
         }
         else {
             m_authInfo = std::make_pair(st.m_username, st.m_password);
@@ -308,36 +315,7 @@ void Connect::doNextStep()
 
 void Connect::forwardConnectionReq()
 {
-    ConnectMsg msg;
-    typedef typename std::decay<decltype(msg.field_flags().field_flagsLow())>::type LowFlagsFieldType;
-    typedef typename std::decay<decltype(msg.field_flags().field_flagsHigh())>::type HighFlagsFieldType;
-
-    msg.field_clientId().value() = m_clientId;
-    msg.field_keepAlive().value() = m_keepAlive;
-    msg.field_flags().field_flagsLow().setBitValue(LowFlagsFieldType::BitIdx_cleanSession, m_clean);
-
-    if (!m_will.m_topic.empty()) {
-        msg.field_flags().field_flagsLow().setBitValue(LowFlagsFieldType::BitIdx_willFlag, true);
-        msg.field_willTopic().field().value() = m_will.m_topic;
-        msg.field_willMessage().field().value() = m_will.m_msg;
-        msg.field_flags().field_willQos().value() = translateQosForBroker(m_will.m_qos);
-        msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_willRetain, m_will.m_retain);
-    }
-
-    auto& username = m_authInfo.first;
-    if (!username.empty()) {
-        msg.field_userName().field().value() = username;
-        msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_username, true);
-
-        auto& password = m_authInfo.second;
-        if (!password.empty()) {
-            msg.field_password().field().value() = password;
-            msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_password, true);
-        }
-    }
-
-    msg.doRefresh();
-    sendToBroker(msg);
+    sendConnectToBroker(m_clientId, m_keepAlive, m_clean, m_will, m_authInfo.first, m_authInfo.second);
 }
 
 void Connect::processAck(mqtt::protocol::v311::field::ConnackResponseCodeVal respCode)
@@ -378,14 +356,15 @@ void Connect::processAck(mqtt::protocol::v311::field::ConnackResponseCodeVal res
     }
 
     auto& sessionState = state();
+    sessionState.m_cleanSession = m_clean;
     if (!sessionState.m_clientConnectReported) {
         sessionState.m_clientConnectReported = true;
-        assert(m_clientConnectedCb);
-        m_clientConnectedCb(m_clientId);
+        clientConnectedReport(m_clientId);
     }
     sessionState.m_clientId = std::move(m_clientId);
     sessionState.m_connStatus = ConnectionStatus::Connected;
     sessionState.m_keepAlive = m_keepAlive;
+    sessionState.m_cleanSession = m_clean;
     sessionState.m_will = m_will;
     sessionState.m_username = std::move(m_authInfo.first);
     sessionState.m_password = std::move(m_authInfo.second);
@@ -31,34 +31,20 @@ namespace gateway
 namespace session_op
 {
 
-class Connect : public SessionOp
+class Connect final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     typedef Session::AuthInfo AuthInfo;
 
-    typedef Session::ClientConnectedReportCb ClientConnectedReportCb;
-    typedef Session::AuthInfoReqCb AuthInfoReqCb;
-
     Connect(SessionState& sessionState);
     ~Connect();
 
-    template <typename TFunc>
-    void setClientConnectedReportCb(TFunc&& func)
-    {
-        m_clientConnectedCb = std::forward<TFunc>(func);
-    }
-
-    template <typename TFunc>
-    void setAuthInfoReqCb(TFunc&& func)
-    {
-        m_authInfoReqCb = std::forward<TFunc>(func);
-    }
-
 protected:
-    virtual void tickImpl() override;
-    virtual void brokerConnectionUpdatedImpl() override;
+    void tickImpl();
+    void brokerConnectionUpdatedImpl();
 
 private:
     struct State
@@ -71,12 +57,19 @@ private:
         bool m_pubOnlyClient = false;
     };
 
-    using Base::handle;
-    virtual void handle(ConnectMsg_SN& msg) override;
-    virtual void handle(WilltopicMsg_SN& msg) override;
-    virtual void handle(WillmsgMsg_SN& msg) override;
-    virtual void handle(PublishMsg_SN& msg) override;
-    virtual void handle(ConnackMsg& msg) override;
+    typedef std::tuple<
+        ConnectMsg_SN,
+        WilltopicMsg_SN,
+        WillmsgMsg_SN,
+        PublishMsg_SN,
+        ConnackMsg
+    > HandledMsgs;
+
+    void handle(ConnectMsg_SN& msg);
+    void handle(WilltopicMsg_SN& msg);
+    void handle(WillmsgMsg_SN& msg);
+    void handle(PublishMsg_SN& msg);
+    void handle(ConnackMsg& msg);
 
     void doNextStep();
     void forwardConnectionReq();
@@ -90,8 +83,6 @@ private:
     std::uint16_t m_keepAlive = 0;
     bool m_clean = false;
     State m_internalState;
-    ClientConnectedReportCb m_clientConnectedCb;
-    AuthInfoReqCb m_authInfoReqCb;
 };
 
 }  // namespace session_op
@@ -37,7 +37,7 @@ Disconnect::~Disconnect() = default;
 void Disconnect::brokerConnectionUpdatedImpl()
 {
     auto& st = state();
-    if (st.m_brokerConnected || state().m_reconnectingBroker) {
+    if (st.m_brokerConnected || st.m_reconnectingBroker || st.m_brokerReleased) {
         return;
     }
 
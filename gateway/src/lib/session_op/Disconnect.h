@@ -30,21 +30,26 @@ namespace gateway
 namespace session_op
 {
 
-class Disconnect : public SessionOp
+class Disconnect final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     Disconnect(SessionState& sessionState);
     ~Disconnect();
 
 protected:
-    virtual void brokerConnectionUpdatedImpl() override;
+    void brokerConnectionUpdatedImpl();
 
 private:
-    using Base::handle;
-    virtual void handle(DisconnectMsg_SN& msg) override;
-    virtual void handle(DisconnectMsg& msg) override;
+    typedef std::tuple<
+        DisconnectMsg_SN,
+        DisconnectMsg
+    > HandledMsgs;
+
+    void handle(DisconnectMsg_SN& msg);
+    void handle(DisconnectMsg& msg);
 
     void sendDisconnectSn();
 };
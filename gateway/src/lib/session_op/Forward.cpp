@@ -29,6 +29,45 @@ namespace gateway
 namespace session_op
 {
 
+namespace
+{
+
+bool topicMatches(const std::string& filter, const std::string& topic)
+{
+    std::size_t filterPos = 0U;
+    std::size_t topicPos = 0U;
+    while (true) {
+        auto filterEnd = std::min(filter.find('/', filterPos), filter.size());
+        auto topicEnd = std::min(topic.find('/', topicPos), topic.size());
+
+        auto filterLevelLen = filterEnd - filterPos;
+        if ((filterLevelLen == 1U) && (filter[filterPos] == '#')) {
+            return true;
+        }
+
+        if (topic.size() < topicPos) {
+            return false;
+        }
+
+        bool matchingLevel =
+            ((filterLevelLen == 1U) && (filter[filterPos] == '+')) ||
+            (filter.compare(filterPos, filterLevelLen, topic, topicPos, topicEnd - topicPos) == 0);
+
+        if (!matchingLevel) {
+            return false;
+        }
+
+        filterPos = filterEnd + 1;
+        topicPos = topicEnd + 1;
+
+        if (filter.size() < filterPos) {
+            return topic.size() < topicPos;
+        }
+    }
+}
+
+}  // namespace
+
 Forward::Forward(SessionState& sessionState)
   : Base(sessionState)
 {
@@ -36,6 +75,30 @@ Forward::Forward(SessionState& sessionState)
 
 Forward::~Forward() = default;
 
+void Forward::brokerConnectionUpdatedImpl()
+{
+    if (!state().m_brokerConnected) {
+        // The acknowledgements are not going to arrive
+        m_pubsInFlight.clear();
+    }
+}
+
+void Forward::routeConnectionUpdatedImpl(unsigned route)
+{
+    if (state().m_routes[route].m_ready) {
+        return;
+    }
+
+    m_pubsInFlight.erase(
+        std::remove_if(
+            m_pubsInFlight.begin(), m_pubsInFlight.end(),
+            [route](PubsInFlightList::const_reference elem) -> bool
+            {
+                return elem.m_route == route;
+            }),
+        m_pubsInFlight.end());
+}
+
 void Forward::handle(PublishMsg_SN& msg)
 {
     auto& midFlagsField = msg.field_flags().field_midFlags();
@@ -73,6 +136,10 @@ void Forward::handle(PublishMsg_SN& msg)
         return;
     }
 
+    if (storePub(msg)) {
+        return;
+    }
+
     if (!st.m_brokerConnected) {
         sendPubackToClient(
             msg.field_topicId().value(),
@@ -87,44 +154,72 @@ void Forward::handle(PublishMsg_SN& msg)
             msg.field_topicId().value(),
             msg.field_msgId().value(),
             mqttsn::protocol::field::ReturnCodeVal_InvalidTopicId);
-        sendToBroker(PingreqMsg());
+        return;
+    }
+
+    auto qos = translateQos(msg.field_flags().field_qos().value());
+    auto route = findRoute(topic);
+    if ((qos != QoS_AtMostOnceDelivery) &&
+        (!trackPubInFlight(msg.field_msgId().value(), msg.field_topicId().value(), route))) {
+        sendPubackToClient(
+            msg.field_topicId().value(),
+            msg.field_msgId().value(),
+            mqttsn::protocol::field::ReturnCodeVal_Congestion);
         return;
     }
 
     bool retain = midFlagsField.getBitValue(MidFlags::BitIdx_retain);
     bool dup = dupFlagsField.getBitValue(DupFlags::BitIdx_bit);
+    auto& data = msg.field_data().value();
     m_lastPubTopicId = msg.field_topicId().value();
 
+    if (route == NoRoute) {
+        const std::uint8_t* dataBuf = nullptr;
+        if (!data.empty()) {
+            dataBuf = &(*data.begin());
+        }
+
+        if (sendPublishToBroker(topic, msg.field_msgId().value(), qos, retain, dup, dataBuf, data.size())) {
+            return;
+        }
+    }
+
     PublishMsg fwdMsg;
     auto& fwdFlags = fwdMsg.field_publishFlags();
 
     fwdFlags.field_retain().setBitValue(0, retain);
-    fwdFlags.field_qos().value() = translateQosForBroker(translateQos(msg.field_flags().field_qos().value()));
+    fwdFlags.field_qos().value() = translateQosForBroker(qos);
     fwdFlags.field_dup().setBitValue(0, dup);
     fwdMsg.field_topic().value() = topic;
     fwdMsg.field_packetId().field().value() = msg.field_msgId().value();
-    auto& data = msg.field_data().value();
     fwdMsg.field_payload().value().assign(data.begin(), data.end());
     fwdMsg.doRefresh();
-    sendToBroker(fwdMsg);
+    sendPublish(fwdMsg, route);
 }
 
 void Forward::handle(PubrelMsg_SN& msg)
 {
+    auto storedIter = findStoredPub(msg.field_msgId().value());
+    if (storedIter != m_storedPubs.end()) {
+        // The message has been stored by the driving code, complete locally
+        m_storedPubs.erase(storedIter);
+        PubcompMsg_SN respMsg;
+        respMsg.field_msgId().value() = msg.field_msgId().value();
+        sendToClient(respMsg);
+        return;
+    }
+
     PubrelMsg fwdMsg;
     fwdMsg.field_packetId().value() = msg.field_msgId().value();
-    sendToBroker(fwdMsg);
-}
 
-void Forward::handle(PingreqMsg_SN& msg)
-{
-    static_cast<void>(msg);
-    if (state().m_connStatus != ConnectionStatus::Connected) {
+    // Must follow the PUBLISH
+    auto iter = findPubInFlight(msg.field_msgId().value());
+    if ((iter != m_pubsInFlight.end()) && (iter->m_route != NoRoute)) {
+        sendToRoute(iter->m_route, fwdMsg);
         return;
     }
 
-    m_pingInProgress = true;
-    sendToBroker(PingreqMsg());
+    sendToBroker(fwdMsg);
 }
 
 void Forward::handle(PingrespMsg_SN& msg)
@@ -161,7 +256,6 @@ void Forward::handle(SubscribeMsg_SN& msg)
 
             if (topic.empty()) {
                 sendSubackFunc(mqttsn::protocol::field::ReturnCodeVal_NotSupported);
-                sendToBroker(PingreqMsg());
                 return;
             }
 
@@ -191,10 +285,22 @@ void Forward::handle(SubscribeMsg_SN& msg)
         }
 
         sendSubackFunc(mqttsn::protocol::field::ReturnCodeVal_InvalidTopicId);
-        sendToBroker(PingreqMsg());
         return;
     } while (false);
 
+    auto reqQos = translateQos(msg.field_flags().field_qos().value());
+    if (subscribeFanOutRequest(topic, static_cast<std::uint8_t>(reqQos))) {
+        // Served locally, the matching messages are going to be provided
+        // by the driving code.
+        SubackMsg_SN respMsg;
+        respMsg.field_flags().field_qos().value() = translateQosForClient(reqQos);
+        respMsg.field_topicId().value() = topicId;
+        respMsg.field_msgId().value() = msg.field_msgId().value();
+        respMsg.field_returnCode().value() = mqttsn::protocol::field::ReturnCodeVal_Accepted;
+        sendToClient(respMsg);
+        return;
+    }
+
     SubInfo info;
     info.m_timestamp = state().m_timestamp;
     info.m_msgId = msg.field_msgId().value();
@@ -250,6 +356,13 @@ void Forward::handle(UnsubscribeMsg_SN& msg)
         topic = topicStr;
     } while (false);
 
+    if (unsubscribeFanOutRequest(topic)) {
+        UnsubackMsg_SN respMsg;
+        respMsg.field_msgId().value() = msg.field_msgId().value();
+        sendToClient(respMsg);
+        return;
+    }
+
     UnsubscribeMsg fwdMsg;
     fwdMsg.field_packetId().value() = msg.field_msgId().value();
     auto& payloadContainer = fwdMsg.field_payload().value();
@@ -292,14 +405,14 @@ void Forward::handle(ConnackMsg&)
         msg.field_topic().value() = topic;
         msg.field_payload().value() = std::move(pub.m_data);
         msg.doRefresh();
-        sendToBroker(msg);
+        sendPublish(msg, findRoute(topic));
     }
 }
 
 void Forward::handle(PubackMsg& msg)
 {
     sendPubackToClient(
-        m_lastPubTopicId,
+        releasePubInFlight(msg.field_packetId().value()),
         msg.field_packetId().value(),
         mqttsn::protocol::field::ReturnCodeVal_Accepted);
 }
@@ -313,6 +426,7 @@ void Forward::handle(PubrecMsg& msg)
 
 void Forward::handle(PubcompMsg& msg)
 {
+    releasePubInFlight(msg.field_packetId().value());
     PubcompMsg_SN respMsg;
     respMsg.field_msgId().value() = msg.field_packetId().value();
     sendToClient(respMsg);
@@ -328,17 +442,6 @@ void Forward::handle(PingreqMsg& msg)
     sendToClient(PingreqMsg_SN());
 }
 
-void Forward::handle(PingrespMsg& msg)
-{
-    static_cast<void>(msg);
-    if (!m_pingInProgress) {
-        return;
-    }
-
-    m_pingInProgress = false;
-    sendToClient(PingrespMsg_SN());
-}
-
 void Forward::handle(SubackMsg& msg)
 {
     std::uint16_t msgId = msg.field_packetId().value();
@@ -409,6 +512,183 @@ void Forward::sendPubackToClient(
     sendToClient(msg);
 }
 
+bool Forward::trackPubInFlight(std::uint16_t msgId, std::uint16_t topicId, unsigned route)
+{
+    auto& st = state();
+    auto iter = findPubInFlight(msgId);
+    if (iter != m_pubsInFlight.end()) {
+        // Retransmission by the client, keep the list ordered by timestamp
+        std::rotate(iter, iter + 1, m_pubsInFlight.end());
+        auto& info = m_pubsInFlight.back();
+        info.m_timestamp = st.m_timestamp;
+        info.m_topicId = topicId;
+        info.m_route = route;
+        return true;
+    }
+
+    prunePubsInFlight();
+    if (st.m_brokerPubInFlightLimit <= m_pubsInFlight.size()) {
+        return false;
+    }
+
+    PubInFlightInfo info;
+    info.m_timestamp = st.m_timestamp;
+    info.m_msgId = msgId;
+    info.m_topicId = topicId;
+    info.m_route = route;
+    m_pubsInFlight.push_back(info);
+    return true;
+}
+
+void Forward::prunePubsInFlight()
+{
+    // Forget the messages the client stopped retrying, the list is
+    // ordered by timestamp.
+    auto& st = state();
+    auto expiryPeriod = static_cast<Timestamp>(st.m_retryPeriod) * (st.m_retryCount + 1);
+    auto iter =
+        std::find_if(
+            m_pubsInFlight.begin(), m_pubsInFlight.end(),
+            [&st, expiryPeriod](PubsInFlightList::const_reference elem) -> bool
+            {
+                return st.m_timestamp <= (elem.m_timestamp + expiryPeriod);
+            });
+    m_pubsInFlight.erase(m_pubsInFlight.begin(), iter);
+}
+
+std::uint16_t Forward::releasePubInFlight(std::uint16_t msgId)
+{
+    auto iter = findPubInFlight(msgId);
+    if (iter == m_pubsInFlight.end()) {
+        // Not tracked any more (expired or the broker connection was
+        // reset), report the most recently published topic ID.
+        return m_lastPubTopicId;
+    }
+
+    auto topicId = iter->m_topicId;
+    m_pubsInFlight.erase(iter);
+    return topicId;
+}
+
+Forward::PubsInFlightList::iterator Forward::findPubInFlight(std::uint16_t msgId)
+{
+    return
+        std::find_if(
+            m_pubsInFlight.begin(), m_pubsInFlight.end(),
+            [msgId](PubsInFlightList::const_reference elem) -> bool
+            {
+                return elem.m_msgId == msgId;
+            });
+}
+
+unsigned Forward::findRoute(const std::string& topic)
+{
+    auto& routes = state().m_routes;
+    for (auto idx = 0U; idx < routes.size(); ++idx) {
+        auto& info = routes[idx];
+        if (info.m_ready && topicMatches(info.m_topicFilter, topic)) {
+            return idx;
+        }
+    }
+
+    // Not routed or the route is not available, use the broker
+    return NoRoute;
+}
+
+void Forward::sendPublish(const PublishMsg& msg, unsigned route)
+{
+    if (route == NoRoute) {
+        sendToBroker(msg);
+        return;
+    }
+
+    sendToRoute(route, msg);
+}
+
+bool Forward::storePub(PublishMsg_SN& msg)
+{
+    if (!clientPubStoreAvailable()) {
+        return false;
+    }
+
+    auto qos = translateQos(msg.field_flags().field_qos().value());
+    if (qos == QoS_AtMostOnceDelivery) {
+        return false;
+    }
+
+    auto& st = state();
+    auto msgId = msg.field_msgId().value();
+    auto sendPubrecFunc =
+        [this, msgId]()
+        {
+            PubrecMsg_SN respMsg;
+            respMsg.field_msgId().value() = msgId;
+            sendToClient(respMsg);
+        };
+
+    auto storedIter = findStoredPub(msgId);
+    if (storedIter != m_storedPubs.end()) {
+        // Retransmission of already stored message, PUBREC was lost
+        storedIter->m_timestamp = st.m_timestamp;
+        sendPubrecFunc();
+        return true;
+    }
+
+    auto topicId = msg.field_topicId().value();
+    auto& topic = st.m_regMgr.mapTopicId(topicId);
+    if (topic.empty() || (findRoute(topic) != NoRoute)) {
+        return false;
+    }
+
+    auto& midFlagsField = msg.field_flags().field_midFlags();
+    typedef typename std::decay<decltype(midFlagsField)>::type MidFlags;
+    bool retain = midFlagsField.getBitValue(MidFlags::BitIdx_retain);
+
+    auto& data = msg.field_data().value();
+    const std::uint8_t* dataBuf = nullptr;
+    if (!data.empty()) {
+        dataBuf = &(*data.begin());
+    }
+
+    if (!clientPubStoreRequest(topic, dataBuf, data.size(), static_cast<std::uint8_t>(qos), retain)) {
+        return false;
+    }
+
+    if (qos == QoS_AtLeastOnceDelivery) {
+        sendPubackToClient(topicId, msgId, mqttsn::protocol::field::ReturnCodeVal_Accepted);
+        return true;
+    }
+
+    // Forget the messages the client stopped retrying to release
+    auto expiryPeriod = static_cast<Timestamp>(st.m_retryPeriod) * (st.m_retryCount + 1);
+    m_storedPubs.erase(
+        std::remove_if(
+            m_storedPubs.begin(), m_storedPubs.end(),
+            [&st, expiryPeriod](StoredPubsList::const_reference elem) -> bool
+            {
+                return (elem.m_timestamp + expiryPeriod) < st.m_timestamp;
+            }),
+        m_storedPubs.end());
+
+    StoredPubInfo info;
+    info.m_timestamp = st.m_timestamp;
+    info.m_msgId = msgId;
+    m_storedPubs.push_back(info);
+    sendPubrecFunc();
+    return true;
+}
+
+Forward::StoredPubsList::iterator Forward::findStoredPub(std::uint16_t msgId)
+{
+    return
+        std::find_if(
+            m_storedPubs.begin(), m_storedPubs.end(),
+            [msgId](StoredPubsList::const_reference elem) -> bool
+            {
+                return elem.m_msgId == msgId;
+            });
+}
+
 }  // namespace session_op
 
 }  // namespace gateway
@@ -20,6 +20,9 @@
 
 #include <cstdint>
 #include <list>
+#include <vector>
+#include <string>
+#include <limits>
 
 #include "comms/util/ScopeGuard.h"
 #include "SessionOp.h"
@@ -34,33 +37,48 @@ namespace gateway
 namespace session_op
 {
 
-class Forward : public SessionOp
+class Forward final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     Forward(SessionState& sessionState);
     ~Forward();
 
 protected:
+    void brokerConnectionUpdatedImpl();
+    void routeConnectionUpdatedImpl(unsigned route);
 
 private:
-    using Base::handle;
-    virtual void handle(PublishMsg_SN& msg) override;
-    virtual void handle(PubrelMsg_SN& msg) override;
-    virtual void handle(PingreqMsg_SN& msg) override;
-    virtual void handle(PingrespMsg_SN& msg) override;
-    virtual void handle(SubscribeMsg_SN& msg) override;
-    virtual void handle(UnsubscribeMsg_SN& msg) override;
-
-    virtual void handle(ConnackMsg& msg) override;
-    virtual void handle(PubackMsg& msg) override;
-    virtual void handle(PubrecMsg& msg) override;
-    virtual void handle(PubcompMsg& msg) override;
-    virtual void handle(PingreqMsg& msg) override;
-    virtual void handle(PingrespMsg& msg) override;
-    virtual void handle(SubackMsg& msg) override;
-    virtual void handle(UnsubackMsg& msg) override;
+    typedef std::tuple<
+        PublishMsg_SN,
+        PubrelMsg_SN,
+        PingrespMsg_SN,
+        SubscribeMsg_SN,
+        UnsubscribeMsg_SN,
+        ConnackMsg,
+        PubackMsg,
+        PubrecMsg,
+        PubcompMsg,
+        PingreqMsg,
+        SubackMsg,
+        UnsubackMsg
+    > HandledMsgs;
+
+    void handle(PublishMsg_SN& msg);
+    void handle(PubrelMsg_SN& msg);
+    void handle(PingrespMsg_SN& msg);
+    void handle(SubscribeMsg_SN& msg);
+    void handle(UnsubscribeMsg_SN& msg);
+
+    void handle(ConnackMsg& msg);
+    void handle(PubackMsg& msg);
+    void handle(PubrecMsg& msg);
+    void handle(PubcompMsg& msg);
+    void handle(PingreqMsg& msg);
+    void handle(SubackMsg& msg);
+    void handle(UnsubackMsg& msg);
 
     struct SubInfo
     {
@@ -79,16 +97,44 @@ private:
 
     typedef std::list<NoGwPubInfo> NoGwPubInfosList;
 
+    static const unsigned NoRoute = std::numeric_limits<unsigned>::max();
+
+    struct PubInFlightInfo
+    {
+        Timestamp m_timestamp = 0U;
+        std::uint16_t m_msgId = 0;
+        std::uint16_t m_topicId = 0;
+        unsigned m_route = NoRoute;
+    };
+
+    typedef std::vector<PubInFlightInfo> PubsInFlightList;
+
+    struct StoredPubInfo
+    {
+        Timestamp m_timestamp = 0U;
+        std::uint16_t m_msgId = 0;
+    };
+
+    typedef std::vector<StoredPubInfo> StoredPubsList;
+
     void sendPubackToClient(
         std::uint16_t topicId,
         std::uint16_t msgId,
         mqttsn::protocol::field::ReturnCodeVal rc);
-
+    bool trackPubInFlight(std::uint16_t msgId, std::uint16_t topicId, unsigned route);
+    void prunePubsInFlight();
+    std::uint16_t releasePubInFlight(std::uint16_t msgId);
+    PubsInFlightList::iterator findPubInFlight(std::uint16_t msgId);
+    unsigned findRoute(const std::string& topic);
+    void sendPublish(const PublishMsg& msg, unsigned route);
+    bool storePub(PublishMsg_SN& msg);
+    StoredPubsList::iterator findStoredPub(std::uint16_t msgId);
 
     std::uint16_t m_lastPubTopicId = 0;
-    bool m_pingInProgress = false;
     SubsInProgressList m_subs;
     NoGwPubInfosList m_pubs;
+    PubsInFlightList m_pubsInFlight;
+    StoredPubsList m_storedPubs;
 };
 
 }  // namespace session_op
@@ -0,0 +1,135 @@
+//
+// Copyright 2016 - 2017 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "KeepAlive.h"
+
+#include <cassert>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace session_op
+{
+
+KeepAlive::KeepAlive(SessionState& sessionState)
+  : Base(sessionState)
+{
+}
+
+KeepAlive::~KeepAlive() = default;
+
+void KeepAlive::brokerConnectionUpdatedImpl()
+{
+    if (!state().m_brokerConnected) {
+        m_clientPingPending = false;
+    }
+}
+
+void KeepAlive::handle(PingreqMsg_SN& msg)
+{
+    static_cast<void>(msg);
+    if (!isActive()) {
+        return;
+    }
+
+    if (isBrokerHealthy()) {
+        sendToClient(PingrespMsg_SN());
+        checkBrokerIdle();
+        return;
+    }
+
+    // Nothing was heard from the broker for a while, respond to the client
+    // only when the broker responds.
+    if (!m_clientPingPending) {
+        m_clientPingPending = true;
+        sendToBroker(PingreqMsg());
+    }
+}
+
+void KeepAlive::clientMsgReceivedImpl()
+{
+    if (isActive()) {
+        checkBrokerIdle();
+    }
+}
+
+void KeepAlive::handle(PingrespMsg& msg)
+{
+    static_cast<void>(msg);
+    if (!m_clientPingPending) {
+        return;
+    }
+
+    m_clientPingPending = false;
+    if (state().m_connStatus == ConnectionStatus::Connected) {
+        sendToClient(PingrespMsg_SN());
+    }
+}
+
+bool KeepAlive::isActive() const
+{
+    auto& st = state();
+    return
+        (st.m_connStatus == ConnectionStatus::Connected) &&
+        (st.m_brokerConnected);
+}
+
+bool KeepAlive::isBrokerHealthy() const
+{
+    auto& st = state();
+    if (st.m_brokerInputPaused) {
+        // Nothing is read from the broker, but the connection is alive
+        return true;
+    }
+
+    if (st.m_keepAlive == 0U) {
+        return false;
+    }
+
+    auto period = static_cast<Timestamp>(st.m_keepAlive) * 1000U;
+    return st.m_timestamp < (st.m_lastBrokerRecvTimestamp + period);
+}
+
+void KeepAlive::checkBrokerIdle()
+{
+    auto& st = state();
+    if (st.m_keepAlive == 0U) {
+        return;
+    }
+
+    // The broker is kept alive only while the client is: it is expected
+    // to send something at least once per keep alive period, so pinging
+    // the broker after half of the period of silence still fits the
+    // 1.5 times the keep alive period the broker waits for. When the
+    // client is gone, the broker detects it and publishes the will.
+    auto period = static_cast<Timestamp>(st.m_keepAlive) * 500U;
+    if (st.m_timestamp < (st.m_lastBrokerSendTimestamp + period)) {
+        return;
+    }
+
+    sendToBroker(PingreqMsg());
+}
+
+}  // namespace session_op
+
+}  // namespace gateway
+
+}  // namespace mqttsn
@@ -0,0 +1,67 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include "SessionOp.h"
+#include "common.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace session_op
+{
+
+class KeepAlive final : public SessionOp
+{
+    typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
+
+public:
+    KeepAlive(SessionState& sessionState);
+    ~KeepAlive();
+
+protected:
+    void brokerConnectionUpdatedImpl();
+    void clientMsgReceivedImpl();
+
+private:
+    typedef std::tuple<
+        PingreqMsg_SN,
+        PingrespMsg
+    > HandledMsgs;
+
+    void handle(PingreqMsg_SN& msg);
+    void handle(PingrespMsg& msg);
+
+    bool isActive() const;
+    bool isBrokerHealthy() const;
+    void checkBrokerIdle();
+
+    bool m_clientPingPending = false;
+};
+
+}  // namespace session_op
+
+}  // namespace gateway
+
+}  // namespace mqttsn
+
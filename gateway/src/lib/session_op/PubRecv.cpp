@@ -79,10 +79,10 @@ void PubRecv::handle(PublishMsg& msg)
 
     if (pubFlags.field_qos().value() <= QosFieldType::ValueType::AtLeastOnceDelivery) {
         cleanPubsFunc();
-        PubInfoPtr pubInfo(new PubInfo);
+        std::shared_ptr<PubInfo> pubInfo(new PubInfo);
         pubInfo->m_topic = msg.field_topic().value();
         pubInfo->m_msg = msg.field_payload().value();
-        pubInfo->m_qos = translateQos(pubFlags.field_qos().value());
+        pubInfo->m_qos = static_cast<std::uint8_t>(translateQos(pubFlags.field_qos().value()));
         pubInfo->m_retain = retain;
         pubInfo->m_dup = dup;
         addPubInfo(std::move(pubInfo));
@@ -147,10 +147,10 @@ void PubRecv::handle(PubrelMsg& msg)
         });
 
     if (iter != m_recvMsgs.end()) {
-        PubInfoPtr pubInfo(new PubInfo);
+        std::shared_ptr<PubInfo> pubInfo(new PubInfo);
         pubInfo->m_topic = iter->m_topic;
         pubInfo->m_msg = iter->m_msg;
-        pubInfo->m_qos = QoS_ExactlyOnceDelivery;
+        pubInfo->m_qos = static_cast<std::uint8_t>(QoS_ExactlyOnceDelivery);
         pubInfo->m_retain = iter->m_retain;
         pubInfo->m_dup = false;
         addPubInfo(std::move(pubInfo));
@@ -164,11 +164,12 @@ void PubRecv::handle(PubrelMsg& msg)
 
 void PubRecv::addPubInfo(PubInfoPtr info)
 {
-    auto& st = state();
-    while (st.m_sleepPubAccLimit <= st.m_brokerPubs.size()) {
-        st.m_brokerPubs.pop_front();
+    if (brokerPubReport(info)) {
+        return;
     }
-    st.m_brokerPubs.push_back(std::move(info));
+
+    auto& st = state();
+    pushBrokerPub(st, std::move(info));
 }
 
 }  // namespace session_op
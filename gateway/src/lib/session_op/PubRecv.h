@@ -30,9 +30,10 @@ namespace gateway
 namespace session_op
 {
 
-class PubRecv : public SessionOp
+class PubRecv final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     PubRecv(SessionState& sessionState);
@@ -41,9 +42,13 @@ public:
 protected:
 
 private:
-    using Base::handle;
-    virtual void handle(PublishMsg& msg) override;
-    virtual void handle(PubrelMsg& msg) override;
+    typedef std::tuple<
+        PublishMsg,
+        PubrelMsg
+    > HandledMsgs;
+
+    void handle(PublishMsg& msg);
+    void handle(PubrelMsg& msg);
 
     struct BrokPubInfo
     {
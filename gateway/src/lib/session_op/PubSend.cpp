@@ -59,6 +59,11 @@ void PubSend::tickImpl()
     sendPubrel();
 }
 
+void PubSend::brokerPubsUpdatedImpl()
+{
+    checkSend();
+}
+
 void PubSend::handle(RegackMsg_SN& msg)
 {
     if ((!m_currPub) ||
@@ -145,15 +150,13 @@ void PubSend::handle(PingreqMsg_SN& msg)
     checkSend();
 }
 
-void PubSend::handle(MqttsnMessage& msg)
+void PubSend::clientMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     checkSend();
 }
 
-void PubSend::handle(MqttMessage& msg)
+void PubSend::brokerMsgReceivedImpl()
 {
-    static_cast<void>(msg);
     checkSend();
 }
 
@@ -163,8 +166,7 @@ void PubSend::newSends()
     assert(!m_currPub);
     auto& st = state();
     while ((!st.m_brokerPubs.empty()) && (!m_currPub)) {
-        m_currPub = std::move(st.m_brokerPubs.front());
-        st.m_brokerPubs.pop_front();
+        m_currPub = popBrokerPub(st);
 
         m_registerCount = 0U;
         sendCurrent();
@@ -250,7 +252,7 @@ void PubSend::doSend()
 
     msg.field_flags().field_topicId().value() = topicType;
     midFlagsField.setBitValue(MidFlags::BitIdx_retain, m_currPub->m_retain);
-    msg.field_flags().field_qos().value() = translateQosForClient(m_currPub->m_qos);
+    msg.field_flags().field_qos().value() = translateQosForClient(static_cast<QoS>(m_currPub->m_qos));
     dupFlagsField.setBitValue(DupFlags::BitIdx_bit, dup);
     msg.field_topicId().value() = m_currTopicInfo.m_topicId;
     msg.field_msgId().value() = m_currMsgId;
@@ -295,7 +297,9 @@ void PubSend::checkSend()
     }
 
     if ((st.m_connStatus == ConnectionStatus::Asleep) && (m_ping)) {
-        newSends();
+        if (!st.m_brokerReleased) {
+            newSends();
+        }
         return;
     }
 
@@ -30,27 +30,36 @@ namespace gateway
 namespace session_op
 {
 
-class PubSend : public SessionOp
+class PubSend final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     PubSend(SessionState& sessionState);
     ~PubSend();
 
 protected:
-    virtual void tickImpl() override;
+    void tickImpl();
+    void brokerPubsUpdatedImpl();
+    void clientMsgReceivedImpl();
+    void brokerMsgReceivedImpl();
 private:
     typedef RegMgr::TopicInfo TopicInfo;
 
-    using Base::handle;
-    virtual void handle(RegackMsg_SN& msg) override;
-    virtual void handle(PubackMsg_SN& msg) override;
-    virtual void handle(PubrecMsg_SN& msg) override;
-    virtual void handle(PubcompMsg_SN& msg) override;
-    virtual void handle(PingreqMsg_SN& msg) override;
-    virtual void handle(MqttsnMessage& msg) override;
-    virtual void handle(MqttMessage& msg) override;
+    typedef std::tuple<
+        RegackMsg_SN,
+        PubackMsg_SN,
+        PubrecMsg_SN,
+        PubcompMsg_SN,
+        PingreqMsg_SN
+    > HandledMsgs;
+
+    void handle(RegackMsg_SN& msg);
+    void handle(PubackMsg_SN& msg);
+    void handle(PubrecMsg_SN& msg);
+    void handle(PubcompMsg_SN& msg);
+    void handle(PingreqMsg_SN& msg);
 
     void newSends();
     void sendCurrent();
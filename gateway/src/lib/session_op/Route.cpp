@@ -0,0 +1,164 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "Route.h"
+
+#include <cassert>
+#include <string>
+#include <limits>
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace session_op
+{
+
+Route::Route(SessionState& sessionState)
+  : Base(sessionState)
+{
+}
+
+Route::~Route() = default;
+
+void Route::routeConnack(unsigned route, ConnackMsg& msg)
+{
+    auto& st = state();
+    assert(route < st.m_routes.size());
+    auto& info = st.m_routes[route];
+    if (!info.m_connected) {
+        return;
+    }
+
+    info.m_ready =
+        (msg.field_responseCode().value() == mqtt::protocol::v311::field::ConnackResponseCodeVal::Accepted);
+    programKeepAlive();
+}
+
+void Route::tickImpl()
+{
+    auto& st = state();
+    if (st.m_keepAlive == 0U) {
+        return;
+    }
+
+    // The route connections carry only publishes, keep them alive
+    // independently of the broker connection.
+    auto period = static_cast<Timestamp>(st.m_keepAlive) * 500U;
+    bool active = false;
+    for (auto idx = 0U; idx < st.m_routes.size(); ++idx) {
+        auto& info = st.m_routes[idx];
+        if (!info.m_ready) {
+            continue;
+        }
+
+        active = true;
+        if ((info.m_lastSend + period) <= st.m_timestamp) {
+            sendToRoute(idx, PingreqMsg());
+        }
+    }
+
+    if (!active) {
+        return;
+    }
+
+    nextTickReq(static_cast<unsigned>(period));
+}
+
+void Route::routeConnectionUpdatedImpl(unsigned route)
+{
+    auto& st = state();
+    assert(route < st.m_routes.size());
+    m_connectSent.resize(st.m_routes.size(), false);
+    m_connectSent[route] = false;
+
+    if ((!st.m_routes[route].m_connected) ||
+        (st.m_connStatus == ConnectionStatus::Disconnected)) {
+        return;
+    }
+
+    sendConnect(route);
+}
+
+void Route::handle(ConnackMsg&)
+{
+    auto& st = state();
+    if (st.m_connStatus != ConnectionStatus::Connected) {
+        return;
+    }
+
+    m_connectSent.resize(st.m_routes.size(), false);
+    for (auto idx = 0U; idx < st.m_routes.size(); ++idx) {
+        if ((!st.m_routes[idx].m_connected) || m_connectSent[idx]) {
+            continue;
+        }
+
+        sendConnect(idx);
+    }
+}
+
+void Route::sendConnect(unsigned route)
+{
+    auto& st = state();
+
+    ConnectMsg msg;
+    typedef typename std::decay<decltype(msg.field_flags().field_flagsLow())>::type LowFlagsFieldType;
+    typedef typename std::decay<decltype(msg.field_flags().field_flagsHigh())>::type HighFlagsFieldType;
+
+    // Publish only connection, nothing to preserve between connections
+    msg.field_clientId().value() = st.m_clientId + "_r" + std::to_string(route);
+    msg.field_keepAlive().value() = st.m_keepAlive;
+    msg.field_flags().field_flagsLow().setBitValue(LowFlagsFieldType::BitIdx_cleanSession, true);
+
+    if (!st.m_username.empty()) {
+        msg.field_userName().field().value() = st.m_username;
+        msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_username, true);
+
+        if (!st.m_password.empty()) {
+            msg.field_password().field().value() = st.m_password;
+            msg.field_flags().field_flagsHigh().setBitValue(HighFlagsFieldType::BitIdx_password, true);
+        }
+    }
+
+    msg.doRefresh();
+    m_connectSent[route] = true;
+    sendToRoute(route, msg);
+}
+
+void Route::programKeepAlive()
+{
+    auto& st = state();
+    if ((st.m_keepAlive == 0U) ||
+        (nextTick() != std::numeric_limits<unsigned>::max())) {
+        return;
+    }
+
+    for (auto& info : st.m_routes) {
+        if (info.m_ready) {
+            nextTickReq(static_cast<unsigned>(st.m_keepAlive) * 500U);
+            return;
+        }
+    }
+}
+
+}  // namespace session_op
+
+}  // namespace gateway
+
+}  // namespace mqttsn
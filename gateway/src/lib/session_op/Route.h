@@ -0,0 +1,67 @@
+//
+// Copyright 2016 (C). Alex Robenko. All rights reserved.
+//
+
+// This file is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#pragma once
+
+#include <vector>
+
+#include "SessionOp.h"
+#include "common.h"
+
+namespace mqttsn
+{
+
+namespace gateway
+{
+
+namespace session_op
+{
+
+class Route final : public SessionOp
+{
+    typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
+
+public:
+    Route(SessionState& sessionState);
+    ~Route();
+
+    void routeConnack(unsigned route, ConnackMsg& msg);
+
+protected:
+    void tickImpl();
+    void routeConnectionUpdatedImpl(unsigned route);
+
+private:
+    typedef std::tuple<
+        ConnackMsg
+    > HandledMsgs;
+
+    void handle(ConnackMsg& msg);
+
+    void sendConnect(unsigned route);
+    void programKeepAlive();
+
+    std::vector<bool> m_connectSent;
+};
+
+}  // namespace session_op
+
+}  // namespace gateway
+
+}  // namespace mqttsn
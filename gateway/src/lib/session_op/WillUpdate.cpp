@@ -86,12 +86,10 @@ void WillUpdate::handle(WilltopicupdMsg_SN& msg)
 
     if (m_op == Op::MsgUpd) {
         sendTopicResp(mqttsn::protocol::field::ReturnCodeVal_Congestion);
-        sendToBroker(PingreqMsg());
         return;
     }
 
     if (m_op == Op::TopicUpd) {
-        sendToBroker(PingreqMsg());
         return;
     }
 
@@ -107,7 +105,6 @@ void WillUpdate::handle(WilltopicupdMsg_SN& msg)
         (st.m_will.m_qos == qos) &&
         (st.m_will.m_retain == retain)) {
         sendTopicResp(mqttsn::protocol::field::ReturnCodeVal_Accepted);
-        sendToBroker(PingreqMsg());
         return;
     }
 
@@ -127,12 +124,10 @@ void WillUpdate::handle(WillmsgupdMsg_SN& msg)
 
     if (m_op == Op::TopicUpd) {
         sendMsgResp(mqttsn::protocol::field::ReturnCodeVal_Congestion);
-        sendToBroker(PingreqMsg());
         return;
     }
 
     if (m_op == Op::MsgUpd) {
-        sendToBroker(PingreqMsg());
         return;
     }
 
@@ -142,7 +137,6 @@ void WillUpdate::handle(WillmsgupdMsg_SN& msg)
     WillDataStorage storedDataView(&(*st.m_will.m_msg.begin()), st.m_will.m_msg.size());
     if (storedDataView == willData) {
         sendMsgResp(mqttsn::protocol::field::ReturnCodeVal_Accepted);
-        sendToBroker(PingreqMsg());
         return;
     }
 
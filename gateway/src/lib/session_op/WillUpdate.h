@@ -30,17 +30,18 @@ namespace gateway
 namespace session_op
 {
 
-class WillUpdate : public SessionOp
+class WillUpdate final : public SessionOp
 {
     typedef SessionOp Base;
+    friend class mqttsn::gateway::SessionImpl;
 
 public:
     WillUpdate(SessionState& sessionState);
     ~WillUpdate();
 
 protected:
-    virtual void tickImpl() override;
-    virtual void brokerConnectionUpdatedImpl() override;
+    void tickImpl();
+    void brokerConnectionUpdatedImpl();
 
 private:
     enum class Op
@@ -50,12 +51,19 @@ private:
         MsgUpd
     };
 
-    using Base::handle;
-    virtual void handle(ConnectMsg_SN& msg) override;
-    virtual void handle(DisconnectMsg_SN& msg) override;
-    virtual void handle(WilltopicupdMsg_SN& msg) override;
-    virtual void handle(WillmsgupdMsg_SN& msg) override;
-    virtual void handle(ConnackMsg& msg) override;
+    typedef std::tuple<
+        ConnectMsg_SN,
+        DisconnectMsg_SN,
+        WilltopicupdMsg_SN,
+        WillmsgupdMsg_SN,
+        ConnackMsg
+    > HandledMsgs;
+
+    void handle(ConnectMsg_SN& msg);
+    void handle(DisconnectMsg_SN& msg);
+    void handle(WilltopicupdMsg_SN& msg);
+    void handle(WillmsgupdMsg_SN& msg);
+    void handle(ConnackMsg& msg);
 
     void startOp(Op op);
     void doNextStage();